@@ -0,0 +1,333 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Service event addressing check
+
+    compiles AddrMatcher for single id, broadcast, range and mask addresses,
+    incl. window edges, sparse and out of id space masks, and compares it
+    against a plain reference over the whole id space, mask windows must be
+    trimmed to the bits set.
+    Then runs echo requests through EcloRegistry over Eclo's with sparse ids,
+    with and without a group filter. Every matching Eclo must respond exactly once,
+    multi-recipient requests must be answered with id masks no wider than 64 ids.
+    Inventory requests must list matching Eclo's in pages, each page's 'next' is the
+    first id of the following page, continuing from it lists the rest only. Requests
+    starting past ID_ANY get no reply.
+    Returns non-zero if any check fails
+*/
+
+#include "lightmanager.hpp"
+#include "sim.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#define BENCH_GID           500
+#define BENCH_RANDOM_MASKS  200
+
+namespace {
+
+// a light with nothing behind it, only it's Eclo's id matters here
+class NullLight : public DimmableLight {
+    uint32_t value = 0;
+    void set_to_value(uint32_t v) override { value = v; };
+public:
+    uint32_t getValue()     const override { return value; };
+    uint32_t getMaxValue()  const override { return 255; };
+    void setPWM(uint8_t /*resolution*/, uint32_t /*freq*/) override {};
+};
+
+const uint16_t ids[] = {1, 2, 3, 10, 62, 63, 64, 65, 66, 127, 128, 129, 200, 1000, 1063, 1064, 40000, ID_ANY - 1};
+const uint16_t grp_ids[] = {2, 64, 65, 1000, 40000};         // subscribed to BENCH_GID
+
+std::map<uint16_t, uint32_t> responders;    // id -> replies
+uint32_t replies = 0;
+bool wide_reply = false;                    // aggregated reply covers more than 64 ids
+
+struct page_t {
+    uint16_t next;
+    std::vector<uint16_t> ids;
+};
+std::vector<page_t> pages;                  // inventory replies
+
+// reference, ids addressed by the event
+bool ref_match(uint16_t dst, light_addr_t const &a, uint16_t id){
+    switch (a.type){
+        case addr_type_t::range :
+            return id >= a.first && id <= a.last;
+        case addr_type_t::mask :
+            return id >= a.first && id - a.first < 64 && (a.mask >> (id - a.first) & 1);
+        default :
+            return dst == ID_ANY || id == dst;
+    }
+}
+
+bool check(const char *name, bool ok){
+    printf("%-48s %s\n", name, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// compare matcher to the reference over all ids, mask windows should be trimmed to the bits set
+bool match_case(const char *name, uint16_t dst, light_addr_t const &a, bool verbose = true){
+    AddrMatcher m(dst, a);
+    uint32_t n = 0, lo = ID_ANY + 1, hi = 0;
+    bool ok = true;
+    for (uint32_t id = 0; id <= ID_ANY; ++id){
+        bool r = ref_match(dst, a, id);
+        if (m(id) != r){
+            if (ok && verbose)
+                printf("  id %u: matcher %d, reference %d\n", id, m(id), r);
+            ok = false;
+        }
+        if (r){
+            ++n;
+            lo = std::min(lo, id);
+            hi = std::max(hi, id);
+        }
+    }
+    ok = ok && m.multi() == (n > 1);
+    if (a.type == addr_type_t::mask && n)
+        ok = ok && m.lo == lo && m.hi == hi;
+    return verbose ? check(name, ok) : ok;
+}
+
+void echo(int32_t gid, uint16_t dst, light_addr_t const &a){
+    responders.clear();
+    replies = 0;
+    wide_reply = false;
+
+    local_srvc_evt rq = {light_event_id_t::echoRq, {ID_ANONYMOUS, dst}, 0, a};
+    esp_event_post_to(*lightmgr::get_light_evts_loop(), LSERVICE_EVENTS, gid, &rq, sizeof(rq), portMAX_DELAY);
+    sim::settle();
+}
+
+bool subscribed(uint16_t id){
+    for (auto g : grp_ids)
+        if (g == id)
+            return true;
+    return false;
+}
+
+// every matching Eclo responds once, multi-recipient requests are aggregated
+bool echo_case(const char *name, uint16_t dst, light_addr_t const &a, int32_t gid = GROUP_SELF){
+    echo(gid, dst, a);
+    bool ok = !wide_reply;
+    uint32_t expected = 0, windows = 0;
+    uint32_t base = 0;
+    for (auto id : ids){
+        bool r = ref_match(dst, a, id) && (gid == GROUP_SELF || subscribed(id));
+        expected += r;
+        // ids are sorted, responders are packed into 64 id windows
+        if (r && (windows == 0 || id - base > 63)){
+            base = id;
+            ++windows;
+        }
+        auto it = responders.find(id);
+        uint32_t got = it == responders.end() ? 0 : it->second;
+        if (got != (r ? 1u : 0u)){
+            printf("  id %u: %u replies, expected %u\n", id, got, r ? 1 : 0);
+            ok = false;
+        }
+    }
+    if (responders.size() > expected)
+        ok = false;         // a reply from an id that is not there
+
+    // single recipient gets it's own reply, others are packed into masks
+    ok = ok && replies == (AddrMatcher(dst, a).multi() ? windows : expected);
+    return check(name, ok);
+}
+
+// expected inventory listing, starting from id 'from'
+std::vector<uint16_t> listing(uint32_t from, light_addr_t const &a, int32_t gid){
+    std::vector<uint16_t> v;
+    for (auto id : ids)
+        if (id >= from && ref_match(ID_ANY, a, id) && (gid == GROUP_SELF || subscribed(id)))
+            v.push_back(id);
+    return v;
+}
+
+void inventory(int32_t gid, uint32_t from, light_addr_t const &a){
+    pages.clear();
+    local_srvc_evt rq = {light_event_id_t::inventoryRq, {ID_ANONYMOUS, ID_ANY}, from, a};
+    esp_event_post_to(*lightmgr::get_light_evts_loop(), LSERVICE_EVENTS, gid, &rq, sizeof(rq), portMAX_DELAY);
+    sim::settle();
+}
+
+// pages list expected ids in order, 'next' is the first id of the following page
+bool inventory_case(const char *name, uint32_t from, light_addr_t const &a, int32_t gid = GROUP_SELF){
+    inventory(gid, from, a);
+
+    if (from > ID_ANY)
+        return check(name, pages.empty());
+
+    std::vector<uint16_t> exp = listing(from, a, gid), got;
+    bool ok = pages.size() == std::max<size_t>(1, (exp.size() + INVENTORY_PAGE_SIZE - 1) / INVENTORY_PAGE_SIZE);
+    for (size_t i = 0; i != pages.size(); ++i){
+        auto &p = pages[i];
+        bool last = i + 1 == pages.size();
+        ok = ok && (last ? !p.next : p.ids.size() == INVENTORY_PAGE_SIZE && p.next == pages[i + 1].ids.front());
+        got.insert(got.end(), p.ids.begin(), p.ids.end());
+    }
+    ok = ok && got == exp;
+    return check(name, ok);
+}
+
+// continuing from the first page's 'next' lists the rest
+bool continuation_case(const char *name, light_addr_t const &a){
+    inventory(GROUP_SELF, 0, a);
+    if (pages.size() < 2)
+        return check(name, false);
+    uint16_t next = pages[0].next;
+    return inventory_case(name, next, a) && pages[0].ids.front() == next;
+}
+
+// direct listing with small pages
+bool get_inventory_case(const char *name, uint8_t size){
+    inventory_item_t items[INVENTORY_PAGE_SIZE];
+    std::vector<uint16_t> got;
+    uint16_t from = 0;
+    uint32_t n = 0;
+    do {
+        uint8_t count;
+        uint16_t next = EcloRegistry::getInstance()->getInventory(items, size, count, from);
+        for (uint8_t i = 0; i != count; ++i)
+            got.push_back(items[i].id);
+        if (next && (count != size || next <= got.back()))
+            return check(name, false);
+        from = next;
+    } while (from && ++n < 100);
+    return check(name, got == listing(0, {addr_type_t::range, 0, ID_ANY, 0}, GROUP_SELF));
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    bool fail = false;
+
+    printf("AddrMatcher\n");
+    fail |= !match_case("id", 10, light_addr_t());
+    fail |= !match_case("id 0", 0, light_addr_t());
+    fail |= !match_case("id ANY", ID_ANY, light_addr_t());
+    fail |= !match_case("range", 0, {addr_type_t::range, 10, 100, 0});
+    fail |= !match_case("range, single id", 0, {addr_type_t::range, 77, 77, 0});
+    fail |= !match_case("range, empty", 0, {addr_type_t::range, 100, 10, 0});
+    fail |= !match_case("range, whole id space", 0, {addr_type_t::range, 0, ID_ANY, 0});
+    fail |= !match_case("range, top edge", 0, {addr_type_t::range, ID_ANY - 1, ID_ANY, 0});
+    fail |= !match_case("mask, empty", 0, {addr_type_t::mask, 10, 0, 0});
+    fail |= !match_case("mask, single bit", 0, {addr_type_t::mask, 10, 0, 1ULL << 20});
+    fail |= !match_case("mask, first and last bit", 0, {addr_type_t::mask, 100, 0, 1ULL | 1ULL << 63});
+    fail |= !match_case("mask, sparse, trimmed", 0, {addr_type_t::mask, 1000, 0, 0x0010400000100800ULL});
+    fail |= !match_case("mask, all bits", 0, {addr_type_t::mask, 0, 0, ~0ULL});
+    fail |= !match_case("mask, past the id space", 0, {addr_type_t::mask, ID_ANY - 10, 0, 0xff00ffULL});
+    fail |= !match_case("mask, out of the id space", 0, {addr_type_t::mask, ID_ANY - 10, 0, 0xff000ULL});
+    fail |= !match_case("mask, 'last' is ignored", 0, {addr_type_t::mask, 50, 51, 0xf0ULL});
+
+    std::mt19937_64 rnd(BENCH_RANDOM_MASKS);
+    bool ok = true;
+    for (uint32_t i = 0; i != BENCH_RANDOM_MASKS; ++i){
+        uint64_t m = rnd() & rnd() & rnd();         // sparse
+        uint16_t first = i % 2 ? rnd() % 256 : ID_ANY - rnd() % 128;
+        ok &= match_case("", 0, {addr_type_t::mask, first, 0, m}, false);
+    }
+    fail |= !check("mask, random sparse", ok);
+
+    // Eclo's with sparse ids, echo replies are collected by the id's they cover
+    std::vector<Eclo*> units;
+    for (auto id : ids){
+        Eclo *e = new Eclo(new NullLight(), id);
+        if (subscribed(id))
+            e->grp_subscribe(BENCH_GID, grp_perms_t::read);
+        units.push_back(e);
+    }
+
+    esp_event_handler_instance_register_with(*lightmgr::get_light_evts_loop(), LSTATE_EVENTS, ESP_EVENT_ANY_ID,
+        [](void* /*arg*/, esp_event_base_t /*base*/, int32_t /*gid*/, void* data){
+            auto r = reinterpret_cast<local_srvc_evt*>(data);
+            if (r->event == light_event_id_t::inventoryRpl){
+                auto inv = reinterpret_cast<local_inventory_evt*>(data);
+                page_t p = {inv->next, {}};
+                for (uint8_t i = 0; i != inv->count; ++i)
+                    p.ids.push_back(inv->items[i].id);
+                pages.push_back(p);
+                return;
+            }
+            if (r->event != light_event_id_t::echoRpl)
+                return;
+            ++replies;
+            if (r->addr.type != addr_type_t::mask){
+                ++responders[r->id.src];
+                return;
+            }
+            if (r->addr.last - r->addr.first > 63)
+                wide_reply = true;
+            for (uint32_t b = 0; b != 64; ++b)
+                if (r->addr.mask >> b & 1)
+                    ++responders[r->addr.first + b];
+        }, nullptr, nullptr);
+    sim::settle();
+
+    printf("\nEcloRegistry echo\n");
+    fail |= !echo_case("id", 64, light_addr_t());
+    fail |= !echo_case("id, nobody there", 5, light_addr_t());
+    fail |= !echo_case("broadcast", ID_ANY, light_addr_t());
+    fail |= !echo_case("range, edges on ids", 0, {addr_type_t::range, 63, 129, 0});
+    fail |= !echo_case("range, edges next to ids", 0, {addr_type_t::range, 4, 61, 0});
+    fail |= !echo_case("range, top edge", 0, {addr_type_t::range, 40000, ID_ANY, 0});
+    fail |= !echo_case("range, empty", 0, {addr_type_t::range, 129, 63, 0});
+    fail |= !echo_case("mask, sparse", 0, {addr_type_t::mask, 1, 0, 1ULL | 1ULL << 2 | 1ULL << 61 | 1ULL << 63});
+    fail |= !echo_case("mask, single bit", 0, {addr_type_t::mask, 1000, 0, 1});
+    fail |= !echo_case("mask, ids over 64 apart", 0, {addr_type_t::mask, 1000, 0, 1ULL | 1ULL << 63});
+    fail |= !echo_case("group, broadcast", ID_ANY, light_addr_t(), BENCH_GID);
+    fail |= !echo_case("group, range", 0, {addr_type_t::range, 3, 1000, 0}, BENCH_GID);
+    fail |= !echo_case("group, id not subscribed", 10, light_addr_t(), BENCH_GID);
+
+    light_addr_t all = {addr_type_t::range, 0, ID_ANY, 0};
+    printf("\nEcloRegistry inventory\n");
+    fail |= !inventory_case("all, two pages", 0, all);
+    fail |= !inventory_case("range, one full page", 0, {addr_type_t::range, 0, 1064, 0});
+    fail |= !inventory_case("range, one item over a page", 0, {addr_type_t::range, 0, 40000, 0});
+    fail |= !inventory_case("from an id between lights", 100, all);
+    fail |= !inventory_case("from the last id", ID_ANY - 1, all);
+    fail |= !inventory_case("from ID_ANY, empty", ID_ANY, all);
+    fail |= !inventory_case("mask, sparse", 0, {addr_type_t::mask, 60, 0, ~0ULL});
+    fail |= !inventory_case("group", 0, all, BENCH_GID);
+    fail |= !inventory_case("from past ID_ANY, rejected", ID_ANY + 1, all);
+    fail |= !inventory_case("from far past ID_ANY, rejected", 0x10001, all);
+    fail |= !continuation_case("continued from 'next'", all);
+    fail |= !get_inventory_case("getInventory(), 1 item pages", 1);
+    fail |= !get_inventory_case("getInventory(), 5 item pages", 5);
+
+    for (auto e : units)
+        delete e;
+    sim::settle();
+    return fail;
+}
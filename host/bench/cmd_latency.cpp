@@ -0,0 +1,355 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Command latency benchmark
+
+    measures end-to-end latency of light commands posted to the event loop
+     - post -> duty register write
+     - post -> stateUpdate delivery to a subscriber
+    for different numbers of lights, groups and command mixes.
+    Groups are run both as per-Eclo subscriptions and as EcloGroup objects,
+    for the latter state latency is the group's grpUpdate delivery
+
+    Clock is manual, so the system runs with no timers involved, latencies are
+    host wall-clock times of the whole path through tasks and event loop,
+    they are meant for comparison between library changes, not as device figures.
+    Limits are loose enough for a loaded host, they catch the missed updates and
+    latencies growing out of proportion with the number of lights.
+    Returns non-zero if any configuration is out of limits, '--quick' runs the mixed
+    command set only
+*/
+
+#include "lightmanager.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define BENCH_SAMPLES       200
+#define BENCH_WARMUP        20
+#define BENCH_GROUP_BASE    1000
+#define BENCH_MAX_DUTY      1023
+#define BENCH_P99_BASE      5000        // us, p99 latency limit
+#define BENCH_P99_PER_LIGHT 100         // us, added to the limit per light addressed by a command
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+bench_clock::time_point t_post;
+std::vector<int64_t> t_duty;            // us since post, per light, -1 if no write
+std::vector<int64_t> t_state;           // us since post, per light, -1 if no state update
+std::vector<bool> own_state;            // light's own stateUpdate is delivered, for EcloGroup members
+uint32_t n_groups = 0;                  // EcloGroup's in a run, 0 - no group objects
+
+int64_t since_post(){
+    return std::chrono::duration_cast<std::chrono::microseconds>(bench_clock::now() - t_post).count();
+}
+
+/*
+    a dimmable light with no hardware behind it, duty write is just recorded,
+    allows to run more lights than LEDC has channels
+*/
+class BenchLight : public DimmableLight {
+    uint32_t idx;
+    uint32_t duty = 0;
+
+    void set_to_value(uint32_t value) override {
+        duty = value;
+        if (t_duty[idx] < 0)
+            t_duty[idx] = since_post();
+        onChange();
+    };
+
+public:
+    BenchLight(uint32_t index) : DimmableLight(1.0, luma::curve::linear), idx(index){};
+    uint32_t getValue()     const override { return duty; };
+    uint32_t getMaxValue()  const override { return BENCH_MAX_DUTY; };
+    void setPWM(uint8_t /*resolution*/, uint32_t /*freq*/) override {};
+};
+
+enum class backend_t { bench, ledc };
+enum class mix_t { set, toggle, step, mixed };
+
+const char *mix_name(mix_t m){
+    switch (m){
+        case mix_t::set :    return "set";
+        case mix_t::toggle : return "toggle";
+        case mix_t::step :   return "step";
+        default :            return "mixed";
+    }
+}
+
+struct report_t {
+    std::vector<int64_t> duty;
+    std::vector<int64_t> state;
+    uint32_t missed_duty = 0;
+    uint32_t missed_state = 0;
+    uint32_t missed_own = 0;            // EcloGroup members' own stateUpdates
+};
+
+int64_t percentile(std::vector<int64_t> &v, unsigned p){
+    if (v.empty())
+        return -1;
+    std::sort(v.begin(), v.end());
+    return v[(v.size() - 1) * p / 100];
+}
+
+local_cmd_evt mk_cmd(mix_t m, std::mt19937 &rnd){
+    if (m == mix_t::mixed)
+        m = static_cast<mix_t>(rnd() % 3);
+
+    local_cmd_evt cmd = {};
+    cmd.id = {ID_ANONYMOUS, ID_ANY};
+    cmd.fade_duration = 0;
+    switch (m){
+        case mix_t::set :
+            cmd.event = light_event_id_t::goValue;
+            cmd.value = rnd() % (BENCH_MAX_DUTY + 1);
+            break;
+        case mix_t::toggle :
+            cmd.event = light_event_id_t::goToggle;
+            break;
+        default :
+            cmd.event = light_event_id_t::goStepScaled;
+            cmd.step = rnd() % 2 ? 10 : -10;
+            cmd.scale = 100;
+    }
+    return cmd;
+}
+
+/**
+ * @brief run one benchmark configuration
+ *
+ * @param lights - number of lights
+ * @param groups - number of groups lights are spread over, 0 - each light is addressed by it's own id
+ * @param grpobj - groups are EcloGroup objects, otherwise each Eclo subscribes to it's group
+ */
+report_t run(backend_t be, uint32_t lights, uint32_t groups, mix_t mix, bool grpobj = false){
+    t_duty.assign(lights, -1);
+    t_state.assign(lights, -1);
+    own_state.assign(lights, false);
+
+    std::vector<EcloGroup*> grps;
+    if (grpobj)
+        for (uint32_t i = 0; i != groups; ++i)
+            grps.push_back(new EcloGroup(BENCH_GROUP_BASE + i));
+    n_groups = grps.size();
+
+    std::vector<Eclo*> units;
+    for (uint32_t i = 0; i != lights; ++i){
+        GenericLight *l;
+        if (be == backend_t::ledc)
+            l = new LEDCLight(i, 4 + i);
+        else
+            l = new BenchLight(i);
+
+        Eclo *e = new Eclo(l, i + 1);
+        if (grpobj)
+            grps[i % groups]->add(e);
+        else if (groups)
+            e->grp_subscribe(BENCH_GROUP_BASE + i % groups, grp_perms_t::read);   // state is reported to own group only
+        units.push_back(e);
+    }
+    sim::settle();
+
+    std::mt19937 rnd(lights * 131 + groups);
+    report_t r;
+    uint32_t targets = groups ? groups : lights;
+
+    for (uint32_t s = 0; s != BENCH_SAMPLES + BENCH_WARMUP; ++s){
+        uint32_t target = rnd() % targets;
+        local_cmd_evt cmd = mk_cmd(mix, rnd);
+
+        std::fill(t_duty.begin(), t_duty.end(), -1);
+        std::fill(t_state.begin(), t_state.end(), -1);
+        std::fill(own_state.begin(), own_state.end(), false);
+        t_post = bench_clock::now();
+        esp_event_post_to(*lightmgr::get_light_evts_loop(), LCMD_EVENTS, groups ? BENCH_GROUP_BASE + target : target + 1, &cmd, sizeof(cmd), portMAX_DELAY);
+        sim::settle();
+
+        if (s < BENCH_WARMUP)
+            continue;
+
+        // command is complete when the last addressed light is done
+        int64_t duty = -1, state = -1;
+        for (uint32_t i = 0; i != lights; ++i){
+            if (groups ? i % groups != target : i != target)
+                continue;
+
+            if (t_duty[i] < 0){
+                ++r.missed_duty;
+                continue;
+            }
+            duty = std::max(duty, t_duty[i]);
+
+            if (t_state[i] < 0)
+                ++r.missed_state;
+            else
+                state = std::max(state, t_state[i]);
+
+            if (grpobj && !own_state[i])
+                ++r.missed_own;
+        }
+        if (duty >= 0)
+            r.duty.push_back(duty);
+        if (state >= 0)
+            r.state.push_back(state);
+    }
+
+    for (auto e : units)
+        delete e;
+    for (auto g : grps)
+        delete g;
+    sim::settle();
+    return r;
+}
+
+void print(backend_t be, uint32_t lights, uint32_t groups, mix_t mix, report_t &r, bool grpobj = false){
+    printf("%-6s %6u %6u%c %-7s | %7lld %7lld %7lld %7lld | %7lld %7lld %7lld %7lld | %6u %6u\n",
+        be == backend_t::ledc ? "ledc" : "bench", lights, groups, grpobj ? 'g' : ' ', mix_name(mix),
+        (long long)percentile(r.duty, 50), (long long)percentile(r.duty, 90), (long long)percentile(r.duty, 99), (long long)percentile(r.duty, 100),
+        (long long)percentile(r.state, 50), (long long)percentile(r.state, 90), (long long)percentile(r.state, 99), (long long)percentile(r.state, 100),
+        r.missed_duty, r.missed_state);
+}
+
+/**
+ * @brief check report against the limits
+ * every addressed light must get it's duty write and stateUpdate, except for the per-Eclo
+ * group subscriptions with more members than the loop's queue could take, see LOOP_LEVT_Q_SIZE.
+ * EcloGroup members post to their own groups after the group's report, which takes one queue slot
+ *
+ * @return true if report is within limits
+ */
+bool check(uint32_t lights, uint32_t groups, report_t &r, bool grpobj = false){
+    uint32_t members = groups ? lights / groups : 1;
+    uint32_t missed_state = 0;
+    if (groups && !grpobj && members > LOOP_LEVT_Q_SIZE)
+        missed_state = (members - LOOP_LEVT_Q_SIZE) * BENCH_SAMPLES;
+    uint32_t missed_own = 0;
+    if (grpobj && members > LOOP_LEVT_Q_SIZE - 1)
+        missed_own = (members - LOOP_LEVT_Q_SIZE + 1) * BENCH_SAMPLES;
+
+    int64_t limit = BENCH_P99_BASE + BENCH_P99_PER_LIGHT * members;
+    bool ok = true;
+
+    if (r.missed_duty){
+        printf("FAIL: %u duty writes missed\n", r.missed_duty);
+        ok = false;
+    }
+    if (r.missed_state > missed_state){
+        printf("FAIL: %u stateUpdates missed, expected no more than %u\n", r.missed_state, missed_state);
+        ok = false;
+    }
+    if (r.missed_own > missed_own){
+        printf("FAIL: %u member stateUpdates missed, expected no more than %u\n", r.missed_own, missed_own);
+        ok = false;
+    }
+    int64_t duty = percentile(r.duty, 99), state = percentile(r.state, 99);
+    if (duty < 0 || duty > limit || state < 0 || state > limit){
+        printf("FAIL: p99 latency duty %lld, state %lld us, limit %lld us\n", (long long)duty, (long long)state, (long long)limit);
+        ok = false;
+    }
+    return ok;
+}
+
+}   // namespace
+
+int main(int argc, char *argv[]){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // LEDC channel writes are timestamped by the simulated peripheral
+    sim::ledc::on_duty_write([](ledc_mode_t mode, ledc_channel_t ch, uint32_t /*duty*/, uint32_t /*hpoint*/){
+        uint32_t idx = mode * LEDC_CHANNEL_MAX + ch;
+        if (idx < t_duty.size() && t_duty[idx] < 0)
+            t_duty[idx] = since_post();
+    });
+
+    // state subscriber
+    esp_event_handler_instance_register_with(*lightmgr::get_light_evts_loop(), LSTATE_EVENTS, ESP_EVENT_ANY_ID,
+        [](void* /*arg*/, esp_event_base_t /*base*/, int32_t gid, void* data){
+            auto st = reinterpret_cast<local_state_evt*>(data);
+            if (st->event == light_event_id_t::grpUpdate && n_groups){
+                // group state covers all of it's members
+                for (uint32_t i = gid - BENCH_GROUP_BASE; i < t_state.size(); i += n_groups)
+                    if (t_state[i] < 0)
+                        t_state[i] = since_post();
+                return;
+            }
+            uint32_t idx = st->id.src - 1;
+            if (st->event != light_event_id_t::stateUpdate || idx >= t_state.size())
+                return;
+            if (n_groups)
+                own_state[idx] = true;      // group members still report to their own group
+            else if (t_state[idx] < 0)
+                t_state[idx] = since_post();
+        }, nullptr, nullptr);
+
+    const uint32_t light_counts[] = {1, 16, 64, 256, 512};
+    const uint32_t group_counts[] = {0, 1, 8, 32};
+    const mix_t mixes[] = {mix_t::set, mix_t::toggle, mix_t::step, mix_t::mixed};
+    bool quick = argc > 1 && !strcmp(argv[1], "--quick");
+    bool fail = false;
+
+    printf("latency, us, g - EcloGroup      | post -> duty write              | post -> stateUpdate             | missed\n");
+    printf("%-6s %6s %6s  %-7s | %7s %7s %7s %7s | %7s %7s %7s %7s | %6s %6s\n",
+        "driver", "lights", "groups", "mix", "p50", "p90", "p99", "max", "p50", "p90", "p99", "max", "duty", "state");
+
+    // real LEDC channels, up to the number of channels available
+    for (uint32_t n : {1u, 16u}){
+        report_t r = run(backend_t::ledc, n, 0, mix_t::set);
+        print(backend_t::ledc, n, 0, mix_t::set, r);
+        fail |= !check(n, 0, r);
+    }
+
+    for (uint32_t n : light_counts){
+        for (uint32_t g : group_counts){
+            if (g > n)
+                continue;
+            for (mix_t m : mixes){
+                if (quick && m != mix_t::mixed)
+                    continue;
+                report_t r = run(backend_t::bench, n, g, m);
+                print(backend_t::bench, n, g, m, r);
+                fail |= !check(n, g, r);
+                if (!g)
+                    continue;
+                r = run(backend_t::bench, n, g, m, true);
+                print(backend_t::bench, n, g, m, r, true);
+                fail |= !check(n, g, r, true);
+            }
+        }
+    }
+
+    return fail;
+}
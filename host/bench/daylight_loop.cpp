@@ -0,0 +1,232 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Daylight harvesting loop validation
+
+    runs DaylightHarvester against a simulated room: two LEDC lights with
+    different luma curves, a lagging noisy lux sensor posting readings to the
+    event loop once a second, and a daylight profile with steps and a slow ramp.
+    For each segment of the profile reports settling time, overshoot, steady
+    state error, output direction reversals (hunting) and the max perceptual
+    rate the lights have moved at.
+    Then a dark zone is driven at rates below a step per ticker period, lights
+    should move at the set rate.
+    Returns non-zero if steady state error is out of the deadband, lights hunt
+    or move faster than the rate limit, or a low rate zone does not move at it's rate
+*/
+
+#include "light_daylight.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_room.hpp"
+#include "esp_log.h"
+#include <cmath>
+#include <cstdio>
+
+#define BENCH_SENSOR        1
+#define BENCH_TARGET        500             // lx
+#define BENCH_LIGHT_LUX     300             // lx at sensor per light at full power
+#define BENCH_SAMPLE        100             // ms
+#define BENCH_READING       1000            // ms, sensor period
+#define BENCH_SETTLE_BAND   5               // %, of target
+#define BENCH_REVERSALS     2               // max output direction changes per segment
+#define BENCH_RATE_WIN      11              // samples, rate measurement window
+#define BENCH_STEADY        10000           // ms, steady state window at a segment end
+#define BENCH_SENSOR_LOW    2               // low rate zone's sensor
+#define BENCH_LOW_RUN       10              // s, low rate zone run
+#define BENCH_LOW_TOL       10              // %, low rate zone travel tolerance
+
+namespace {
+
+struct segment_t {
+    const char *name;
+    uint32_t len;                           // ms
+    double from, to;                        // daylight at segment start/end, lx, linear ramp between
+    bool reachable;                         // target could be held with lights
+};
+
+const segment_t profile[] = {
+    {"dark start",      60000,  100, 100,   true},
+    {"sun step up",     60000,  350, 350,   true},
+    {"slow dusk ramp",  60000,  350,  50,   true},
+    {"dusk hold",       40000,   50,  50,   true},
+    {"bright sun",      60000,  650, 650,   false},     // more than target, lights go off
+    {"cloud",           60000,  200, 200,   true},
+};
+
+struct stats_t {
+    double settle = -1;                     // s, since segment start
+    double overshoot = 0;                   // lx beyond target, towards the far side of the approach
+    double steady_err = 0;                  // mean abs error over steady window, lx
+    uint32_t reversals = 0;
+    double max_rate = 0;                    // perceptual units per second
+};
+
+int64_t seg_start_us = 0;
+const segment_t *seg = nullptr;
+
+double daylight_at(int64_t us){
+    if (!seg)
+        return 0;
+    double t = std::min<double>((us - seg_start_us) / 1000.0 / seg->len, 1);
+    return seg->from + (seg->to - seg->from) * t;
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    FadeCtrl fc;
+    LEDCLight l1(0, 4, &fc, luma::curve::cie1931), l2(1, 5, &fc, luma::curve::linear);
+    l1.setFadeTime(0);
+    l2.setFadeTime(0);
+
+    sim::room::Room room;
+    room.add(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0, BENCH_LIGHT_LUX);
+    room.add(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_1, BENCH_LIGHT_LUX);
+    room.setDaylight(daylight_at);
+    room.setSensor(500, 3);
+
+    DaylightHarvester dh;
+    int z = dh.addZone(BENCH_SENSOR, BENCH_TARGET, 2 * BENCH_LIGHT_LUX);
+    dh.addLight(z, &l1);
+    dh.addLight(z, &l2);
+    dh.start();
+
+    bool fail = false;
+    uint32_t since_reading = BENCH_READING;
+    int32_t prev_pos = l1.getValueScaled(LIGHT_LUMA_RESOLUTION);
+    int dir = 0;
+    int32_t rate_win[BENCH_RATE_WIN];
+    uint32_t rate_i = 0;
+
+    printf("%-16s %9s %11s %13s %11s %9s %13s\n", "segment", "settle,s", "overshoot,lx", "steady err,lx", "reversals", "max rate", "light lx");
+    for (auto const &s : profile){
+        seg = &s;
+        seg_start_us = sim::now_us();
+        stats_t st;
+        bool settled = false;
+        double err_sum = 0, lights_lux = 0;
+        uint32_t err_n = 0;
+        double start_err = BENCH_TARGET - room.illuminance();
+
+        for (uint32_t t = 0; t < s.len; t += BENCH_SAMPLE){
+            if ((since_reading += BENCH_SAMPLE) >= BENCH_READING){
+                since_reading = 0;
+                local_sensor_evt e = {sensor_t::lux, (int32_t)lround(room.read())};
+                esp_event_post_to(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, BENCH_SENSOR, &e, sizeof(e), portMAX_DELAY);
+            }
+            sim::advance(BENCH_SAMPLE * 1000);
+
+            double lux = room.illuminance();
+            double err = BENCH_TARGET - lux;
+            // output motion in perceptual units of the curved light, rate is taken
+            // over a second, position read back from duty is coarse at the low end
+            int32_t pos = l1.getValueScaled(LIGHT_LUMA_RESOLUTION);
+            rate_win[rate_i++ % BENCH_RATE_WIN] = pos;
+            if (rate_i >= BENCH_RATE_WIN){
+                double rate = std::abs(pos - rate_win[rate_i % BENCH_RATE_WIN]) * 1000.0 / (BENCH_SAMPLE * (BENCH_RATE_WIN - 1));
+                if (rate > st.max_rate)
+                    st.max_rate = rate;
+            }
+            int d = (pos > prev_pos) - (pos < prev_pos);
+            if (d && dir && d != dir)
+                ++st.reversals;
+            if (d)
+                dir = d;
+            prev_pos = pos;
+
+            // overshoot is an error of the opposite sign to the one segment has started with
+            if (start_err * err < 0 && std::abs(err) > st.overshoot)
+                st.overshoot = std::abs(err);
+
+            if (!settled && std::abs(err) * 100 <= BENCH_TARGET * BENCH_SETTLE_BAND){
+                settled = true;
+                st.settle = (t + BENCH_SAMPLE) / 1000.0;
+            } else if (settled && std::abs(err) * 100 > BENCH_TARGET * BENCH_SETTLE_BAND && s.from == s.to){
+                settled = false;
+            }
+            if (t + BENCH_STEADY >= s.len){
+                err_sum += std::abs(err);
+                ++err_n;
+            }
+            lights_lux = lux - room.daylight_lux();
+        }
+        st.steady_err = err_sum / err_n;
+
+        bool ok = st.reversals <= BENCH_REVERSALS && st.max_rate <= DAYLIGHT_RATE * 1.1;
+        if (s.reachable)
+            ok = ok && st.steady_err * 100 <= BENCH_TARGET * (DAYLIGHT_DEADBAND + 1);
+        else
+            ok = ok && lights_lux < 1;
+        fail |= !ok;
+
+        char settle[16];
+        if (st.settle < 0)
+            snprintf(settle, sizeof(settle), "%s", "-");
+        else
+            snprintf(settle, sizeof(settle), "%.1f", st.settle);
+        printf("%-16s %9s %11.1f %13.1f %11u %9.0f %13.0f %s\n", s.name, settle, st.overshoot, st.steady_err, st.reversals, st.max_rate, lights_lux, ok ? "" : "FAIL");
+    }
+    dh.stop();
+
+    // rates under a step per ticker period, a dark zone is driven up from off
+    printf("\n%-16s %9s %11s\n", "low rate, u/s", "travel", "expected");
+    for (uint32_t rate : {20, 5}){
+        LEDCLight lo(2, 6, &fc, luma::curve::linear);
+        lo.setFadeTime(0);
+        lo.goValue(0, 0);
+        DaylightHarvester lh;
+        int zl = lh.addZone(BENCH_SENSOR_LOW, BENCH_TARGET, BENCH_LIGHT_LUX);
+        lh.addLight(zl, &lo);
+        lh.setRate(zl, rate);
+        lh.start();
+
+        // the first reading is a step of controller's period, travel is counted from the light's first move
+        int64_t t0 = 0;
+        for (uint32_t t = 0; t < BENCH_LOW_RUN * 1000 * 2 && !t0; t += BENCH_SAMPLE){
+            lh.setInput(BENCH_SENSOR_LOW, 0);
+            sim::advance(BENCH_SAMPLE * 1000);
+            if (lo.getValue())
+                t0 = sim::now_us();
+        }
+        int32_t from = lo.getValueScaled(LIGHT_LUMA_RESOLUTION);
+        for (uint32_t t = 0; t < BENCH_LOW_RUN * 1000; t += BENCH_READING){
+            lh.setInput(BENCH_SENSOR_LOW, 0);
+            sim::advance(BENCH_READING * 1000);
+        }
+        int32_t travel = lo.getValueScaled(LIGHT_LUMA_RESOLUTION) - from;
+        int32_t expected = rate * BENCH_LOW_RUN;
+        bool ok = t0 && std::abs(travel - expected) * 100 <= expected * BENCH_LOW_TOL;
+        fail |= !ok;
+        printf("%-16u %9d %11d %s\n", rate, travel, expected, ok ? "" : "FAIL");
+    }
+
+    return fail;
+}
@@ -0,0 +1,162 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Easing benchmark
+
+    per-tick cost of easing functions, LUT evaluation against the float formulas
+    they were sampled from, and the whole software fade engine tick on the
+    simulated LEDC. Reports max table error in duty units for 13 bit PWM.
+    Figures are host ns, meant for comparison between implementations only
+*/
+
+#include "easing.hpp"
+#include "esp32ledc_fader.hpp"
+#include "sim.hpp"
+#include "esp_log.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#define BENCH_CALLS         (1 << 20)
+#define BENCH_DUTY_MAX      8191
+
+using bench_clock = std::chrono::steady_clock;
+using easing::ease_t;
+
+namespace {
+
+struct func_t {
+    ease_t e;
+    const char *name;
+    float (*ref)(float t);
+};
+
+float bounce_out(float t){
+    const float n1 = 7.5625f, d1 = 2.75f;
+    if (t < 1 / d1)
+        return n1 * t * t;
+    if (t < 2 / d1){
+        t -= 1.5f / d1;
+        return n1 * t * t + 0.75f;
+    }
+    if (t < 2.5f / d1){
+        t -= 2.25f / d1;
+        return n1 * t * t + 0.9375f;
+    }
+    t -= 2.625f / d1;
+    return n1 * t * t + 0.984375f;
+}
+
+const func_t funcs[] = {
+    {ease_t::linear,       "linear",       [](float t){ return t; }},
+    {ease_t::in_cubic,     "in_cubic",     [](float t){ return t * t * t; }},
+    {ease_t::out_cubic,    "out_cubic",    [](float t){ return 1 - powf(1 - t, 3); }},
+    {ease_t::inout_cubic,  "inout_cubic",  [](float t){ return t < 0.5f ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2; }},
+    {ease_t::in_sine,      "in_sine",      [](float t){ return 1 - cosf(t * (float)M_PI / 2); }},
+    {ease_t::out_sine,     "out_sine",     [](float t){ return sinf(t * (float)M_PI / 2); }},
+    {ease_t::inout_sine,   "inout_sine",   [](float t){ return -(cosf((float)M_PI * t) - 1) / 2; }},
+    {ease_t::in_expo,      "in_expo",      [](float t){ return t == 0 ? 0 : powf(2, 10 * t - 10); }},
+    {ease_t::out_expo,     "out_expo",     [](float t){ return t == 1 ? 1 : 1 - powf(2, -10 * t); }},
+    {ease_t::inout_expo,   "inout_expo",   [](float t){ return t == 0 ? 0 : t == 1 ? 1 : t < 0.5f ? powf(2, 20 * t - 10) / 2 : (2 - powf(2, -20 * t + 10)) / 2; }},
+    {ease_t::in_bounce,    "in_bounce",    [](float t){ return 1 - bounce_out(1 - t); }},
+    {ease_t::out_bounce,   "out_bounce",   bounce_out},
+    {ease_t::inout_bounce, "inout_bounce", [](float t){ return t < 0.5f ? (1 - bounce_out(1 - 2 * t)) / 2 : (1 + bounce_out(2 * t - 1)) / 2; }},
+};
+
+// ease-in-out as a css curve, compared against inout_cubic-like reference by shape only
+const easing::bezier_t css_ease = {107, 0, 148, 255};      // cubic-bezier(0.42, 0, 0.58, 1)
+
+volatile uint32_t sink;
+
+double ns_per_call(bench_clock::time_point t0){
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count() / BENCH_CALLS;
+}
+
+double bench_lut(const easing::Easing &f){
+    uint32_t acc = 0;
+    auto t0 = bench_clock::now();
+    for (uint32_t i = 0; i != BENCH_CALLS; ++i)
+        acc += easing::lerp(0, BENCH_DUTY_MAX, f(i & EASE_SCALE));
+    sink = acc;
+    return ns_per_call(t0);
+}
+
+double bench_float(float (*ref)(float)){
+    uint32_t acc = 0;
+    auto t0 = bench_clock::now();
+    for (uint32_t i = 0; i != BENCH_CALLS; ++i)
+        acc += ref((i & EASE_SCALE) / (float)EASE_SCALE) * BENCH_DUTY_MAX;
+    sink = acc;
+    return ns_per_call(t0);
+}
+
+// max deviation of LUT from float formula, duty units
+uint32_t max_error(const easing::Easing &f, float (*ref)(float)){
+    uint32_t err = 0;
+    for (uint32_t t = 0; t <= EASE_SCALE; ++t){
+        int32_t v = easing::lerp(0, BENCH_DUTY_MAX, f(t));
+        int32_t r = lroundf(ref(t / (float)EASE_SCALE) * BENCH_DUTY_MAX);
+        uint32_t d = std::abs(v - r);
+        if (d > err)
+            err = d;
+    }
+    return err;
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    printf("%-14s %10s %10s %10s\n", "easing", "lut,ns", "float,ns", "max err");
+    for (auto &f : funcs){
+        easing::Easing e(f.e);
+        printf("%-14s %10.2f %10.2f %10u\n", f.name, bench_lut(e), bench_float(f.ref), max_error(e, f.ref));
+    }
+
+    auto t0 = bench_clock::now();
+    for (uint32_t i = 0; i != 1000; ++i)
+        easing::Easing e(ease_t::bezier, css_ease);
+    double build = std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count() / 1000;
+    easing::Easing css(ease_t::bezier, css_ease);
+    printf("%-14s %10.2f %10s %10s   table build: %.2f us\n", "bezier", bench_lut(css), "-", "-", build);
+
+    // software engine tick, including LEDC duty write
+    PWMCtl::getInstance()->chStart(0, 4);
+    PWMCtl::getInstance()->tmSet(PWMCtl::getInstance()->chGetTimernum(0), LEDC_TIMER_13_BIT, 1000);
+    FadeEngineSW fe(0);
+    fe.fade(BENCH_DUTY_MAX, 1000000, easing::Easing(ease_t::inout_sine));
+    int64_t now = sim::now_us();
+    t0 = bench_clock::now();
+    for (uint32_t i = 0; i != BENCH_CALLS / 16; ++i)
+        fe.tick(now + i);
+    double tick = std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count() / (BENCH_CALLS / 16);
+    printf("FadeEngineSW::tick, ns: %.2f\n", tick);
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Long fade check
+
+    runs an eased fade longer than 65 s on the segmented and software engines,
+    duty is sampled every second and compared against the easing curve at the
+    segment boundaries, where segmented fade is exact. Progress math of a fade
+    that long overflows 32 bit fixed point.
+    Returns non-zero if duty ever goes backwards, does not track the curve, or
+    fade does not end at the target
+*/
+
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_FADE          200             // s, fade duration
+#define BENCH_TOLERANCE     2               // duty units, rounding of the easing LUT and lerp
+
+namespace {
+
+uint32_t duty(uint32_t ch){
+    return sim::ledc::channel(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch).duty;
+}
+
+// fade a light 0 to max on an engine, returns true if duty tracks the curve
+bool check(const char *name, uint32_t ch, fade_engine_t engine){
+    FadeCtrl fc;
+    LEDCLight l(ch, 4 + ch, &fc, luma::curve::linear, 1.0, engine);
+    easing::Easing e(easing::ease_t::out_cubic);
+    uint32_t max = l.getMaxValue();
+
+    l.goValue(max, BENCH_FADE * 1000, &e);
+    sim::settle();
+
+    bool ok = true;
+    uint32_t prev = 0, err = 0;
+    for (uint32_t s = 1; s <= BENCH_FADE; ++s){
+        sim::advance(1000000);
+        uint32_t d = duty(ch);
+        if (d < prev && ok){
+            printf("%s: duty went backwards at %us, %u -> %u\n", name, s, prev, d);
+            ok = false;
+        }
+        prev = d;
+
+        // segment boundaries are whole seconds for this duration
+        if (s % (BENCH_FADE / FADE_SEGMENTS))
+            continue;
+        uint32_t ref = easing::lerp(0, max, e((uint64_t)s * EASE_SCALE / BENCH_FADE));
+        uint32_t dev = std::abs((int32_t)d - (int32_t)ref);
+        if (dev > err)
+            err = dev;
+    }
+    sim::advance(1000000);
+
+    ok &= err <= BENCH_TOLERANCE && duty(ch) == max;
+    printf("%-10s %8u %8u %8u %s\n", name, BENCH_FADE, err, duty(ch), ok ? "" : "FAIL");
+    return ok;
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    printf("%-10s %8s %8s %8s\n", "engine", "fade,s", "max err", "end");
+    bool ok = check("segmented", 0, fade_engine_t::segmented);
+    ok &= check("software", 1, fade_engine_t::software);
+    return !ok;
+}
@@ -0,0 +1,213 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    EcloGroup aggregated state check
+
+    runs a random sequence of member joins and leaves, direct value changes,
+    fades, group commands and scale changes over lights on simulated LEDC channels.
+    Group state is updated incrementally on member changes, min/max are rescanned
+    lazily, so after each step, once fades are over, it is compared to a state
+    recomputed from scratch over the current members.
+    Returns non-zero if any step's state differs from the recomputed one
+*/
+
+#include "lightmanager.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#define BENCH_LIGHTS        8
+#define BENCH_GID           100
+#define BENCH_STEPS         2000
+#define BENCH_FADE_MAX      500             // ms
+#define BENCH_POWER_ERR     0.001f          // W, incremental sum float residue
+
+namespace {
+
+struct unit_t {
+    Eclo *eclo;
+    LEDCLight *light;
+    bool member;
+    bool counted;           // member with WRITE permission
+};
+
+unit_t units[BENCH_LIGHTS];
+int32_t scale = DEFAULT_SCALE;
+
+// group state recomputed from the lights
+group_state_t recompute(){
+    group_state_t st = {0, 0, scale, 0, UINT32_MAX, 0, 0};
+    uint64_t sum = 0;
+    for (auto &u : units){
+        if (!u.counted)
+            continue;
+        uint32_t v = u.light->getValueScaled(scale);
+        ++st.members;
+        st.on += u.light->getValue() != 0;
+        sum += v;
+        st.value_min = std::min(st.value_min, v);
+        st.value_max = std::max(st.value_max, v);
+        st.power += u.light->getCurrentPower();
+    }
+    if (st.members)
+        st.value_scaled = sum / st.members;
+    else
+        st.value_min = 0;
+    return st;
+}
+
+bool same(group_state_t const &a, group_state_t const &b){
+    return a.members == b.members && a.on == b.on && a.brtscale == b.brtscale && a.value_scaled == b.value_scaled &&
+        a.value_min == b.value_min && a.value_max == b.value_max && std::fabs(a.power - b.power) <= BENCH_POWER_ERR;
+}
+
+void print(const char *name, group_state_t const &s){
+    printf("  %-10s members:%u on:%u scale:%d avg:%u min:%u max:%u power:%.3f\n", name,
+        s.members, s.on, s.brtscale, s.value_scaled, s.value_min, s.value_max, s.power);
+}
+
+// let all fades end and state reports run
+void finish_fades(){
+    sim::advance((int64_t)BENCH_FADE_MAX * 2000);
+    sim::settle();
+}
+
+void grp_cmd(light_event_id_t event, uint32_t value){
+    local_cmd_evt cmd = {};
+    cmd.id = {ID_ANONYMOUS, ID_ANY};
+    cmd.event = event;
+    cmd.value = value;
+    cmd.fade_duration = 0;
+    esp_event_post_to(*lightmgr::get_light_evts_loop(), LCMD_EVENTS, BENCH_GID, &cmd, sizeof(cmd), portMAX_DELAY);
+    sim::settle();
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    for (uint32_t i = 0; i != BENCH_LIGHTS; ++i){
+        LEDCLight *l = new LEDCLight(i, 4 + i);
+        l->setMaxPower(1.5f + i);
+        units[i] = {new Eclo(l, i + 1), l, false, false};
+    }
+    EcloGroup grp(BENCH_GID);
+    grp.setReportPeriod(0);
+    sim::settle();
+
+    std::mt19937 rnd(BENCH_STEPS);
+    uint32_t fails = 0;
+    const char *op = "";
+
+    for (uint32_t s = 0; s != BENCH_STEPS; ++s){
+        unit_t &u = units[rnd() % BENCH_LIGHTS];
+        uint32_t max = u.light->getMaxValue();
+
+        switch (rnd() % 7){
+            case 0 :
+                op = "join";
+                if (!u.member){
+                    bool w = rnd() % 4;
+                    grp.add(u.eclo, w ? grp_perms_t::rw : grp_perms_t::read);
+                    u.member = true;
+                    u.counted = w;
+                }
+                break;
+            case 1 :
+                op = "leave";
+                if (u.member){
+                    grp.remove(u.eclo);
+                    u.member = u.counted = false;
+                }
+                break;
+            case 2 :
+                op = "value";
+                // extremes are hit more often, those trigger min/max rescans
+                u.light->goValue(rnd() % 3 ? rnd() % (max + 1) : (rnd() % 2 ? max : 0), 0);
+                break;
+            case 3 : {
+                op = "fade";
+                uint32_t n = 1 + rnd() % BENCH_LIGHTS;
+                for (uint32_t i = 0; i != n; ++i){
+                    unit_t &f = units[rnd() % BENCH_LIGHTS];
+                    f.light->goValue(rnd() % (max + 1), 1 + rnd() % BENCH_FADE_MAX);
+                }
+                // members might leave or join while fading
+                sim::advance((int64_t)(rnd() % BENCH_FADE_MAX) * 1000);
+                sim::settle();
+                unit_t &j = units[rnd() % BENCH_LIGHTS];
+                if (j.member){
+                    grp.remove(j.eclo);
+                    j.member = j.counted = false;
+                } else {
+                    grp.add(j.eclo);
+                    j.member = j.counted = true;
+                }
+                break;
+            }
+            case 4 :
+                op = "grp value";
+                grp_cmd(light_event_id_t::goValue, rnd() % (max + 1));
+                break;
+            case 5 :
+                op = "grp toggle";
+                grp_cmd(light_event_id_t::goToggle, 0);
+                break;
+            default :
+                op = "scale";
+                if (rnd() % 4 == 0){
+                    scale = rnd() % 2 ? DEFAULT_SCALE : 1 + rnd() % 1000;
+                    grp.setScale(scale);
+                }
+        }
+        finish_fades();
+
+        group_state_t st = grp.getState(), ref = recompute();
+        if (!same(st, ref)){
+            if (!fails)
+                printf("step %u, %s: aggregated state differs from recomputed\n", s, op);
+            if (fails < 5){
+                print("group", st);
+                print("recomputed", ref);
+            }
+            ++fails;
+        }
+    }
+
+    printf("%u steps, %u state mismatches\n", BENCH_STEPS, fails);
+
+    for (auto &u : units)
+        delete u.eclo;
+    sim::settle();
+    return fails != 0;
+}
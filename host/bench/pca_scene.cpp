@@ -0,0 +1,124 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    PCA9685 bus traffic benchmark
+
+    drives 16 PCA9685Light channels on a simulated I2C bus through a set of
+    scene changes and reports bytes and transactions on the wire for each,
+    against a naive driver writing each changed channel's registers with a
+    transaction of it's own. Bytes are counted both by the I2CBus and by the
+    simulated bus to cross-check each other.
+    Returns non-zero if batching sends more than the naive driver for any scene
+*/
+
+#include "light_drv_pca9685.hpp"
+#include "sim.hpp"
+#include "sim_i2c.hpp"
+#include "esp_log.h"
+#include <cstdio>
+
+#define BENCH_SETTLE        50              // ms, time for the update task to send a scene
+#define BENCH_FADE          1000            // ms
+#define NAIVE_CH_BYTES      6               // address, register, 4 LED registers
+
+namespace {
+
+uint32_t wire_bytes = 0;                    // as seen by simulated bus, including address bytes
+
+struct scene_t {
+    const char *name;
+    uint32_t (*value)(uint8_t ch);          // new channel value, or the current one to leave it unchanged
+};
+
+PCA9685Light *lights[PCA9685_CHANNELS];
+
+uint32_t keep(uint8_t ch){ return lights[ch]->getValue(); }
+
+const scene_t scenes[] = {
+    {"all to 50%",          [](uint8_t){ return (uint32_t)PCA9685_MAX_DUTY / 2; }},
+    {"one channel",         [](uint8_t ch){ return ch == 5 ? 100U : keep(ch); }},
+    {"4 adjacent",          [](uint8_t ch){ return ch >= 8 && ch < 12 ? 300U + ch : keep(ch); }},
+    {"8 scattered",         [](uint8_t ch){ return ch % 2 ? keep(ch) : 1000U + ch; }},
+    {"16 different",        [](uint8_t ch){ return 200U * ch + 7; }},
+    {"all off",             [](uint8_t){ return 0U; }},
+};
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    sim::i2c::on_write([](i2c_port_t, uint8_t, const uint8_t *, size_t len){ wire_bytes += len + 1; return ESP_OK; });
+
+    I2CBusIDF bus;
+    PCA9685 chip(&bus);
+    chip.begin();
+    for (uint8_t i = 0; i != PCA9685_CHANNELS; ++i)
+        lights[i] = new PCA9685Light(&chip, i, luma::curve::linear);
+    sim::advance(BENCH_SETTLE * 1000);
+
+    bool fail = false;
+    printf("%-16s %8s %8s %8s %8s %8s\n", "scene", "changed", "bytes", "wire", "xfers", "naive");
+    for (auto const &s : scenes){
+        uint32_t changed = 0;
+        bus.resetStats();
+        wire_bytes = 0;
+        for (uint8_t i = 0; i != PCA9685_CHANNELS; ++i){
+            uint32_t v = s.value(i);
+            if (v != lights[i]->getValue()){
+                lights[i]->stageValue(v);
+                ++changed;
+            }
+        }
+        lights[0]->flush();
+        sim::advance(BENCH_SETTLE * 1000);
+
+        uint32_t naive = changed * NAIVE_CH_BYTES;
+        bool ok = bus.getTxBytes() <= naive && bus.getTxBytes() == wire_bytes;
+        fail |= !ok;
+        printf("%-16s %8u %8u %8u %8u %8u %s\n", s.name, changed, bus.getTxBytes(), wire_bytes, bus.getTxCount(), naive, ok ? "" : "FAIL");
+    }
+
+    // all channels fading to different values, changes are sent once per update tick
+    bus.resetStats();
+    wire_bytes = 0;
+    for (uint8_t i = 0; i != PCA9685_CHANNELS; ++i)
+        lights[i]->goValue(PCA9685_MAX_DUTY - 100 * i, BENCH_FADE);
+    sim::advance((BENCH_FADE + BENCH_SETTLE) * 1000);
+
+    uint32_t ticks = bus.getTxCount();
+    uint32_t naive = ticks * PCA9685_CHANNELS * NAIVE_CH_BYTES;
+    bool ok = bus.getTxBytes() <= naive && bus.getTxBytes() == wire_bytes;
+    fail |= !ok;
+    printf("%-16s %8u %8u %8u %8u %8u %s\n", "fade 16 ch", PCA9685_CHANNELS, bus.getTxBytes(), wire_bytes, ticks, naive, ok ? "" : "FAIL");
+    printf("fade: %u ms update tick, %.1f bytes per tick, naive %u\n", chip.getTick(), ticks ? (float)bus.getTxBytes() / ticks : 0, PCA9685_CHANNELS * NAIVE_CH_BYTES);
+
+    for (auto l : lights)
+        delete l;
+    return fail;
+}
@@ -0,0 +1,137 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    PSU load benchmark
+
+    drives composite lights of LEDC channels in power_share_t::equal and
+    power_share_t::phaseshift modes through a range of brightness values and
+    reports aggregate load reconstructed from the channels' PWM waveforms,
+    each channel weighted by GenericLight::getMaxPower() of it's light.
+    Returns non-zero if phase-shifted PWM has a higher peak or ripple
+    than synchronous PWM for any case, which is a phase planning regression
+*/
+
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_psu.hpp"
+#include "esp_log.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define BENCH_SUPPLY_V      12.0
+#define BENCH_PWM_BITS      10
+#define BENCH_PWM_FREQ      1000
+
+namespace {
+
+// per-light power, W, lights in a composite get the powers in turn
+const float light_power[] = {4.0, 6.0, 5.0, 3.0};
+
+struct report_t {
+    sim::psu::load_stats_t st;
+    uint32_t value;
+};
+
+const char *ps_name(power_share_t ps){
+    return ps == power_share_t::phaseshift ? "phase" : "equal";
+}
+
+/*
+    builds a composite of n LEDC lights, sets it to value and analyzes
+    load over one PWM period
+*/
+report_t run(power_share_t ps, uint32_t n, uint32_t percent, bool csv){
+    std::vector<float> power;
+    CompositeLight *cl = nullptr;
+    for (uint32_t i = 0; i != n; ++i){
+        power.push_back(light_power[i % (sizeof(light_power)/sizeof(float))]);
+        LEDCLight *l = new LEDCLight(i, i + 2, nullptr, luma::curve::linear, power.back());
+        l->setPWM(BENCH_PWM_BITS, BENCH_PWM_FREQ);
+        l->setDutyShift(0, 0);          // channels are reused between runs, drop the phase left by a previous one
+        if (!cl)
+            cl = new CompositeLight(l, i, ps);
+        else
+            cl->addLight(l, i);
+    }
+
+    uint32_t value = cl->getMaxValue() * percent / 100;
+    cl->goValue(value, 0);
+    sim::settle();
+
+    sim::psu::LoadAnalyzer psu(BENCH_SUPPLY_V);
+    for (uint32_t i = 0; i != n; ++i)
+        psu.add((ledc_mode_t)(i / LEDC_CHANNEL_MAX), (ledc_channel_t)(i % LEDC_CHANNEL_MAX), power[i]);
+
+    report_t r = { psu.analyze(), value };
+
+    if (csv){
+        for (auto &s : psu.profile())
+            printf("csv,%s,%u,%u,%.3f,%.3f\n", ps_name(ps), n, percent, s.t, s.load);
+    }
+
+    delete cl;
+    return r;
+}
+
+}   // namespace
+
+
+int main(int argc, char *argv[]){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    bool csv = argc > 1 && !strcmp(argv[1], "--csv");
+    const uint32_t light_counts[] = {2, 3, 4, 8, 16};
+    const uint32_t percents[] = {10, 25, 33, 50, 66, 75, 90};
+    int regressions = 0;
+
+    printf("PSU load at %.0fV, %d Hz PWM      | %-30s | %-30s |\n", BENCH_SUPPLY_V, BENCH_PWM_FREQ, "equal", "phaseshift");
+    printf("%6s %4s %6s %8s | %7s %7s %6s %6s | %7s %7s %6s %6s |\n",
+        "lights", "brt%", "duty", "avg,W", "peak,W", "rippl,W", "rms,W", "peak,A", "peak,W", "rippl,W", "rms,W", "peak,A");
+
+    for (uint32_t n : light_counts){
+        for (uint32_t p : percents){
+            report_t eq = run(power_share_t::equal, n, p, csv);
+            report_t ph = run(power_share_t::phaseshift, n, p, csv);
+
+            // a small tolerance for float edges, any real regression is at least one light's power
+            bool bad = ph.st.peak > eq.st.peak + 1e-3 || ph.st.ripple > eq.st.ripple + 1e-3;
+            regressions += bad;
+
+            printf("%6u %4u %6u %8.2f | %7.2f %7.2f %6.2f %6.2f | %7.2f %7.2f %6.2f %6.2f |%s\n",
+                n, p, ph.value, ph.st.avg,
+                eq.st.peak, eq.st.ripple, eq.st.ripple_rms, eq.st.peak_current,
+                ph.st.peak, ph.st.ripple, ph.st.ripple_rms, ph.st.peak_current,
+                bad ? " REGRESSION" : "");
+        }
+    }
+
+    if (regressions)
+        printf("phase-shifted load is worse than synchronous in %d case(s)\n", regressions);
+
+    return regressions ? 1 : 0;
+}
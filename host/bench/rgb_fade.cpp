@@ -0,0 +1,194 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    RGB fade path validation
+
+    fades an RGBLight on simulated LEDC channels from red to blue and compares
+    channel duties along the fade against a float reference, that interpolates
+    the colors in OKLab space directly. The light resolves the path into a few
+    keyframes once per fade and interpolates between them on each tick, so the
+    reference is the bound of that approximation.
+    Then the same fade is halted half way: paused and resumed, stopped and
+    dimmed, retargeted. Color reached at the halt must be held, and a resumed
+    or retargeted fade must still end at the target color.
+    Returns non-zero if any duty is off by more than RGB_BENCH_MAX_ERR or a
+    halted fade check fails
+*/
+
+#include "light_rgb.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#define BENCH_FADE          2000            // ms
+#define BENCH_SAMPLES       1000
+#define BENCH_RESOLUTION    12              // bit
+#define RGB_BENCH_MAX_ERR   5               // duty units at BENCH_RESOLUTION
+#define BENCH_HOLD_ERR      (max / 256 + 1) // held color is quantized to 8 bit components
+
+namespace {
+
+struct lab_t { double L, a, b; };
+
+// ref: https://bottosson.github.io/posts/oklab/
+lab_t to_oklab(double r, double g, double b){
+    double l = cbrt(0.4122214708 * r + 0.5363325363 * g + 0.0514459929 * b);
+    double m = cbrt(0.2119034982 * r + 0.6806995451 * g + 0.1073969566 * b);
+    double s = cbrt(0.0883024619 * r + 0.2817188376 * g + 0.6299787005 * b);
+    return {0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s,
+            1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s,
+            0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s};
+}
+
+void from_oklab(lab_t c, double *rgb){
+    double l = c.L + 0.3963377774 * c.a + 0.2158037573 * c.b;
+    double m = c.L - 0.1055613458 * c.a - 0.0638541728 * c.b;
+    double s = c.L - 0.0894841775 * c.a - 1.2914855480 * c.b;
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+    rgb[0] =  4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s;
+    rgb[1] = -1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s;
+    rgb[2] = -0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s;
+}
+
+// reference channel duties at fade progress t
+void ref_duty(lab_t from, lab_t to, double t, uint32_t max, long *d){
+    double rgb[3];
+    from_oklab({from.L + (to.L - from.L) * t, from.a + (to.a - from.a) * t, from.b + (to.b - from.b) * t}, rgb);
+    for (int i = 0; i != 3; ++i)
+        d[i] = lround(std::min(1.0, std::max(0.0, rgb[i])) * max);
+}
+
+uint32_t duty(uint32_t ch){
+    return sim::ledc::channel(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch).duty;
+}
+
+bool near(uint32_t v, uint32_t ref, uint32_t err){
+    return v + err >= ref && v <= ref + err;
+}
+
+bool check(const char *name, bool ok){
+    printf("%-40s %s\n", name, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// red at full brightness, then a fade to blue run half way on the sim clock
+void half_way(RGBLight &rgb, uint32_t *d){
+    rgb.setColor({255, 0, 0}, 0);
+    rgb.goMax(0);
+    rgb.setColor({0, 0, 255}, BENCH_FADE);
+    sim::advance(BENCH_FADE * 500);
+    for (uint32_t i = 0; i != 3; ++i)
+        d[i] = duty(i);
+}
+
+}   // namespace
+
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    LEDCLight *ch[3];
+    for (uint32_t i = 0; i != 3; ++i){
+        ch[i] = new LEDCLight(i, 4 + i, nullptr, luma::curve::linear);
+        ch[i]->setPWM(BENCH_RESOLUTION, 1000);
+    }
+    RGBLight rgb(ch[0], ch[1], ch[2], nullptr, luma::curve::linear);
+    const uint32_t max = ch[0]->getMaxValue();
+
+    rgb.setColor({255, 0, 0}, 0);
+    rgb.goMax(0);
+    sim::settle();
+
+    // ticks are run by hand at exact fade times, sim clock stays at fade start
+    int64_t start = sim::now_us();
+    rgb.setColor({0, 0, 255}, BENCH_FADE);
+    sim::settle();
+
+    lab_t from = to_oklab(1, 0, 0), to = to_oklab(0, 0, 1);
+    long err = 0;
+    uint32_t worst = 0, mid[3] = {0};
+    for (uint32_t k = 0; k <= BENCH_SAMPLES; ++k){
+        rgb.tick(start + (int64_t)BENCH_FADE * 1000 * k / BENCH_SAMPLES);
+        long ref[3];
+        ref_duty(from, to, (double)k / BENCH_SAMPLES, max, ref);
+        for (uint32_t i = 0; i != 3; ++i){
+            long e = std::labs((long)duty(i) - ref[i]);
+            if (e > err){
+                err = e;
+                worst = k;
+            }
+        }
+        if (k == BENCH_SAMPLES / 2)
+            for (uint32_t i = 0; i != 3; ++i)
+                mid[i] = duty(i);
+    }
+
+    long ref[3];
+    ref_duty(from, to, 0.5, max, ref);
+    printf("red to blue in %u ms, %u bit channels, %u keyframes\n", BENCH_FADE, BENCH_RESOLUTION, RGB_FADE_SEGMENTS + 1);
+    printf("midpoint duties: %u,%u,%u, reference: %ld,%ld,%ld\n", mid[0], mid[1], mid[2], ref[0], ref[1], ref[2]);
+    printf("max deviation from OKLab reference: %ld/%u at %.1f%% of the fade, bound %u %s\n", err, max,
+        100.0 * worst / BENCH_SAMPLES, RGB_BENCH_MAX_ERR, err > RGB_BENCH_MAX_ERR ? "FAIL" : "");
+
+    bool fail = err > RGB_BENCH_MAX_ERR;
+
+    // pause holds the color reached, resume goes on to blue
+    uint32_t held[3];
+    half_way(rgb, held);
+    rgb.fadePause();
+    rgb8_t c = rgb.getColor();
+    sim::advance(BENCH_FADE * 1000);
+    bool ok = c.r && c.b && duty(0) == held[0] && duty(2) == held[2];
+    fail |= !check("pause holds the color reached", ok);
+    rgb.fadeResume();
+    sim::advance(BENCH_FADE * 1000);
+    c = rgb.getColor();
+    fail |= !check("resume ends at the target color", !c.r && c.b == 255 && !duty(0) && duty(2) == max);
+
+    // stop drops the target, brightness change keeps the hue
+    half_way(rgb, held);
+    rgb.fadeStop();
+    rgb.goValue(RGB_MAX_VALUE / 2, 0);
+    ok = true;
+    for (uint32_t i = 0; i != 3; ++i)
+        ok &= near(duty(i), held[i] / 2, BENCH_HOLD_ERR);
+    fail |= !check("stop keeps the color reached", ok);
+
+    // retarget changes brightness target only
+    half_way(rgb, held);
+    rgb.goRetarget(RGB_MAX_VALUE / 2);
+    sim::advance(BENCH_FADE * 1000);
+    fail |= !check("retarget ends at the target color", !duty(0) && near(duty(2), max / 2, 1));
+
+    return fail;
+}
@@ -0,0 +1,216 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Strip encoder validation and benchmark
+
+    sends a pseudo-random frame of a StripLight through WS2812Encoder and the
+    simulated RMT channel at a few brightness levels and compares every item on
+    the wire bit-exact against a naive reference encoder, that works from the
+    datasheet timings and float brightness scaling.
+    Double-buffered pipeline is checked against a plain one: a frame drawn into
+    the back buffer and streamed through the LUT in RMT memory sized chunks must
+    be the same on the wire as the whole frame pre-scaled and encoded at once,
+    buffers must be swapped, not copied. Peak buffer memory of both is reported.
+    Then times encoding of a 1000-pixel frame, with and without brightness LUT,
+    against the reference encoder.
+    Returns non-zero on any mismatch.
+    Run with 'encode' or 'pipeline' argument to do only one of the checks, no timing
+*/
+
+#include "light_strip.hpp"
+#include "sim_rmt.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define BENCH_PIXELS        1000
+#define BENCH_RUNS          200
+#define BENCH_GPIO          18
+
+namespace {
+
+std::vector<rmt_item32_t> wire;
+size_t max_block = 0;                       // largest block of items sent at once
+
+uint32_t ticks(uint32_t ns, uint32_t tick_hz){
+    return lround((double)ns * tick_hz / 1e9);
+}
+
+// naive encoder, GRB order, MSB first, a pulse pair per bit
+void ref_encode(const std::vector<rgb8_t> &px, uint32_t brt, uint32_t tick_hz, std::vector<rmt_item32_t> &out){
+    out.clear();
+    for (auto const &p : px){
+        const uint8_t c[3] = {p.g, p.r, p.b};
+        for (uint8_t v : c){
+            v = lround(v * brt / 255.0);
+            for (int bit = 7; bit >= 0; --bit){
+                bool one = (v >> bit) & 1;
+                rmt_item32_t it;
+                it.level0 = 1;
+                it.duration0 = ticks(one ? WS2812_T1H_NS : WS2812_T0H_NS, tick_hz);
+                it.level1 = 0;
+                it.duration1 = ticks(one ? WS2812_T1L_NS : WS2812_T0L_NS, tick_hz);
+                out.push_back(it);
+            }
+        }
+    }
+}
+
+// index of the first mismatching item, -1 if streams are equal
+long mismatch(std::vector<rmt_item32_t> const &a, std::vector<rmt_item32_t> const &b){
+    for (size_t i = 0; i != std::min(a.size(), b.size()); ++i)
+        if (a[i].val != b[i].val)
+            return i;
+    return a.size() == b.size() ? -1 : std::min(a.size(), b.size());
+}
+
+std::vector<rgb8_t> random_frame(size_t len, uint32_t seed){
+    std::vector<rgb8_t> f(len);
+    for (auto &p : f){
+        // xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        p = {(uint8_t)seed, (uint8_t)(seed >> 8), (uint8_t)(seed >> 16)};
+    }
+    return f;
+}
+
+template <typename F>
+double time_us(F f){
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i != BENCH_RUNS; ++i)
+        f();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / BENCH_RUNS;
+}
+
+}   // namespace
+
+
+int main(int argc, char *argv[]){
+    const char *only = argc > 1 ? argv[1] : nullptr;
+    bool encode = !only || !strcmp(only, "encode");
+    bool pipeline = !only || !strcmp(only, "pipeline");
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    sim::rmt::on_tx([](rmt_channel_t, const rmt_item32_t *items, size_t count){
+        wire.insert(wire.end(), items, items + count);
+        max_block = std::max(max_block, count);
+    });
+
+    StripOutputRMT out(BENCH_GPIO);
+    WS2812Encoder enc(out.getTickHz());
+    StripLight strip(BENCH_PIXELS, &enc, &out, luma::curve::linear);
+
+    std::vector<rgb8_t> frame = random_frame(BENCH_PIXELS, 0x2545f491);
+    for (size_t i = 0; i != frame.size(); ++i)
+        strip.setPixel(i, frame[i]);
+    strip.show();
+
+    bool fail = false;
+    std::vector<rmt_item32_t> ref;
+    if (encode)
+        printf("%-10s %10s %10s %10s\n", "brightness", "items", "expected", "mismatch");
+    for (uint32_t brt : {255, 128, 7, 0}){
+        if (!encode)
+            break;
+        wire.clear();
+        strip.goValue(brt, 0);          // resends the front buffer with a new LUT
+        ref_encode(frame, brt, out.getTickHz(), ref);
+        long m = mismatch(wire, ref);
+        fail |= m >= 0;
+        printf("%-10u %10zu %10zu %10ld %s\n", brt, wire.size(), ref.size(), m, m < 0 ? "" : "FAIL");
+    }
+
+    if (!pipeline)
+        return fail;
+
+    // double-buffered LUT path against a plain one, with a previous frame being the front buffer
+    const uint32_t brt = 200;
+    strip.goValue(brt, 0);
+    std::vector<rgb8_t> next = random_frame(BENCH_PIXELS, 0x9e3779b9);
+    rgb8_t *drawn = strip.framebuffer();
+    for (size_t i = 0; i != next.size(); ++i)
+        strip.setPixel(i, next[i]);
+    wire.clear();
+    max_block = 0;
+    strip.show();
+
+    std::vector<rgb8_t> scaled(next);
+    for (auto &p : scaled)
+        p = {(uint8_t)lround(p.r * brt / 255.0), (uint8_t)lround(p.g * brt / 255.0), (uint8_t)lround(p.b * brt / 255.0)};
+    std::vector<strip_symbol_t> sym(BENCH_PIXELS * enc.symbolsPerPixel());
+    size_t n = enc.encode(scaled.data(), scaled.size(), nullptr, sym.data());
+    std::vector<rmt_item32_t> whole_frame(n);
+    for (size_t i = 0; i != n; ++i)
+        whole_frame[i].val = sym[i].val;
+    long m = mismatch(wire, whole_frame);
+
+    // after a swap back buffer is the one streamed before, with the previous frame in it
+    bool swapped = strip.framebuffer() != drawn;
+    for (size_t i = 0; i != frame.size() && swapped; ++i){
+        rgb8_t p = strip.getPixel(i);
+        swapped = p.r == frame[i].r && p.g == frame[i].g && p.b == frame[i].b;
+    }
+    fail |= m >= 0 || !swapped;
+    printf("\ndouble-buffered vs plain output: %s, items %zu/%zu, buffers %s\n", m < 0 ? "equal" : "FAIL",
+        wire.size(), whole_frame.size(), swapped ? "swapped" : "FAIL, not swapped");
+
+    // peak memory: two framebuffers, LUT and a chunk of symbols vs a framebuffer and the whole symbol stream
+    size_t fb = BENCH_PIXELS * sizeof(rgb8_t);
+    size_t chunk = max_block * sizeof(rmt_item32_t);
+    size_t piped = 2 * fb + (STRIP_MAX_BRIGHTNESS + 1) + chunk;
+    size_t whole = fb + whole_frame.size() * sizeof(rmt_item32_t);
+    printf("%-16s %10s %10s %10s\n", "peak bytes", "pixels", "symbols", "total");
+    printf("%-16s %10zu %10zu %10zu\n", "double-buffered", 2 * fb + STRIP_MAX_BRIGHTNESS + 1, chunk, piped);
+    printf("%-16s %10zu %10zu %10zu\n", "plain", fb, whole - fb, whole);
+    if (only)
+        return fail;
+
+    // encoding speed, the whole frame into a materialized symbol buffer
+    uint8_t lut[STRIP_MAX_BRIGHTNESS + 1];
+    for (uint32_t i = 0; i <= STRIP_MAX_BRIGHTNESS; ++i)
+        lut[i] = (i * 128 + STRIP_MAX_BRIGHTNESS/2) / STRIP_MAX_BRIGHTNESS;
+
+    volatile uint32_t sink = 0;
+    double plain = time_us([&]{ enc.encode(frame.data(), frame.size(), nullptr, sym.data()); sink = sink + sym.back().val; });
+    double lutted = time_us([&]{ enc.encode(frame.data(), frame.size(), lut, sym.data()); sink = sink + sym.back().val; });
+    double naive = time_us([&]{ ref_encode(frame, 128, out.getTickHz(), ref); sink = sink + ref.back().val; });
+
+    printf("\nencode %u pixels, %u runs\n", BENCH_PIXELS, BENCH_RUNS);
+    printf("%-16s %10s %10s\n", "", "us/frame", "ns/pixel");
+    printf("%-16s %10.1f %10.1f\n", "encoder", plain, plain * 1000 / BENCH_PIXELS);
+    printf("%-16s %10.1f %10.1f\n", "encoder + LUT", lutted, lutted * 1000 / BENCH_PIXELS);
+    printf("%-16s %10.1f %10.1f\n", "reference", naive, naive * 1000 / BENCH_PIXELS);
+    printf("frame time on the wire at 800 kHz: %.1f ms\n", BENCH_PIXELS * 24 * 1.25 / 1000);
+
+    return fail;
+}
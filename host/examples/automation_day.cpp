@@ -0,0 +1,158 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Automation demo
+    runs a day of an office on a simulated clock: a corridor on a schedule and
+    a room with an occupancy sensor and open loop daylight harvesting.
+    Synthetic sensor readings are posted to the event loop, each command issued
+    by the engine is printed with the time of day it was posted at.
+    Returns non-zero if commands differ from the expected ones
+*/
+
+#include "lightmanager.hpp"
+#include "light_automation.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#define GRP_CORRIDOR        10
+#define GRP_ROOM            20
+#define SENSOR_PRESENCE     1
+#define SENSOR_LUX          2
+
+#define HMS(h, m, s)        ((h) * 3600 + (m) * 60 + (s))
+
+namespace {
+
+struct reading_t {
+    uint32_t tod;           // s
+    int32_t sensor;
+    sensor_t type;
+    int32_t value;
+};
+
+struct command_t {
+    uint32_t tod;           // s
+    int32_t gid;
+    uint32_t level;         // %
+};
+
+// a day of synthetic sensor readings
+const reading_t day[] = {
+    {HMS( 8, 30,  0), SENSOR_LUX,       sensor_t::lux,          100},
+    {HMS( 8, 30,  5), SENSOR_PRESENCE,  sensor_t::occupancy,    1},
+    {HMS( 9,  0,  0), SENSOR_LUX,       sensor_t::lux,          200},
+    {HMS(10,  0,  0), SENSOR_LUX,       sensor_t::lux,          305},
+    {HMS(10,  0, 30), SENSOR_LUX,       sensor_t::lux,          298},       // noise, no command expected
+    {HMS(10,  1,  0), SENSOR_LUX,       sensor_t::lux,          310},
+    {HMS(11,  0,  0), SENSOR_LUX,       sensor_t::lux,          450},
+    {HMS(12,  0,  0), SENSOR_PRESENCE,  sensor_t::occupancy,    0},         // lunch, room goes off after a timeout
+    {HMS(12,  2,  0), SENSOR_PRESENCE,  sensor_t::occupancy,    1},         // back within a timeout, no command expected
+    {HMS(12,  3,  0), SENSOR_PRESENCE,  sensor_t::occupancy,    0},
+    {HMS(13,  0,  0), SENSOR_LUX,       sensor_t::lux,          600},
+    {HMS(13,  0,  5), SENSOR_PRESENCE,  sensor_t::occupancy,    1},         // enough daylight, room stays off
+    {HMS(17,  0,  0), SENSOR_LUX,       sensor_t::lux,          250},
+    {HMS(18,  0,  0), SENSOR_LUX,       sensor_t::lux,          50},
+    {HMS(19,  0,  0), SENSOR_PRESENCE,  sensor_t::occupancy,    0},
+    {HMS(19,  2,  0), SENSOR_PRESENCE,  sensor_t::lux,          1},         // wrong type, ignored, room goes off on time
+};
+
+// commands the engine is expected to post for the day above
+const command_t expected[] = {
+    {HMS( 6,  0,  0), GRP_CORRIDOR,   0},
+    {HMS( 6,  0,  0), GRP_ROOM,       0},
+    {HMS( 7,  0,  0), GRP_CORRIDOR,  30},
+    {HMS( 8, 30,  6), GRP_ROOM,      80},
+    {HMS( 9,  0,  1), GRP_ROOM,      60},
+    {HMS(10,  0,  1), GRP_ROOM,      40},
+    {HMS(11,  0,  1), GRP_ROOM,      10},
+    {HMS(12,  8,  1), GRP_ROOM,       0},
+    {HMS(17,  0,  1), GRP_ROOM,      50},
+    {HMS(18,  0,  1), GRP_ROOM,      90},
+    {HMS(19,  5,  1), GRP_ROOM,       0},
+    {HMS(22,  0,  0), GRP_CORRIDOR,   0},
+};
+
+Automation *engine;
+std::vector<command_t> posted;
+
+void cmd_printer(void* /*handler_args*/, esp_event_base_t /*base*/, int32_t gid, void* event_data){
+    auto cmd = reinterpret_cast<local_cmd_evt*>(event_data);
+    uint32_t t = engine->getTimeOfDay();
+    printf("%02u:%02u:%02u group %d -> %u%%\n", t / 3600, t / 60 % 60, t % 60, gid, cmd->value);
+    posted.push_back({t, gid, cmd->value});
+}
+
+}   // namespace
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    FadeCtrl fc;
+    EcloGroup corridor(GRP_CORRIDOR), room(GRP_ROOM);
+    Eclo c1(new LEDCLight(0, 4, &fc), 1), c2(new LEDCLight(1, 5, &fc), 2), r1(new LEDCLight(2, 6, &fc), 3);
+    corridor.add(&c1);
+    corridor.add(&c2);
+    room.add(&r1);
+
+    esp_event_handler_instance_t inst;
+    esp_event_handler_instance_register_with(*lightmgr::get_light_evts_loop(), LCMD_EVENTS, ESP_EVENT_ANY_ID, cmd_printer, nullptr, &inst);
+
+    Automation a;
+    engine = &a;
+    a.addSchedule(GRP_CORRIDOR, HMS(7, 0, 0), HMS(22, 0, 0), 30);
+    // occupancy rule with zero level is a gate for daylight rule, that sets the level
+    int presence = a.addOccupancy(GRP_ROOM, SENSOR_PRESENCE, 300, 0);
+    a.addDaylight(GRP_ROOM, SENSOR_LUX, 500, 100, presence);
+    a.setTimeOfDay(HMS(6, 0, 0));
+    a.start();
+
+    for (auto const &r : day){
+        sim::advance((int64_t)(r.tod - a.getTimeOfDay()) * 1000000);
+        local_sensor_evt e = {r.type, r.value};
+        esp_event_post_to(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, r.sensor, &e, sizeof(e), portMAX_DELAY);
+    }
+    sim::advance((int64_t)(HMS(23, 59, 59) - a.getTimeOfDay()) * 1000000);
+
+    const size_t nexp = sizeof(expected) / sizeof(expected[0]);
+    bool fail = posted.size() != nexp;
+    for (size_t i = 0; i != std::min(posted.size(), nexp); ++i){
+        auto const &p = posted[i], &x = expected[i];
+        if (p.tod != x.tod || p.gid != x.gid || p.level != x.level){
+            printf("command %zu: %us group %d -> %u%%, expected %us group %d -> %u%%\n", i, p.tod, p.gid, p.level, x.tod, x.gid, x.level);
+            fail = true;
+        }
+    }
+
+    printf("sensor readings: %u, commands: %zu, expected: %zu, room duty: %u %s\n", (unsigned)(sizeof(day) / sizeof(day[0])), posted.size(), nexp,
+        sim::ledc::channel(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_2).duty, fail ? "FAIL" : "");
+    return fail;
+}
@@ -0,0 +1,108 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Circadian scheduler demo
+    runs a day of a circadian schedule on a simulated clock: a tunable white
+    fixture and a composite of two more under a shared power budget. Prints
+    brightness, CCT and the power drawn by LEDC channels every hour, and the
+    number of times the scheduler was woken up. Fades as long as a day table step
+    are run by the software engine, LEDC hardware can't run them
+*/
+
+#include "light_circadian.hpp"
+#include "light_cct.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include <cstdio>
+
+#define DEMO_CH_POWER       10.0f           // W, fixture channel at full duty
+#define DEMO_CH_POWER_SMALL 6.0f            // W, composite fixtures' channels at full duty
+#define DEMO_BUDGET         18.0f           // W
+#define DEMO_TICK           1000            // ms, software fade update period
+#define DEMO_START          (5 * 3600 + 30 * 60)    // s, time of day
+
+namespace {
+
+// power drawn by a channel at the current sim time
+float ch_power(ledc_channel_t ch, float pmax){
+    auto c = sim::ledc::channel(LEDC_HIGH_SPEED_MODE, ch);
+    auto t = sim::ledc::timer(LEDC_HIGH_SPEED_MODE, c.timer);
+    return t.bits ? pmax * c.duty / (1U << t.bits) : 0;
+}
+
+}   // namespace
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    // a step long fade needs no frequent updates
+    LightTicker::getInstance()->setPeriod(DEMO_TICK);
+    FadeCtrl fc;
+    CCTLight desk(new LEDCLight(0, 4, &fc, luma::curve::linear, DEMO_CH_POWER, fade_engine_t::software), new LEDCLight(1, 5, &fc, luma::curve::linear, DEMO_CH_POWER, fade_engine_t::software));
+    CompositeLight ceiling(new CCTLight(new LEDCLight(2, 6, &fc, luma::curve::linear, DEMO_CH_POWER_SMALL, fade_engine_t::software), new LEDCLight(3, 7, &fc, luma::curve::linear, DEMO_CH_POWER_SMALL, fade_engine_t::software)), 1, power_share_t::equal);
+    ceiling.addLight(new CCTLight(new LEDCLight(4, 8, &fc, luma::curve::linear, DEMO_CH_POWER_SMALL, fade_engine_t::software), new LEDCLight(5, 9, &fc, luma::curve::linear, DEMO_CH_POWER_SMALL, fade_engine_t::software)), 2);
+
+    CircadianScheduler cs;
+    cs.addLight(&desk);
+    cs.addLight(&ceiling);
+    cs.setPowerBudget(DEMO_BUDGET);
+    cs.setTimeOfDay(DEMO_START);
+    cs.start();
+
+    printf("max power: %.1fW, budget: %.1fW, day table: %u entries\n", desk.getMaxPower() + ceiling.getMaxPower(), DEMO_BUDGET, cs.size());
+    printf("%-6s %8s %8s %10s %8s %9s\n", "time", "desk,%", "desk,K", "ceiling,K", "power,W", "wakeups");
+
+    bool over = false;
+    uint32_t woken = 0, max_hourly = 0;
+    for (uint32_t h = 0; h != 24; ++h){
+        // power is checked each minute, fades run in between
+        float pmax = 0;
+        for (uint32_t m = 0; m != 60; ++m){
+            sim::advance(60 * 1000000LL);
+            float p = 0;
+            for (int ch = 0; ch != 2; ++ch)
+                p += ch_power((ledc_channel_t)ch, DEMO_CH_POWER);
+            for (int ch = 2; ch != 6; ++ch)
+                p += ch_power((ledc_channel_t)ch, DEMO_CH_POWER_SMALL);
+            if (p > pmax)
+                pmax = p;
+        }
+        over |= pmax > DEMO_BUDGET * 1.01f;
+
+        uint32_t t = cs.getTimeOfDay();
+        uint32_t w = cs.getWakeups() - woken;
+        woken = cs.getWakeups();
+        if (h && w > max_hourly)
+            max_hourly = w;             // the first hour has a catch up fade
+        printf("%02u:%02u %8u %8u %10u %8.1f %9u\n", t / 3600, t / 60 % 60, desk.getValueScaled(DEFAULT_SCALE), desk.getCCT(), ceiling.getCCT(), pmax, w);
+    }
+
+    printf("scheduler wakeups: %u, max per hour: %u, power budget %s\n", cs.getWakeups(), max_hourly, over ? "EXCEEDED" : "held");
+    return over;
+}
@@ -0,0 +1,70 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Host simulation demo
+    runs the whole command path Eclo -> GenericLight -> FadeCtrl -> PWMCtl
+    on a simulated clock and prints LEDC duty as the fade goes,
+    built with LIGHTMGR_TRACE it also writes trace.json for chrome://tracing
+*/
+
+#include "lightmanager.hpp"
+#include "light_drv_ledc.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+#include "light_trace.hpp"
+#include <cstdio>
+
+int main(){
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    FadeCtrl fc;
+    Eclo unit(new LEDCLight(0, 4, &fc), 1);
+
+    local_cmd_evt cmd = {};
+    cmd.event = light_event_id_t::goValue;
+    cmd.id = {ID_ANONYMOUS, 1};
+    cmd.value = 512;
+    cmd.fade_duration = 100;
+    // command events are posted with a group id, unit is subscribed to it's own id group by default
+    esp_event_post_to(*lightmgr::get_light_evts_loop(), LCMD_EVENTS, 1, &cmd, sizeof(cmd), portMAX_DELAY);
+
+    for (int i = 0; i != 12; ++i){
+        sim::advance(10000);
+        printf("t=%6lldms duty: %u\n", (long long)sim::now_us()/1000, sim::ledc::channel(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0).duty);
+    }
+
+#ifdef LIGHTMGR_TRACE
+    lighttrace::enable(false);
+    if (FILE *f = fopen("trace.json", "w")){
+        printf("trace events: %u\n", (unsigned)lighttrace::dump(f));
+        fclose(f);
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Host simulation stand-in for LinkedList library
+    https://github.com/vortigont/LinkedList
+
+    provides the same API subset as the original LList<T> container
+    on top of std::list, used only when the original library is not available
+*/
+
+#pragma once
+#include <list>
+#include <iterator>
+
+template <typename T>
+class LList {
+    std::list<T> l;
+
+    typename std::list<T>::iterator at(int index){ auto i = l.begin(); std::advance(i, index); return i; }
+
+public:
+    typedef typename std::list<T>::iterator iterator;
+    typedef typename std::list<T>::const_iterator const_iterator;
+
+    int size() const { return l.size(); }
+
+    bool add(int index, T v){
+        if (index < 0 || index > size()) return false;
+        l.insert(at(index), std::move(v));
+        return true;
+    }
+    bool add(T v){ l.push_back(std::move(v)); return true; }
+    bool unshift(T v){ l.push_front(std::move(v)); return true; }
+    bool set(int index, T v){
+        if (index < 0 || index >= size()) return false;
+        *at(index) = std::move(v);
+        return true;
+    }
+
+    T remove(int index){
+        if (index < 0 || index >= size()) return T();
+        auto i = at(index);
+        T v = std::move(*i);
+        l.erase(i);
+        return v;
+    }
+    T pop(){
+        if (l.empty()) return T();
+        T v = std::move(l.back());
+        l.pop_back();
+        return v;
+    }
+    T shift(){
+        if (l.empty()) return T();
+        T v = std::move(l.front());
+        l.pop_front();
+        return v;
+    }
+
+    T get(int index){ return (index < 0 || index >= size()) ? T() : *at(index); }
+    T& head(){ return l.front(); }
+    T const& head() const { return l.front(); }
+    T& tail(){ return l.back(); }
+    T const& tail() const { return l.back(); }
+    void clear(){ l.clear(); }
+
+    template <typename Compare>
+    void sort(Compare cmp){ l.sort(cmp); }
+
+    iterator begin(){ return l.begin(); }
+    iterator end(){ return l.end(); }
+    const_iterator begin() const { return l.cbegin(); }
+    const_iterator end() const { return l.cend(); }
+    const_iterator cbegin() const { return l.cbegin(); }
+    const_iterator cend() const { return l.cend(); }
+};
@@ -0,0 +1,138 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Host simulation core
+
+All the stand-in primitives (tasks, event groups, semaphores, event loops,
+peripheral timers) share one global lock and one simulated clock.
+Every sim task is a real thread, but scheduler keeps track of runnable tasks,
+so that a caller could wait for the whole system to settle before moving
+the clock forward. This makes runs on a manual clock deterministic.
+*/
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace sim {
+
+enum class clock_mode_t:uint8_t {
+    manual,         // clock moves only with sim::advance() calls
+    realtime        // clock follows host's monotonic clock
+};
+
+/**
+ * @brief switch clock mode
+ * must be called before any tasks are started
+ */
+void clock_mode(clock_mode_t m);
+clock_mode_t clock_mode();
+
+/**
+ * @brief simulated time since start, us
+ */
+int64_t now_us();
+
+/**
+ * @brief move simulated clock forward (manual mode only)
+ * clock jumps from one scheduled event to another, all expired timers are fired
+ * and the system is settled on each step
+ *
+ * @param us - time to advance, us
+ */
+void advance(int64_t us);
+
+/**
+ * @brief block until all sim tasks are waiting on something
+ *
+ */
+void settle();
+
+
+// *** internal primitives for stand-in implementations *** //
+
+// thrown into a task's context when the task has been deleted
+struct task_deleted {};
+
+/**
+ * @brief global simulation lock
+ * all stand-in objects state must be accessed with this lock held
+ */
+std::mutex &lock();
+
+/**
+ * @brief wait for a predicate to become true
+ * must be called with global lock held
+ *
+ * @param lk - global lock
+ * @param pred - predicate, evaluated with a lock held
+ * @param deadline_us - absolute timeout on simulated clock, <0 - wait forever
+ * @return true if predicate is true
+ * @return false on timeout
+ */
+bool wait(std::unique_lock<std::mutex> &lk, std::function<bool()> pred, int64_t deadline_us = -1);
+
+/**
+ * @brief reevaluate waiters
+ * must be called with global lock held after any change of the shared state
+ */
+void kick();
+
+/**
+ * @brief schedule a one-shot timer on simulated clock
+ * callback is executed without global lock held, from a "hardware" context
+ * must be called with global lock held
+ *
+ * @return uint32_t timer id
+ */
+uint32_t timer_add(int64_t due_us, std::function<void()> cb);
+void timer_cancel(uint32_t id);
+
+/**
+ * @brief run a function as a sim task in a new thread
+ * task is accounted as runnable until it blocks on any sim primitive
+ *
+ * @param handle - opaque task handle, must stay valid forever
+ * @param body - task function
+ */
+void task_spawn(void *handle, std::function<void()> body);
+
+/**
+ * @brief mark task as deleted
+ * the task will be terminated at it's next blocking call
+ * must be called with global lock held
+ */
+void task_delete(void *handle);
+
+/**
+ * @brief get current task handle
+ * @return void* task handle or nullptr if called from a non-task thread
+ */
+void *task_current();
+
+}   // namespace sim
@@ -0,0 +1,296 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "sim.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace sim {
+
+namespace {
+
+struct Waiter {
+    std::function<bool()> pred;
+    int64_t deadline;
+    void *task;
+    bool ready;
+};
+
+struct Timer {
+    int64_t due;
+    std::function<void()> cb;
+};
+
+/*
+    all the state is allocated on heap and never freed, detached task threads
+    might still be blocked on it when the process exits
+*/
+struct Core {
+    std::mutex mtx;
+    std::condition_variable cv;             // waiters wake-up
+    std::condition_variable settle_cv;      // busy counter changes
+    std::condition_variable timer_cv;       // realtime timer thread
+    std::list<Waiter*> waiters;
+    std::set<void*> deleted;
+    std::map<uint32_t, Timer> timers;
+    uint32_t timer_id = 0;
+    int busy = 0;                           // number of runnable sim tasks
+    clock_mode_t mode = clock_mode_t::manual;
+    std::atomic<int64_t> manual_now{0};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool timer_thread = false;
+};
+
+Core &core(){
+    static Core *c = new Core;
+    return *c;
+}
+
+thread_local void *current_task = nullptr;
+
+bool is_deleted(void *task){
+    return task && core().deleted.count(task);
+}
+
+void task_busy(int d){
+    Core &c = core();
+    c.busy += d;
+    if (!c.busy)
+        c.settle_cv.notify_all();
+}
+
+// fire expired timers, must be called without a lock
+void fire_timers(){
+    for (;;){
+        std::function<void()> cb;
+        {
+            std::lock_guard<std::mutex> lk(core().mtx);
+            int64_t now = now_us();
+            for (auto i = core().timers.begin(); i != core().timers.end(); ++i){
+                if (i->second.due <= now){
+                    cb = std::move(i->second.cb);
+                    core().timers.erase(i);
+                    break;
+                }
+            }
+        }
+        if (!cb)
+            return;
+        cb();
+        std::lock_guard<std::mutex> lk(core().mtx);
+        kick();
+    }
+}
+
+void timer_thread(){
+    Core &c = core();
+    for (;;){
+        {
+            std::unique_lock<std::mutex> lk(c.mtx);
+            int64_t next = INT64_MAX;
+            for (auto &t : c.timers)
+                next = std::min(next, t.second.due);
+
+            if (next == INT64_MAX)
+                c.timer_cv.wait(lk);
+            else if (next > now_us())
+                c.timer_cv.wait_until(lk, c.start + std::chrono::microseconds(next));
+        }
+        fire_timers();
+    }
+}
+
+}   // namespace
+
+
+void clock_mode(clock_mode_t m){
+    core().mode = m;
+}
+
+clock_mode_t clock_mode(){
+    return core().mode;
+}
+
+int64_t now_us(){
+    Core &c = core();
+    if (c.mode == clock_mode_t::manual)
+        return c.manual_now.load();
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c.start).count();
+}
+
+std::mutex &lock(){
+    return core().mtx;
+}
+
+bool wait(std::unique_lock<std::mutex> &lk, std::function<bool()> pred, int64_t deadline_us){
+    Core &c = core();
+    Waiter w{ std::move(pred), deadline_us, current_task, false };
+
+    for (;;){
+        if (is_deleted(w.task))
+            throw task_deleted();
+
+        if (w.pred())
+            return true;
+
+        if (w.deadline >= 0 && now_us() >= w.deadline)
+            return false;
+
+        w.ready = false;
+        c.waiters.push_back(&w);
+        if (w.task)
+            task_busy(-1);
+
+        if (c.mode == clock_mode_t::realtime && w.deadline >= 0){
+            while (!w.ready){
+                if (c.cv.wait_until(lk, c.start + std::chrono::microseconds(w.deadline)) == std::cv_status::timeout && !w.ready){
+                    w.ready = true;
+                    if (w.task)
+                        task_busy(1);
+                }
+            }
+        } else
+            c.cv.wait(lk, [&w]{ return w.ready; });
+
+        c.waiters.remove(&w);
+    }
+}
+
+void kick(){
+    Core &c = core();
+    int64_t now = now_us();
+    bool woken = false;
+    for (auto w : c.waiters){
+        if (w->ready)
+            continue;
+
+        if (is_deleted(w->task) || (w->deadline >= 0 && now >= w->deadline) || w->pred()){
+            w->ready = true;
+            woken = true;
+            if (w->task)
+                task_busy(1);
+        }
+    }
+    if (woken)
+        c.cv.notify_all();
+}
+
+void settle(){
+    std::unique_lock<std::mutex> lk(core().mtx);
+    core().settle_cv.wait(lk, []{ return core().busy == 0; });
+}
+
+void advance(int64_t us){
+    Core &c = core();
+    if (c.mode != clock_mode_t::manual)
+        return;
+
+    int64_t target = c.manual_now.load() + us;
+
+    for (;;){
+        settle();
+        {
+            std::lock_guard<std::mutex> lk(c.mtx);
+            int64_t now = c.manual_now.load();
+            int64_t next = target;
+            for (auto &t : c.timers)
+                next = std::min(next, t.second.due);
+            for (auto w : c.waiters)
+                if (!w->ready && w->deadline > now)
+                    next = std::min(next, w->deadline);
+
+            if (next > now)
+                c.manual_now.store(next);
+            kick();
+        }
+        fire_timers();
+        settle();
+
+        std::lock_guard<std::mutex> lk(c.mtx);
+        if (c.manual_now.load() < target)
+            continue;
+        bool due = false;
+        for (auto &t : c.timers)
+            due |= t.second.due <= target;
+        if (!due)
+            return;
+    }
+}
+
+uint32_t timer_add(int64_t due_us, std::function<void()> cb){
+    Core &c = core();
+    uint32_t id = ++c.timer_id;
+    c.timers[id] = Timer{ due_us, std::move(cb) };
+
+    if (c.mode == clock_mode_t::realtime){
+        if (!c.timer_thread){
+            c.timer_thread = true;
+            std::thread(timer_thread).detach();
+        }
+        c.timer_cv.notify_all();
+    }
+    return id;
+}
+
+void timer_cancel(uint32_t id){
+    core().timers.erase(id);
+}
+
+void task_spawn(void *handle, std::function<void()> body){
+    {
+        std::lock_guard<std::mutex> lk(core().mtx);
+        task_busy(1);
+    }
+
+    std::thread([handle, body](){
+        current_task = handle;
+        try {
+            body();
+        } catch (const task_deleted&) {}
+
+        std::lock_guard<std::mutex> lk(core().mtx);
+        task_busy(-1);
+    }).detach();
+}
+
+void task_delete(void *handle){
+    core().deleted.insert(handle);
+    kick();
+}
+
+void *task_current(){
+    return current_task;
+}
+
+}   // namespace sim
@@ -0,0 +1,201 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// esp_event stand-in: user event loops
+
+#include "sim.hpp"
+#include "esp_event.h"
+#include "freertos/task.h"
+#include <cstring>
+#include <deque>
+#include <list>
+#include <vector>
+
+namespace {
+
+struct Handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t fn;
+    void *arg;
+    bool removed;
+};
+
+struct Event {
+    esp_event_base_t base;
+    int32_t id;
+    std::vector<uint8_t> data;
+};
+
+struct Loop {
+    size_t qsize;
+    std::deque<Event> q;
+    std::list<Handler*> handlers;       // handlers are never freed, instance handle might be used after unregister
+    TaskHandle_t task = nullptr;
+    bool deleted = false;
+};
+
+/*
+ * bases are compared by pointer value like ESP-IDF does, but string comparision
+ * is a fallback for bases defined in different translation units
+ */
+bool base_match(esp_event_base_t h, esp_event_base_t e){
+    return h == ESP_EVENT_ANY_BASE || h == e || (h && e && !strcmp(h, e));
+}
+
+// pick one event from the queue and run handlers, returns false on timeout
+bool dispatch(Loop *l, int64_t deadline){
+    Event e;
+    std::vector<Handler*> run;
+    {
+        std::unique_lock<std::mutex> lk(sim::lock());
+        if (!sim::wait(lk, [l]{ return !l->q.empty() || l->deleted; }, deadline) || l->q.empty())
+            return false;
+
+        e = std::move(l->q.front());
+        l->q.pop_front();
+        sim::kick();        // queue has space now
+
+        for (auto h : l->handlers)
+            if (!h->removed && base_match(h->base, e.base) && (h->id == ESP_EVENT_ANY_ID || h->id == e.id))
+                run.push_back(h);
+    }
+
+    for (auto h : run){
+        if (!h->removed)
+            h->fn(h->arg, e.base, e.id, e.data.empty() ? nullptr : e.data.data());
+    }
+    return true;
+}
+
+void loop_task(void *arg){
+    Loop *l = static_cast<Loop*>(arg);
+    while (!l->deleted)
+        dispatch(l, -1);
+    vTaskDelete(NULL);
+}
+
+}   // namespace
+
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *args, esp_event_loop_handle_t *event_loop){
+    if (!args || !event_loop)
+        return ESP_ERR_INVALID_ARG;
+
+    Loop *l = new Loop;
+    l->qsize = args->queue_size;
+    *event_loop = l;
+
+    if (args->task_name)
+        xTaskCreate(loop_task, args->task_name, args->task_stack_size, l, args->task_priority, &l->task);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop){
+    Loop *l = static_cast<Loop*>(event_loop);
+    std::lock_guard<std::mutex> lk(sim::lock());
+    l->deleted = true;      // loop object is leaked, it's task might still refer to it
+    sim::kick();
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run){
+    Loop *l = static_cast<Loop*>(event_loop);
+    int64_t end = ticks_to_run == portMAX_DELAY ? -1 : sim::now_us() + (int64_t)ticks_to_run * 1000 * portTICK_PERIOD_MS;
+    while (dispatch(l, end)){}
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance){
+    if (!event_loop || !event_handler)
+        return ESP_ERR_INVALID_ARG;
+
+    Loop *l = static_cast<Loop*>(event_loop);
+    Handler *h = new Handler{ event_base, event_id, event_handler, event_handler_arg, false };
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    l->handlers.push_back(h);
+    if (instance)
+        *instance = h;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg){
+    return esp_event_handler_instance_register_with(event_loop, event_base, event_id, event_handler, event_handler_arg, nullptr);
+}
+
+esp_err_t esp_event_handler_instance_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t /*event_base*/, int32_t /*event_id*/, esp_event_handler_instance_t instance){
+    if (!event_loop || !instance)
+        return ESP_ERR_INVALID_ARG;
+
+    Loop *l = static_cast<Loop*>(event_loop);
+    std::lock_guard<std::mutex> lk(sim::lock());
+    for (auto i = l->handlers.begin(); i != l->handlers.end(); ++i){
+        if (*i == instance){
+            (*i)->removed = true;
+            l->handlers.erase(i);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler){
+    if (!event_loop)
+        return ESP_ERR_INVALID_ARG;
+
+    Loop *l = static_cast<Loop*>(event_loop);
+    std::lock_guard<std::mutex> lk(sim::lock());
+    for (auto i = l->handlers.begin(); i != l->handlers.end(); ++i){
+        if ((*i)->fn == event_handler && (*i)->base == event_base && (*i)->id == event_id){
+            (*i)->removed = true;
+            l->handlers.erase(i);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size, TickType_t ticks_to_wait){
+    if (!event_loop)
+        return ESP_ERR_INVALID_ARG;
+
+    Loop *l = static_cast<Loop*>(event_loop);
+    int64_t deadline = ticks_to_wait == portMAX_DELAY ? -1 : sim::now_us() + (int64_t)ticks_to_wait * 1000 * portTICK_PERIOD_MS;
+
+    std::unique_lock<std::mutex> lk(sim::lock());
+    if (!sim::wait(lk, [l]{ return l->q.size() < l->qsize; }, deadline))
+        return ESP_ERR_TIMEOUT;
+
+    Event e{ event_base, event_id, {} };
+    if (event_data && event_data_size)
+        e.data.assign(static_cast<const uint8_t*>(event_data), static_cast<const uint8_t*>(event_data) + event_data_size);
+
+    l->q.push_back(std::move(e));
+    sim::kick();
+    return ESP_OK;
+}
@@ -0,0 +1,294 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// FreeRTOS stand-in: tasks, notifications, event groups, semaphores
+
+#include "sim.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include <string>
+
+struct sim_task_t {
+    std::string name;
+    uint32_t notify = 0;
+};
+
+struct sim_event_group_t {
+    EventBits_t bits = 0;
+};
+
+struct sim_semaphore_t {
+    UBaseType_t count;
+    UBaseType_t max;
+    bool mutex;
+    void *owner = nullptr;
+    UBaseType_t recursion = 0;
+};
+
+namespace {
+
+// convert ticks to an absolute deadline on sim clock
+int64_t deadline(TickType_t ticks){
+    if (ticks == portMAX_DELAY)
+        return -1;
+    return sim::now_us() + (int64_t)ticks * 1000 * portTICK_PERIOD_MS;
+}
+
+sim_task_t *current(){
+    static sim_task_t *main_task = new sim_task_t{ "main" };
+    void *t = sim::task_current();
+    return t ? static_cast<sim_task_t*>(t) : main_task;
+}
+
+}   // namespace
+
+
+// critical sections are mapped to a single recursive host lock
+static std::recursive_mutex &crit_mtx(){
+    static std::recursive_mutex *m = new std::recursive_mutex;
+    return *m;
+}
+
+void vPortEnterCritical(portMUX_TYPE *){ crit_mtx().lock(); }
+void vPortExitCritical(portMUX_TYPE *){ crit_mtx().unlock(); }
+
+
+// *** Tasks *** //
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t /*usStackDepth*/, void *pvParameters, UBaseType_t /*uxPriority*/, TaskHandle_t *pxCreatedTask){
+    sim_task_t *t = new sim_task_t{ pcName ? pcName : "" };     // handles are never freed
+    if (pxCreatedTask)
+        *pxCreatedTask = t;
+
+    sim::task_spawn(t, [pvTaskCode, pvParameters](){ pvTaskCode(pvParameters); });
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask, BaseType_t /*xCoreID*/){
+    return xTaskCreate(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete){
+    if (!xTaskToDelete || xTaskToDelete == sim::task_current()){
+        if (sim::task_current())
+            throw sim::task_deleted();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    sim::task_delete(xTaskToDelete);
+}
+
+/*
+ * on a manual clock only sim tasks are waiting for time to pass,
+ * a delay called from a host thread (i.e. main()) moves the clock itself
+ */
+void vTaskDelay(const TickType_t xTicksToDelay){
+    if (!sim::task_current() && sim::clock_mode() == sim::clock_mode_t::manual)
+        return sim::advance((int64_t)xTicksToDelay * 1000 * portTICK_PERIOD_MS);
+
+    std::unique_lock<std::mutex> lk(sim::lock());
+    sim::wait(lk, []{ return false; }, deadline(xTicksToDelay));
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, const TickType_t xTimeIncrement){
+    *pxPreviousWakeTime += xTimeIncrement;
+    if (!sim::task_current() && sim::clock_mode() == sim::clock_mode_t::manual){
+        int64_t t = (int64_t)*pxPreviousWakeTime * 1000 * portTICK_PERIOD_MS - sim::now_us();
+        return sim::advance(t > 0 ? t : 0);
+    }
+
+    std::unique_lock<std::mutex> lk(sim::lock());
+    sim::wait(lk, []{ return false; }, (int64_t)*pxPreviousWakeTime * 1000 * portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCount(void){
+    return sim::now_us() / 1000 / portTICK_PERIOD_MS;
+}
+
+TickType_t xTaskGetTickCountFromISR(void){
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+    return current();
+}
+
+const char *pcTaskGetName(TaskHandle_t xTaskToQuery){
+    return (xTaskToQuery ? xTaskToQuery : current())->name.c_str();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ++xTaskToNotify->notify;
+    sim::kick();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken){
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken)
+        *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait){
+    sim_task_t *t = current();
+    std::unique_lock<std::mutex> lk(sim::lock());
+    sim::wait(lk, [t]{ return t->notify != 0; }, deadline(xTicksToWait));
+    uint32_t v = t->notify;
+    if (v)
+        t->notify = xClearCountOnExit ? 0 : v - 1;
+    return v;
+}
+
+
+// *** Event groups *** //
+
+EventGroupHandle_t xEventGroupCreate(void){
+    return new sim_event_group_t;
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup){
+    delete xEventGroup;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eg, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait){
+    std::unique_lock<std::mutex> lk(sim::lock());
+    bool ok = sim::wait(lk, [eg, uxBitsToWaitFor, xWaitForAllBits]{
+        return xWaitForAllBits ? (eg->bits & uxBitsToWaitFor) == uxBitsToWaitFor : (eg->bits & uxBitsToWaitFor) != 0;
+    }, deadline(xTicksToWait));
+
+    EventBits_t v = eg->bits;
+    if (ok && xClearOnExit)
+        eg->bits &= ~uxBitsToWaitFor;
+    return v;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eg, const EventBits_t uxBitsToSet){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    eg->bits |= uxBitsToSet;
+    sim::kick();
+    return eg->bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t eg, const EventBits_t uxBitsToSet, BaseType_t *pxHigherPriorityTaskWoken){
+    xEventGroupSetBits(eg, uxBitsToSet);
+    if (pxHigherPriorityTaskWoken)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eg, const EventBits_t uxBitsToClear){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    EventBits_t v = eg->bits;
+    eg->bits &= ~uxBitsToClear;
+    return v;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eg){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return eg->bits;
+}
+
+
+// *** Semaphores *** //
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+    return new sim_semaphore_t{ 1, 1, true };
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void){
+    return new sim_semaphore_t{ 1, 1, true };
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+    return new sim_semaphore_t{ 0, 1, false };
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount){
+    return new sim_semaphore_t{ uxInitialCount, uxMaxCount, false };
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore){
+    delete xSemaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t xTicksToWait){
+    std::unique_lock<std::mutex> lk(sim::lock());
+    if (!sim::wait(lk, [s]{ return s->count > 0; }, deadline(xTicksToWait)))
+        return pdFALSE;
+    --s->count;
+    if (s->mutex)
+        s->owner = current();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (s->count >= s->max)
+        return pdFALSE;
+    ++s->count;
+    s->owner = nullptr;
+    sim::kick();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t xTicksToWait){
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        if (s->owner == current()){
+            ++s->recursion;
+            return pdTRUE;
+        }
+    }
+    return xSemaphoreTake(s, xTicksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s){
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        if (s->owner != current())
+            return pdFALSE;
+        if (s->recursion){
+            --s->recursion;
+            return pdTRUE;
+        }
+    }
+    return xSemaphoreGive(s);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken){
+    if (pxHigherPriorityTaskWoken)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreGive(xSemaphore);
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t xMutex){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return xMutex->mutex ? static_cast<sim_task_t*>(xMutex->owner) : nullptr;
+}
@@ -0,0 +1,86 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// I2C driver stand-in
+
+#include "sim.hpp"
+#include "sim_i2c.hpp"
+
+namespace {
+
+struct I2C {
+    bool installed[I2C_NUM_MAX] = { false };
+    sim::i2c::write_hook_t hook = nullptr;
+};
+
+I2C &i2c(){
+    static I2C *p = new I2C;
+    return *p;
+}
+
+}   // namespace
+
+namespace sim {
+namespace i2c {
+
+void on_write(write_hook_t f){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ::i2c().hook = std::move(f);
+}
+
+}   // namespace i2c
+}   // namespace sim
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf){
+    return (i2c_num >= 0 && i2c_num < I2C_NUM_MAX && i2c_conf) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t /*mode*/, size_t /*slv_rx_buf_len*/, size_t /*slv_tx_buf_len*/, int /*intr_alloc_flags*/){
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    i2c().installed[i2c_num] = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num){
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    i2c().installed[i2c_num] = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t i2c_num, uint8_t device_address, const uint8_t *write_buffer, size_t write_size, TickType_t /*ticks_to_wait*/){
+    sim::i2c::write_hook_t hook;
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        hook = i2c().hook;
+    }
+    return hook ? hook(i2c_num, device_address, write_buffer, write_size) : ESP_OK;
+}
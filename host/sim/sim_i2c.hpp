@@ -0,0 +1,47 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Simulated I2C master
+*/
+
+#pragma once
+#include "driver/i2c.h"
+#include <functional>
+
+namespace sim {
+namespace i2c {
+
+/**
+ * @brief master write hook
+ * should return ESP_OK if device acknowledged the transaction,
+ * if hook is not set, all writes are acknowledged
+ */
+typedef std::function<esp_err_t (i2c_port_t port, uint8_t addr, const uint8_t *data, size_t len)> write_hook_t;
+void on_write(write_hook_t f);
+
+}   // namespace i2c
+}   // namespace sim
@@ -0,0 +1,351 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// LEDC driver stand-in
+
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include "esp_log.h"
+
+#define LEDC_DUTY_CYCLE_MAX     1023            // max PWM cycles per duty step of a hardware fade
+
+namespace {
+
+static const char* TAG = "sim_ledc";
+
+struct Channel {
+    sim::ledc::channel_state s;
+    uint32_t pending_duty = 0;
+    uint32_t pending_hpoint = 0;
+    ledc_cb_t cb = nullptr;
+    void *cb_arg = nullptr;
+    uint32_t fade_timer = 0;
+};
+
+struct Ledc {
+    Channel ch[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+    sim::ledc::timer_state tm[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX];
+    bool fade_installed = false;
+    sim::ledc::duty_hook_t hook = nullptr;
+};
+
+Ledc &ledc(){
+    static Ledc *l = new Ledc;
+    return *l;
+}
+
+bool valid(ledc_mode_t mode, ledc_channel_t ch){
+    return mode >= 0 && mode < LEDC_SPEED_MODE_MAX && ch >= 0 && ch < LEDC_CHANNEL_MAX;
+}
+
+/*
+ * fade time the hardware actually runs, ms
+ * real driver splits a fade into duty steps, one every 'cycle_num' PWM cycles, and
+ * cycle_num is capped by register width, so a slow fade of a small duty change ends early.
+ * Rounding of the step length is not modeled
+ */
+uint32_t hw_fade_time(uint32_t freq, uint32_t delta, uint32_t ms){
+    if (!freq || !delta)
+        return ms;
+
+    uint64_t cycles = (uint64_t)ms * freq / 1000;
+    if (cycles / delta <= LEDC_DUTY_CYCLE_MAX)
+        return ms;
+
+    ESP_LOGW(TAG, "fading too slow, %u duty steps in %u ms", delta, ms);
+    return (uint64_t)delta * LEDC_DUTY_CYCLE_MAX * 1000 / freq;
+}
+
+// duty value of a fading channel at current time
+uint32_t fade_duty(const sim::ledc::channel_state &s){
+    if (!s.fading)
+        return s.duty;
+
+    int64_t elapsed = sim::now_us() - s.fade_start;
+    int64_t total = (int64_t)s.fade_time * 1000;
+    if (elapsed >= total)
+        return s.fade_to;
+
+    return s.fade_from + ((int64_t)s.fade_to - (int64_t)s.fade_from) * elapsed / total;
+}
+
+void latch(ledc_mode_t mode, ledc_channel_t c){
+    Channel &ch = ledc().ch[mode][c];
+    ch.s.duty = ch.pending_duty;
+    ch.s.hpoint = ch.pending_hpoint;
+    ch.s.stopped = false;
+    if (ledc().hook)
+        ledc().hook(mode, c, ch.s.duty, ch.s.hpoint);
+}
+
+}   // namespace
+
+
+namespace sim {
+namespace ledc {
+
+channel_state channel(ledc_mode_t mode, ledc_channel_t ch){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    channel_state s = ::ledc().ch[mode][ch].s;
+    s.duty = fade_duty(s);
+    return s;
+}
+
+timer_state timer(ledc_mode_t mode, ledc_timer_t tm){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return ::ledc().tm[mode][tm];
+}
+
+void on_duty_write(duty_hook_t f){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ::ledc().hook = std::move(f);
+}
+
+}   // namespace ledc
+}   // namespace sim
+
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *cfg){
+    if (!cfg || !valid(cfg->speed_mode, cfg->channel) || cfg->timer_sel >= LEDC_TIMER_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    Channel &ch = ledc().ch[cfg->speed_mode][cfg->channel];
+    ch.s.configured = true;
+    ch.s.gpio = cfg->gpio_num;
+    ch.s.timer = cfg->timer_sel;
+    ch.s.invert = cfg->flags.output_invert;
+    ch.pending_duty = cfg->duty;
+    ch.pending_hpoint = cfg->hpoint;
+    latch(cfg->speed_mode, cfg->channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *cfg){
+    if (!cfg || cfg->speed_mode >= LEDC_SPEED_MODE_MAX || cfg->timer_num >= LEDC_TIMER_MAX || !cfg->freq_hz)
+        return ESP_ERR_INVALID_ARG;
+
+    // the same check as real driver does - timer clock divider must be >= 1
+    if ((uint64_t)cfg->freq_hz << cfg->duty_resolution > LEDC_APB_CLK_HZ)
+        return ESP_FAIL;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    auto &t = ledc().tm[cfg->speed_mode][cfg->timer_num];
+    t.configured = true;
+    t.freq = cfg->freq_hz;
+    t.bits = cfg->duty_resolution;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    latch(speed_mode, channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    auto &s = ledc().ch[speed_mode][channel].s;
+    s.stopped = true;
+    s.idle_level = idle_level;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num, uint32_t freq_hz){
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || timer_num >= LEDC_TIMER_MAX || !freq_hz)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    auto &t = ledc().tm[speed_mode][timer_num];
+    if ((uint64_t)freq_hz << t.bits > LEDC_APB_CLK_HZ)
+        return ESP_FAIL;
+    t.freq = freq_hz;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return ledc().tm[speed_mode][timer_num].freq;
+}
+
+esp_err_t ledc_set_duty_with_hpoint(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint){
+    if (!valid(speed_mode, channel) || hpoint > LEDC_HPOINT_VAL_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    Channel &ch = ledc().ch[speed_mode][channel];
+    ch.pending_duty = duty;
+    ch.pending_hpoint = hpoint;
+    return ESP_OK;
+}
+
+int ledc_get_hpoint(ledc_mode_t speed_mode, ledc_channel_t channel){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return ledc().ch[speed_mode][channel].s.hpoint;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ledc().ch[speed_mode][channel].pending_duty = duty;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return fade_duty(ledc().ch[speed_mode][channel].s);
+}
+
+esp_err_t ledc_bind_channel_timer(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_timer_t timer_sel){
+    if (!valid(speed_mode, channel) || timer_sel >= LEDC_TIMER_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ledc().ch[speed_mode][channel].s.timer = timer_sel;
+    return ESP_OK;
+}
+
+/*
+ * like the real driver, a new fade (or duty update) on a channel blocks
+ * until the fade already in progress is complete
+ */
+esp_err_t ledc_set_fade_time_and_start(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, uint32_t max_fade_time_ms, ledc_fade_mode_t fade_mode){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::unique_lock<std::mutex> lk(sim::lock());
+    if (!ledc().fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    Channel &ch = ledc().ch[speed_mode][channel];
+    sim::wait(lk, [&ch]{ return !ch.s.fading; });
+
+    uint32_t delta = target_duty > ch.s.duty ? target_duty - ch.s.duty : ch.s.duty - target_duty;
+    ch.s.fade_from = ch.s.duty;
+    ch.s.fade_to = target_duty;
+    ch.s.fade_start = sim::now_us();
+    ch.s.fade_time = hw_fade_time(ledc().tm[speed_mode][ch.s.timer].freq, delta, max_fade_time_ms);
+    ch.s.fading = true;
+    ch.s.stopped = false;
+    if (ledc().hook)
+        ledc().hook(speed_mode, channel, target_duty, ch.s.hpoint);
+
+    ch.fade_timer = sim::timer_add(ch.s.fade_start + (int64_t)ch.s.fade_time * 1000, [speed_mode, channel](){
+        ledc_cb_t cb;
+        void *arg;
+        ledc_cb_param_t param{ LEDC_FADE_END_EVT, (uint32_t)speed_mode, (uint32_t)channel, 0 };
+        {
+            std::lock_guard<std::mutex> lk(sim::lock());
+            Channel &ch = ledc().ch[speed_mode][channel];
+            ch.s.fading = false;
+            ch.s.duty = ch.pending_duty = ch.s.fade_to;
+            ch.fade_timer = 0;
+            cb = ch.cb;
+            arg = ch.cb_arg;
+            param.duty = ch.s.duty;
+            sim::kick();
+        }
+        if (cb)
+            cb(&param, arg);        // "ISR" context
+    });
+
+    if (fade_mode == LEDC_FADE_WAIT_DONE)
+        sim::wait(lk, [&ch]{ return !ch.s.fading; });
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::unique_lock<std::mutex> lk(sim::lock());
+    if (!ledc().fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    Channel &ch = ledc().ch[speed_mode][channel];
+    sim::wait(lk, [&ch]{ return !ch.s.fading; });
+    ch.pending_duty = duty;
+    ch.pending_hpoint = hpoint;
+    latch(speed_mode, channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int /*intr_alloc_flags*/){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (ledc().fade_installed)
+        return ESP_ERR_INVALID_STATE;
+    ledc().fade_installed = true;
+    return ESP_OK;
+}
+
+void ledc_fade_func_uninstall(void){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ledc().fade_installed = false;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel){
+    if (!valid(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (!ledc().fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    Channel &ch = ledc().ch[speed_mode][channel];
+    if (!ch.s.fading)
+        return ESP_OK;
+
+    // stopped fade holds current duty and does not trigger fade end callback
+    ch.s.duty = ch.pending_duty = fade_duty(ch.s);
+    ch.s.fading = false;
+    sim::timer_cancel(ch.fade_timer);
+    ch.fade_timer = 0;
+    sim::kick();
+    return ESP_OK;
+}
+
+esp_err_t ledc_cb_register(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_cbs_t *cbs, void *user_arg){
+    if (!valid(speed_mode, channel) || !cbs)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (!ledc().fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    Channel &ch = ledc().ch[speed_mode][channel];
+    ch.cb = cbs->fade_cb;
+    ch.cb_arg = user_arg;
+    return ESP_OK;
+}
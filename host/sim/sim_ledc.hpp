@@ -0,0 +1,78 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Simulated LEDC peripheral state inspection
+*/
+
+#pragma once
+#include "driver/ledc.h"
+#include <functional>
+
+namespace sim {
+namespace ledc {
+
+struct channel_state {
+    bool configured = false;
+    int gpio = -1;
+    ledc_timer_t timer = LEDC_TIMER_0;
+    uint32_t duty = 0;              // duty currently applied to the output
+    uint32_t hpoint = 0;
+    bool invert = false;
+    bool stopped = true;
+    uint32_t idle_level = 0;
+    // hardware fade
+    bool fading = false;
+    int64_t fade_start = 0;         // us
+    uint32_t fade_from = 0;
+    uint32_t fade_to = 0;
+    uint32_t fade_time = 0;         // ms, as run by hardware, see hw_fade_time()
+};
+
+struct timer_state {
+    bool configured = false;
+    uint32_t freq = 0;
+    uint8_t bits = 0;
+};
+
+/**
+ * @brief get a snapshot of channel state
+ * duty is evaluated at current sim time for fading channels
+ */
+channel_state channel(ledc_mode_t mode, ledc_channel_t ch);
+timer_state timer(ledc_mode_t mode, ledc_timer_t tm);
+
+/**
+ * @brief duty register write hook
+ * called each time duty/hpoint is latched to the channel output (outside of fades)
+ * or when hardware fade has started
+ * hook is called with sim lock held, so it must not call any sim/IDF API
+ */
+typedef std::function<void (ledc_mode_t mode, ledc_channel_t ch, uint32_t duty, uint32_t hpoint)> duty_hook_t;
+void on_duty_write(duty_hook_t f);
+
+}   // namespace ledc
+}   // namespace sim
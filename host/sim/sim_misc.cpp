@@ -0,0 +1,240 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// misc stand-ins: gpio, logging, esp_timer, system
+
+#include "sim.hpp"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+// *** GPIO *** //
+
+gpio_dev_t GPIO = {};
+
+static uint32_t gpio_out[GPIO_PIN_COUNT];
+
+esp_err_t gpio_config(const gpio_config_t *cfg){
+    return cfg ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level){
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(gpio_num))
+        return ESP_ERR_INVALID_ARG;
+    gpio_out[gpio_num] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+// pad level reflects output inversion in GPIO matrix
+int gpio_get_level(gpio_num_t gpio_num){
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return 0;
+    return gpio_out[gpio_num] ^ (GPIO.func_out_sel_cfg[gpio_num].inv_sel & 1);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t /*mode*/){
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num){
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return ESP_ERR_INVALID_ARG;
+    gpio_out[gpio_num] = 0;
+    GPIO.func_out_sel_cfg[gpio_num].inv_sel = 0;
+    return ESP_OK;
+}
+
+
+// *** Logging *** //
+
+namespace {
+
+std::mutex &log_mtx(){
+    static std::mutex *m = new std::mutex;
+    return *m;
+}
+
+std::map<std::string, esp_log_level_t> &log_levels(){
+    static auto *m = new std::map<std::string, esp_log_level_t>;
+    return *m;
+}
+
+esp_log_level_t log_default(){
+    static esp_log_level_t l = [](){
+        const char *e = getenv("ESP_LOG_LEVEL");
+        return e ? static_cast<esp_log_level_t>(atoi(e)) : ESP_LOG_INFO;
+    }();
+    return l;
+}
+
+}   // namespace
+
+void esp_log_level_set(const char *tag, esp_log_level_t level){
+    std::lock_guard<std::mutex> lk(log_mtx());
+    if (!strcmp(tag, "*"))
+        log_levels().clear();
+    log_levels()[tag] = level;
+}
+
+int esp_log_enabled(const char *tag, esp_log_level_t level){
+    std::lock_guard<std::mutex> lk(log_mtx());
+    auto &m = log_levels();
+    auto i = m.find(tag);
+    if (i == m.end())
+        i = m.find("*");
+    return level <= (i == m.end() ? log_default() : i->second);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...){
+    static const char lvl[] = "NEWIDV";
+    std::lock_guard<std::mutex> lk(log_mtx());
+    fprintf(stderr, "%c (%u) %s: ", lvl[level], esp_log_timestamp(), tag);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+uint32_t esp_log_timestamp(void){
+    return sim::now_us() / 1000;
+}
+
+
+// *** esp_timer *** //
+
+struct sim_esp_timer_t {
+    esp_timer_create_args_t args;
+    uint64_t period = 0;
+    uint32_t id = 0;
+};
+
+namespace {
+
+void esp_timer_arm(esp_timer_handle_t t, int64_t due){
+    t->id = sim::timer_add(due, [t, due](){
+        esp_timer_cb_t cb;
+        {
+            std::lock_guard<std::mutex> lk(sim::lock());
+            if (!t->id)
+                return;
+            cb = t->args.callback;
+            if (t->period)
+                esp_timer_arm(t, due + t->period);
+            else
+                t->id = 0;
+        }
+        cb(t->args.arg);
+    });
+}
+
+}   // namespace
+
+int64_t esp_timer_get_time(void){
+    return sim::now_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle){
+    if (!create_args || !create_args->callback || !out_handle)
+        return ESP_ERR_INVALID_ARG;
+    *out_handle = new sim_esp_timer_t{ *create_args };
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (timer->id)
+        return ESP_ERR_INVALID_STATE;
+    timer->period = 0;
+    esp_timer_arm(timer, sim::now_us() + timeout_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (timer->id)
+        return ESP_ERR_INVALID_STATE;
+    timer->period = period;
+    esp_timer_arm(timer, sim::now_us() + period);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (!timer->id)
+        return ESP_ERR_INVALID_STATE;
+    sim::timer_cancel(timer->id);
+    timer->id = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer){
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        if (timer->id)
+            return ESP_ERR_INVALID_STATE;
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+
+// *** System *** //
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac){
+    static const uint8_t sim_mac[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+    memcpy(mac, sim_mac, sizeof(sim_mac));
+    return ESP_OK;
+}
+
+void esp_restart(void){
+    exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void){
+    return 320 * 1024;
+}
+
+const char *esp_err_to_name(esp_err_t code){
+    switch (code){
+        case ESP_OK : return "ESP_OK";
+        case ESP_FAIL : return "ESP_FAIL";
+        case ESP_ERR_NO_MEM : return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG : return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE : return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE : return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND : return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED : return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT : return "ESP_ERR_TIMEOUT";
+        default : return "UNKNOWN ERROR";
+    }
+}
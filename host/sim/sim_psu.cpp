@@ -0,0 +1,175 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// PWM waveform reconstruction and PSU load analysis
+
+#include "sim_psu.hpp"
+#include "sim_ledc.hpp"
+#include <algorithm>
+#include <cmath>
+
+// edges closer than this are considered simultaneous, us
+#define PSU_EDGE_EPSILON    1e-6
+
+namespace sim {
+namespace psu {
+
+pwm_wave_t waveform(ledc_mode_t mode, ledc_channel_t ch){
+    pwm_wave_t w;
+    ledc::channel_state c = ledc::channel(mode, ch);
+    if (!c.configured)
+        return w;
+
+    w.invert = c.invert;
+    if (c.stopped){
+        w.active = (c.idle_level != 0) != c.invert;
+        return w;
+    }
+
+    ledc::timer_state t = ledc::timer(mode, c.timer);
+    if (!t.configured || !t.freq || !t.bits)
+        return w;
+
+    uint32_t max = 1 << t.bits;
+    uint32_t duty = std::min(c.duty, max);
+    if (!duty || duty == max){
+        w.active = duty;
+        return w;
+    }
+
+    w.period = 1e6 / t.freq;
+    w.on = w.period * (c.hpoint % max) / max;
+    w.width = w.period * duty / max;
+    return w;
+}
+
+bool active(const pwm_wave_t &w, double t){
+    if (!w.period)
+        return w.active;
+
+    double pos = std::fmod(t - w.on, w.period);
+    if (pos < 0)
+        pos += w.period;
+    return pos < w.width;
+}
+
+
+void LoadAnalyzer::add(ledc_mode_t mode, ledc_channel_t ch, double weight){
+    loads.push_back({mode, ch, weight});
+}
+
+double LoadAnalyzer::span(const std::vector<pwm_wave_t> &waves, double window){
+    if (window)
+        return window;
+
+    for (auto &w : waves)
+        window = std::max(window, w.period);
+    return window ? window : 1000;      // all outputs are static, any interval would do
+}
+
+std::vector<load_segment_t> LoadAnalyzer::profile(double window) const {
+    return build(window);
+}
+
+std::vector<load_segment_t> LoadAnalyzer::build(double &window) const {
+    std::vector<pwm_wave_t> waves;
+    waves.reserve(loads.size());
+    for (auto &l : loads)
+        waves.push_back(waveform(l.mode, l.ch));
+    window = span(waves, window);
+
+    // load deltas on active intervals edges
+    std::vector<std::pair<double, double>> edges;
+    double base = 0;
+    for (size_t i = 0; i != loads.size(); ++i){
+        const pwm_wave_t &w = waves[i];
+        if (!w.period){
+            if (w.active)
+                base += loads[i].weight;
+            continue;
+        }
+
+        for (double a = w.on - w.period; a < window; a += w.period){
+            double ca = std::max(a, 0.0);
+            double cb = std::min(a + w.width, window);
+            if (ca >= cb)
+                continue;
+            edges.push_back({ca, loads[i].weight});
+            edges.push_back({cb, -loads[i].weight});
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<load_segment_t> seg;
+    double load = base;
+    double t = 0;
+    auto e = edges.begin();
+    while (t < window){
+        // apply all the edges at the current point
+        while (e != edges.end() && e->first <= t + PSU_EDGE_EPSILON){
+            load += e->second;
+            ++e;
+        }
+
+        if (seg.empty() || std::fabs(seg.back().load - load) > PSU_EDGE_EPSILON)
+            seg.push_back({t, load});
+
+        if (e == edges.end())
+            break;
+        t = e->first;
+    }
+
+    return seg;
+}
+
+load_stats_t LoadAnalyzer::analyze(double window) const {
+    load_stats_t st;
+    std::vector<load_segment_t> seg = build(window);
+    st.window = window;
+    if (seg.empty())
+        return st;
+
+    st.peak = st.min = seg.front().load;
+    double sum = 0, sq = 0;
+    for (size_t i = 0; i != seg.size(); ++i){
+        double len = (i + 1 == seg.size() ? window : seg[i+1].t) - seg[i].t;
+        sum += seg[i].load * len;
+        sq += seg[i].load * seg[i].load * len;
+        st.peak = std::max(st.peak, seg[i].load);
+        st.min = std::min(st.min, seg[i].load);
+    }
+
+    st.avg = sum / window;
+    st.ripple = st.peak - st.min;
+    st.ripple_rms = std::sqrt(std::max(sq / window - st.avg * st.avg, 0.0));
+    st.avg_current = st.avg / volts;
+    st.peak_current = st.peak / volts;
+    return st;
+}
+
+}   // namespace psu
+}   // namespace sim
@@ -0,0 +1,152 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Simulated LEDC waveforms and PSU load analysis
+
+    Reconstructs per-channel PWM waveforms from timer frequency, resolution,
+    duty and hpoint of the simulated LEDC and sums them into an aggregate
+    load profile, each channel weighted by the power of the light it drives.
+    Used to compare power_share_t::phaseshift against power_share_t::equal
+    and to catch regressions in phase planning.
+*/
+
+#pragma once
+#include "driver/ledc.h"
+#include <vector>
+
+namespace sim {
+namespace psu {
+
+/**
+ * @brief PWM waveform of a channel over one timer period
+ * light is active within [on, on + width) of the period, an active interval
+ * crossing the period end wraps over to the period start (lpoint = hpoint + duty
+ * rolls over with the timer counter). Period starts at timer counter zero
+ */
+struct pwm_wave_t {
+    double period = 0;          // us, 0 if channel output is static
+    double on = 0;              // active interval start within period, us
+    double width = 0;           // active time within period, us
+    bool active = false;        // static state (period == 0)
+    bool invert = false;        // gpio output is inverted, pin level is low when light is active
+};
+
+/**
+ * @brief reconstruct channel waveform at current sim time
+ * fading channels are evaluated with duty at current time,
+ * stopped channels are static at idle level
+ *
+ * @return pwm_wave_t, a static inactive wave for unconfigured channels
+ */
+pwm_wave_t waveform(ledc_mode_t mode, ledc_channel_t ch);
+
+/**
+ * @brief light state of a waveform at time t
+ */
+bool active(const pwm_wave_t &w, double t);
+
+/**
+ * @brief gpio pin level of a waveform at time t
+ */
+inline bool level(const pwm_wave_t &w, double t){ return active(w, t) != w.invert; }
+
+// piecewise-constant load segment
+struct load_segment_t {
+    double t;                   // segment start, us from window start
+    double load;                // aggregate load, W
+};
+
+struct load_stats_t {
+    double window = 0;          // analyzed interval, us
+    double avg = 0;             // average load, W
+    double peak = 0;            // max instantaneous load, W
+    double min = 0;             // min instantaneous load, W
+    double ripple = 0;          // peak-to-peak, W
+    double ripple_rms = 0;      // load standard deviation, W
+    double avg_current = 0;     // A
+    double peak_current = 0;    // A
+};
+
+/**
+ * @brief PSU load analyzer
+ * a set of LEDC channels, each with it's load weight (i.e. GenericLight::getMaxPower()
+ * of the light driven by the channel), is sampled on the simulated LEDC.
+ * Edges of all waveforms are merged, so the profile is exact, not sampled
+ *
+ */
+class LoadAnalyzer {
+
+    struct load_t {
+        ledc_mode_t mode;
+        ledc_channel_t ch;
+        double weight;
+    };
+
+    std::vector<load_t> loads;
+    double volts;
+
+    // analyzed interval, a period of the slowest timer if window is 0
+    static double span(const std::vector<pwm_wave_t> &waves, double window);
+
+    // build load profile, window is updated with the actual interval
+    std::vector<load_segment_t> build(double &window) const;
+
+public:
+    /**
+     * @param supply_v - PSU voltage used to convert power to current
+     */
+    LoadAnalyzer(double supply_v = 12.0) : volts(supply_v) {};
+
+    /**
+     * @brief add a channel to the load set
+     *
+     * @param weight - channel's load at 100% duty, W
+     */
+    void add(ledc_mode_t mode, ledc_channel_t ch, double weight);
+
+    void clear(){ loads.clear(); };
+
+    /**
+     * @brief build aggregate load profile at current sim time
+     * waveforms are taken as a snapshot, so the result is valid for a period
+     * short enough for duties not to change
+     *
+     * @param window - interval to analyze, us. If 0, one period of the slowest timer
+     * @return std::vector<load_segment_t> ordered segments covering [0, window)
+     */
+    std::vector<load_segment_t> profile(double window = 0) const;
+
+    /**
+     * @brief load statistics at current sim time
+     *
+     * @param window - interval to analyze, us. If 0, one period of the slowest timer
+     */
+    load_stats_t analyze(double window = 0) const;
+};
+
+}   // namespace psu
+}   // namespace sim
@@ -0,0 +1,183 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// RMT driver stand-in, transmissions are instant on sim clock
+
+#include "sim.hpp"
+#include "sim_rmt.hpp"
+
+namespace {
+
+struct Channel {
+    bool configured = false;
+    bool installed = false;
+    sample_to_rmt_t translator = nullptr;
+    void *ctx = nullptr;
+};
+
+struct Rmt {
+    Channel ch[RMT_CHANNEL_MAX];
+    sim::rmt::tx_hook_t hook = nullptr;
+};
+
+Rmt &rmt(){
+    static Rmt *r = new Rmt;
+    return *r;
+}
+
+// context of a translation in progress, a sim is single-core, so one is enough
+thread_local void *tr_ctx = nullptr;
+
+bool valid(rmt_channel_t ch){
+    return ch >= 0 && ch < RMT_CHANNEL_MAX;
+}
+
+sim::rmt::tx_hook_t hook(){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    return rmt().hook;
+}
+
+}   // namespace
+
+namespace sim {
+namespace rmt {
+
+void on_tx(tx_hook_t f){
+    std::lock_guard<std::mutex> lk(sim::lock());
+    ::rmt().hook = std::move(f);
+}
+
+}   // namespace rmt
+}   // namespace sim
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param){
+    if (!rmt_param || !valid(rmt_param->channel) || !rmt_param->clk_div)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    rmt().ch[rmt_param->channel].configured = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t /*rx_buf_size*/, int /*intr_alloc_flags*/){
+    if (!valid(channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (rmt().ch[channel].installed)
+        return ESP_ERR_INVALID_STATE;
+    rmt().ch[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel){
+    if (!valid(channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    rmt().ch[channel] = Channel();
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool /*wait_tx_done*/){
+    if (!valid(channel) || !rmt_item || item_num <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        if (!rmt().ch[channel].installed)
+            return ESP_ERR_INVALID_STATE;
+    }
+
+    if (auto f = hook())
+        f(channel, rmt_item, item_num);
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t /*wait_time*/){
+    return valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn){
+    if (!valid(channel) || !fn)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    if (!rmt().ch[channel].installed)
+        return ESP_FAIL;
+    rmt().ch[channel].translator = fn;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_set_context(rmt_channel_t channel, void *context){
+    if (!valid(channel))
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lk(sim::lock());
+    rmt().ch[channel].ctx = context;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_get_context(const size_t *, void **context){
+    if (!context)
+        return ESP_ERR_INVALID_ARG;
+    *context = tr_ctx;
+    return ESP_OK;
+}
+
+/*
+ * like the real driver, samples are translated in chunks of channel memory size,
+ * each chunk is sent to the tx hook as soon as it's translated
+ */
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t *src, size_t src_size, bool /*wait_tx_done*/){
+    if (!valid(channel) || !src)
+        return ESP_ERR_INVALID_ARG;
+
+    sample_to_rmt_t fn;
+    {
+        std::lock_guard<std::mutex> lk(sim::lock());
+        Channel &ch = rmt().ch[channel];
+        if (!ch.installed || !ch.translator)
+            return ESP_FAIL;
+        fn = ch.translator;
+        tr_ctx = ch.ctx;
+    }
+
+    auto f = hook();
+    rmt_item32_t mem[SIM_RMT_MEM_ITEMS];
+    size_t offset = 0;
+    while (offset < src_size){
+        size_t translated = 0, items = 0;
+        fn(src + offset, mem, src_size - offset, SIM_RMT_MEM_ITEMS, &translated, &items);
+        if (!translated && !items)
+            break;              // translator can't make progress
+        if (f && items)
+            f(channel, mem, items);
+        offset += translated;
+    }
+    tr_ctx = nullptr;
+    return ESP_OK;
+}
@@ -0,0 +1,53 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Simulated RMT transmitter
+*/
+
+#pragma once
+#include "driver/rmt.h"
+#include <functional>
+
+namespace sim {
+namespace rmt {
+
+/**
+ * @brief transmitted items hook
+ * called for each block of items the channel sends to the wire,
+ * a single transmission might be split into several blocks when translator is used
+ */
+typedef std::function<void (rmt_channel_t ch, const rmt_item32_t *items, size_t count)> tx_hook_t;
+void on_tx(tx_hook_t f);
+
+/**
+ * @brief channel memory size, items
+ * translator is called to fill this many items at a time, like RMT's ping-pong refill does
+ */
+#define SIM_RMT_MEM_ITEMS   64
+
+}   // namespace rmt
+}   // namespace sim
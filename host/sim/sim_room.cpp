@@ -0,0 +1,79 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+// Simulated room illuminance
+
+#include "sim_room.hpp"
+#include "sim.hpp"
+#include "sim_ledc.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace sim {
+namespace room {
+
+void Room::add(ledc_mode_t mode, ledc_channel_t ch, double lux){
+    sources.push_back({mode, ch, lux});
+}
+
+double Room::daylight_lux() const {
+    return daylight ? std::max(daylight(now_us()), 0.0) : 0;
+}
+
+double Room::illuminance() const {
+    double lux = daylight_lux();
+    for (auto const &s : sources){
+        ledc::channel_state c = ledc::channel(s.mode, s.ch);
+        if (!c.configured)
+            continue;
+        ledc::timer_state t = ledc::timer(s.mode, c.timer);
+        if (!t.bits)
+            continue;
+
+        // duty is the active time, inversion changes pin level only, same as PSU waveforms
+        double share = c.stopped ? (c.idle_level != 0) != c.invert : std::min<double>(c.duty, 1 << t.bits) / (1 << t.bits);
+        lux += s.lux * share;
+    }
+    return lux;
+}
+
+double Room::read(){
+    double lux = illuminance();
+    int64_t now = now_us();
+    if (sensed_at < 0 || !lag)
+        sensed = lux;
+    else
+        sensed += (lux - sensed) * (1 - std::exp(-(now - sensed_at) / lag));
+    sensed_at = now;
+
+    double r = sensed;
+    if (noise)
+        r += std::normal_distribution<double>(0, noise)(rng);
+    return std::max(r, 0.0);
+}
+
+}   // namespace room
+}   // namespace sim
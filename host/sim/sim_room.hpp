@@ -0,0 +1,106 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+/*
+    Simulated room illuminance
+
+    Illuminance at a sensor is daylight plus a contribution of each light,
+    light output is linear in PWM duty cycle of it's LEDC channel. Sensor
+    reading follows illuminance with a first order lag and has a gaussian
+    noise from a fixed seed, so runs are repeatable.
+    Used to validate closed loop daylight harvesting on a simulated clock
+*/
+
+#pragma once
+#include "driver/ledc.h"
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace sim {
+namespace room {
+
+typedef std::function<double (int64_t us)> daylight_t;
+
+class Room {
+
+    struct source_t {
+        ledc_mode_t mode;
+        ledc_channel_t ch;
+        double lux;             // at the sensor at 100% duty
+    };
+
+    std::vector<source_t> sources;
+    daylight_t daylight;
+    double lag = 0;             // sensor time constant, us
+    double noise = 0;           // noise sigma, lx
+    double sensed = 0;          // lagged illuminance
+    int64_t sensed_at = -1;     // us
+    std::mt19937 rng;
+
+public:
+    Room(uint32_t seed = 1) : rng(seed){};
+
+    /**
+     * @brief add light source
+     *
+     * @param lux - illuminance at the sensor at 100% duty, lx
+     */
+    void add(ledc_mode_t mode, ledc_channel_t ch, double lux);
+
+    /**
+     * @brief set daylight illuminance profile, a function of sim time
+     */
+    void setDaylight(daylight_t f){ daylight = std::move(f); };
+
+    /**
+     * @brief set sensor properties
+     *
+     * @param lag_ms - first order lag time constant, ms
+     * @param sigma - noise standard deviation, lx
+     */
+    void setSensor(double lag_ms, double sigma){ lag = lag_ms * 1000; noise = sigma; };
+
+    /**
+     * @brief actual illuminance at the sensor at current sim time, lx
+     */
+    double illuminance() const;
+
+    /**
+     * @brief daylight part of illuminance at current sim time, lx
+     */
+    double daylight_lux() const;
+
+    /**
+     * @brief take a sensor reading at current sim time
+     * lag is integrated since the previous reading with illuminance held
+     * at the current value, readings should be taken often enough
+     */
+    double read();
+};
+
+}   // namespace room
+}   // namespace sim
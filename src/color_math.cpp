@@ -0,0 +1,140 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "color_math.hpp"
+#include <cmath>
+
+/*
+    Black body colors, sRGB, normalized
+    ref: Mitchell Charity, "What color is a blackbody?"
+    http://www.vendian.org/mncharity/dir3/blackbody/
+*/
+static const rgb8_t cct_table[] = {
+    {255,  56,   0},    // 1000K
+    {255, 109,   0},    // 1500K
+    {255, 137,  18},    // 2000K
+    {255, 161,  72},    // 2500K
+    {255, 180, 107},    // 3000K
+    {255, 196, 137},    // 3500K
+    {255, 209, 163},    // 4000K
+    {255, 219, 186},    // 4500K
+    {255, 228, 206},    // 5000K
+    {255, 236, 224},    // 5500K
+    {255, 243, 239},    // 6000K
+    {255, 249, 253},    // 6500K
+    {245, 243, 255},    // 7000K
+    {235, 238, 255},    // 7500K
+    {227, 233, 255},    // 8000K
+    {220, 229, 255},    // 8500K
+    {214, 225, 255},    // 9000K
+    {208, 222, 255},    // 9500K
+    {204, 219, 255}     // 10000K
+};
+
+namespace color {
+
+rgb8_t hsv2rgb(uint16_t hue, uint8_t sat, uint8_t val){
+    hue %= 360;
+    uint8_t sector = hue / 60;
+    uint32_t frac = (hue % 60) * 255 / 60;          // position within a sector, 0-255
+
+    uint8_t p = val * (255 - sat) / 255;
+    uint8_t q = val * (255 * 255 - sat * frac) / (255 * 255);
+    uint8_t t = val * (255 * 255 - sat * (255 - frac)) / (255 * 255);
+
+    switch (sector){
+        case 0 :  return rgb8_t{val, t, p};
+        case 1 :  return rgb8_t{q, val, p};
+        case 2 :  return rgb8_t{p, val, t};
+        case 3 :  return rgb8_t{p, q, val};
+        case 4 :  return rgb8_t{t, p, val};
+        default : return rgb8_t{val, p, q};
+    }
+}
+
+rgb8_t cct2rgb(uint16_t kelvin){
+    if (kelvin <= CCT_MIN_KELVIN)
+        return cct_table[0];
+    if (kelvin >= CCT_MAX_KELVIN)
+        return cct_table[sizeof(cct_table)/sizeof(rgb8_t) - 1];
+
+    uint32_t idx = (kelvin - CCT_MIN_KELVIN) / CCT_TABLE_STEP;
+    int32_t frac = (kelvin - CCT_MIN_KELVIN) % CCT_TABLE_STEP;
+    const rgb8_t &a = cct_table[idx];
+    const rgb8_t &b = cct_table[idx + 1];
+
+    return rgb8_t{
+        (uint8_t)(a.r + (b.r - a.r) * frac / CCT_TABLE_STEP),
+        (uint8_t)(a.g + (b.g - a.g) * frac / CCT_TABLE_STEP),
+        (uint8_t)(a.b + (b.b - a.b) * frac / CCT_TABLE_STEP)
+    };
+}
+
+uint8_t rgb2w(rgb8_t &c){
+    uint8_t w = c.r < c.g ? c.r : c.g;
+    if (c.b < w)
+        w = c.b;
+
+    c.r -= w;
+    c.g -= w;
+    c.b -= w;
+    return w;
+}
+
+oklab_t linear2oklab(float r, float g, float b){
+    float l = cbrtf(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    float m = cbrtf(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    float s = cbrtf(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+    return oklab_t{
+        0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+        1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+        0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+    };
+}
+
+void oklab2linear(const oklab_t &c, float &r, float &g, float &b){
+    float l = c.L + 0.3963377774f * c.a + 0.2158037573f * c.b;
+    float m = c.L - 0.1055613458f * c.a - 0.0638541728f * c.b;
+    float s = c.L - 0.0894841775f * c.a - 1.2914855480f * c.b;
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+
+    r =  4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s;
+    g = -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s;
+    b = -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s;
+}
+
+oklab_t lerp(const oklab_t &from, const oklab_t &to, float t){
+    return oklab_t{
+        from.L + (to.L - from.L) * t,
+        from.a + (to.a - from.a) * t,
+        from.b + (to.b - from.b) * t
+    };
+}
+
+}   // namespace color
@@ -0,0 +1,97 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_types.hpp"
+
+#define CCT_MIN_KELVIN              1000
+#define CCT_MAX_KELVIN              10000
+#define CCT_TABLE_STEP              500             // K
+
+/*
+    Color conversions for color lights
+    rgb/hsv/cct functions are integer-only and table based, safe to use on each update.
+    OKLab conversions are float and meant to be used once per fade to precompute tables
+*/
+namespace color {
+
+// OKLab perceptual color space coordinates
+struct oklab_t {
+    float L, a, b;
+};
+
+/**
+ * @brief convert HSV color to RGB
+ *
+ * @param hue - hue, degrees 0-359
+ * @param sat - saturation 0-255
+ * @param val - value 0-255
+ * @return rgb8_t
+ */
+rgb8_t hsv2rgb(uint16_t hue, uint8_t sat, uint8_t val = 255);
+
+/**
+ * @brief get RGB color of a black body radiator with specified color temperature
+ * color is normalized to max component of 255. Values are interpolated from
+ * a table with CCT_TABLE_STEP steps, kelvins are clamped to CCT_MIN_KELVIN-CCT_MAX_KELVIN range
+ *
+ * @param kelvin - color temperature, K
+ * @return rgb8_t
+ */
+rgb8_t cct2rgb(uint16_t kelvin);
+
+/**
+ * @brief extract white component from RGB color
+ * common part of all three components is moved to white channel
+ *
+ * @param c - color, modified in place
+ * @return uint8_t white component
+ */
+uint8_t rgb2w(rgb8_t &c);
+
+/**
+ * @brief convert linear RGB to OKLab
+ * ref: https://bottosson.github.io/posts/oklab/
+ *
+ * @param r, g, b - linear intensities 0-1
+ * @return oklab_t
+ */
+oklab_t linear2oklab(float r, float g, float b);
+
+/**
+ * @brief convert OKLab to linear RGB
+ * resulting components are not clamped, out of gamut colors could produce values outside 0-1
+ */
+void oklab2linear(const oklab_t &c, float &r, float &g, float &b);
+
+/**
+ * @brief interpolate between two OKLab colors
+ *
+ * @param t - position 0-1
+ */
+oklab_t lerp(const oklab_t &from, const oklab_t &to, float t);
+
+}   // namespace color
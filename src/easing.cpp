@@ -0,0 +1,205 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "easing.hpp"
+#include <cmath>
+
+namespace easing {
+
+/*
+    smooth predefined functions sampled at EASE_LUT_POINTS evenly spaced points,
+    order matches ease_t starting from in_cubic.
+    Bounce has cusps that linear interpolation can't follow, it's piecewise
+    quadratic, so it is calculated directly in fixed point instead
+*/
+static const uint16_t lut[][EASE_LUT_POINTS] = {
+    {   // in_cubic
+            0,     0,     2,     7,    16,    31,    54,    86,   128,   182,   250,   333,   432,
+          549,   686,   844,  1024,  1228,  1458,  1715,  2000,  2315,  2662,  3042,  3456,  3906,
+         4394,  4921,  5488,  6097,  6750,  7448,  8192,  8984,  9826, 10719, 11664, 12663, 13718,
+        14830, 16000, 17230, 18522, 19876, 21296, 22781, 24334, 25955, 27648, 29412, 31250, 33162,
+        35151, 37219, 39365, 41593, 43903, 46298, 48777, 51344, 53999, 56744, 59581, 62511, 65535,
+    },
+    {   // out_cubic
+            0,  3024,  5954,  8791, 11536, 14191, 16758, 19237, 21632, 23942, 26170, 28316, 30384,
+        32373, 34285, 36123, 37887, 39580, 41201, 42754, 44239, 45659, 47013, 48305, 49535, 50705,
+        51817, 52872, 53871, 54816, 55709, 56551, 57343, 58087, 58785, 59438, 60047, 60614, 61141,
+        61629, 62079, 62493, 62873, 63220, 63535, 63820, 64077, 64307, 64511, 64691, 64849, 64986,
+        65103, 65202, 65285, 65353, 65407, 65449, 65481, 65504, 65519, 65528, 65533, 65535, 65535,
+    },
+    {   // inout_cubic
+            0,     1,     8,    27,    64,   125,   216,   343,   512,   729,  1000,  1331,  1728,
+         2197,  2744,  3375,  4096,  4913,  5832,  6859,  8000,  9261, 10648, 12167, 13824, 15625,
+        17576, 19683, 21952, 24389, 27000, 29791, 32768, 35744, 38535, 41146, 43583, 45852, 47959,
+        49910, 51711, 53368, 54887, 56274, 57535, 58676, 59703, 60622, 61439, 62160, 62791, 63338,
+        63807, 64204, 64535, 64806, 65023, 65192, 65319, 65410, 65471, 65508, 65527, 65534, 65535,
+    },
+    {   // in_sine
+            0,    20,    79,   178,   316,   493,   709,   965,  1259,  1592,  1964,  2374,  2822,
+         3308,  3831,  4391,  4989,  5622,  6292,  6998,  7738,  8514,  9324, 10168, 11045, 11955,
+        12897, 13871, 14876, 15911, 16977, 18071, 19195, 20346, 21524, 22729, 23960, 25216, 26496,
+        27799, 29126, 30474, 31843, 33233, 34642, 36070, 37515, 38978, 40456, 41949, 43457, 44978,
+        46511, 48056, 49611, 51176, 52750, 54331, 55919, 57513, 59111, 60714, 62319, 63927, 65535,
+    },
+    {   // out_sine
+            0,  1608,  3216,  4821,  6424,  8022,  9616, 11204, 12785, 14359, 15924, 17479, 19024,
+        20557, 22078, 23586, 25079, 26557, 28020, 29465, 30893, 32302, 33692, 35061, 36409, 37736,
+        39039, 40319, 41575, 42806, 44011, 45189, 46340, 47464, 48558, 49624, 50659, 51664, 52638,
+        53580, 54490, 55367, 56211, 57021, 57797, 58537, 59243, 59913, 60546, 61144, 61704, 62227,
+        62713, 63161, 63571, 63943, 64276, 64570, 64826, 65042, 65219, 65357, 65456, 65515, 65535,
+    },
+    {   // inout_sine
+            0,    39,   158,   355,   630,   982,  1411,  1915,  2494,  3146,  3869,  4662,  5522,
+         6448,  7438,  8488,  9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758, 20228, 21728,
+        23256, 24806, 26375, 27960, 29556, 31160, 32767, 34375, 35979, 37575, 39160, 40729, 42279,
+        43807, 45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773, 55938, 57047, 58097, 59087,
+        60013, 60873, 61666, 62389, 63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496, 65535,
+    },
+    {   // in_expo
+            0,    71,    79,    89,    99,   110,   123,   137,   152,   170,   189,   211,   235,
+          262,   292,   325,   362,   403,   450,   501,   558,   622,   693,   773,   861,   960,
+         1069,  1192,  1328,  1480,  1649,  1838,  2048,  2282,  2543,  2834,  3158,  3520,  3922,
+         4371,  4871,  5428,  6049,  6741,  7512,  8371,  9329, 10396, 11585, 12910, 14387, 16033,
+        17867, 19910, 22188, 24726, 27554, 30706, 34218, 38132, 42494, 47355, 52772, 58808, 65535,
+    },
+    {   // out_expo
+            0,  6727, 12763, 18180, 23041, 27403, 31317, 34829, 37981, 40809, 43347, 45625, 47668,
+        49502, 51148, 52625, 53950, 55139, 56206, 57164, 58023, 58794, 59486, 60107, 60664, 61164,
+        61613, 62015, 62377, 62701, 62992, 63253, 63487, 63697, 63886, 64055, 64207, 64343, 64466,
+        64575, 64674, 64762, 64842, 64913, 64977, 65034, 65085, 65132, 65173, 65210, 65243, 65273,
+        65300, 65324, 65346, 65365, 65383, 65398, 65412, 65425, 65436, 65446, 65456, 65464, 65535,
+    },
+    {   // inout_expo
+            0,    40,    49,    61,    76,    95,   117,   146,   181,   225,   279,   347,   431,
+          535,   664,   825,  1024,  1272,  1579,  1961,  2435,  3024,  3756,  4664,  5793,  7193,
+         8933, 11094, 13777, 17109, 21247, 26386, 32768, 39149, 44288, 48426, 51758, 54441, 56602,
+        58342, 59742, 60871, 61779, 62511, 63100, 63574, 63956, 64263, 64511, 64710, 64871, 65000,
+        65104, 65188, 65256, 65310, 65354, 65389, 65418, 65440, 65459, 65474, 65486, 65495, 65535,
+    },
+};
+
+
+// out-bounce in 16.16 fixed point, t is 0-0x10000
+static uint32_t bounce_out(uint32_t t){
+    // n1 * (t - c)^2 + k, n1 = 7.5625 = 121/16, breakpoints at 1/2.75, 2/2.75, 2.5/2.75
+    int64_t c, k;
+    if (t < 23831){
+        c = 0; k = 0;
+    } else if (t < 47663){
+        c = 35747; k = 49152;
+    } else if (t < 59578){
+        c = 53620; k = 61440;
+    } else {
+        c = 62557; k = 64512;
+    }
+    int64_t d = (int64_t)t - c;
+    uint32_t v = (121 * d * d >> 20) + k;
+    return v > 0x10000 ? 0x10000 : v;       // rounded constants overshoot a bit at t == 1
+}
+
+Easing::Easing(ease_t e, bezier_t b) : type(e) {
+    switch (e){
+        case ease_t::use_default :
+            type = ease_t::linear;
+            return;
+        case ease_t::linear :
+        case ease_t::in_bounce :
+        case ease_t::out_bounce :
+        case ease_t::inout_bounce :
+            return;
+        case ease_t::bezier :
+            break;
+        default :
+            lut = ::easing::lut[static_cast<uint8_t>(e) - static_cast<uint8_t>(ease_t::in_cubic)];
+            return;
+    }
+
+    type = ease_t::linear;
+    if (b.x1 == b.y1 && b.x2 == b.y2)
+        return;         // straight line
+
+    /*
+        bezier curve is defined parametrically, for each table point x find
+        curve parameter s with x(s) == x by bisection, than take y(s).
+        x(s) is monotonic for control points x within 0-1
+    */
+    float x1 = b.x1 / 255.0f, y1 = b.y1 / 255.0f, x2 = b.x2 / 255.0f, y2 = b.y2 / 255.0f;
+    auto bez = [](float p1, float p2, float s){
+        float r = 1 - s;
+        return 3 * r * r * s * p1 + 3 * r * s * s * p2 + s * s * s;
+    };
+
+    custom.reset(new uint16_t[EASE_LUT_POINTS], std::default_delete<uint16_t[]>());
+    for (uint32_t i = 0; i != EASE_LUT_POINTS; ++i){
+        float x = (float)i / (EASE_LUT_POINTS - 1);
+        float lo = 0, hi = 1, s = x;
+        for (int k = 0; k != 20; ++k){
+            s = (lo + hi) / 2;
+            if (bez(x1, x2, s) < x)
+                lo = s;
+            else
+                hi = s;
+        }
+        custom.get()[i] = lroundf(bez(y1, y2, s) * EASE_SCALE);
+    }
+    custom.get()[0] = 0;
+    custom.get()[EASE_LUT_POINTS - 1] = EASE_SCALE;
+    lut = custom.get();
+    type = ease_t::bezier;
+}
+
+uint16_t Easing::operator()(uint16_t t) const {
+    // progress is rescaled from 0xffff to 0x10000 == 1.0
+    uint32_t x = (uint32_t)t + (t >> 15);
+    uint32_t v;
+
+    if (!lut){
+        switch (type){
+            case ease_t::in_bounce :
+                v = 0x10000 - bounce_out(0x10000 - x);
+                break;
+            case ease_t::out_bounce :
+                v = bounce_out(x);
+                break;
+            case ease_t::inout_bounce :
+                v = x < 0x8000 ? (0x10000 - bounce_out(0x10000 - 2 * x)) / 2 : (0x10000 + bounce_out(2 * x - 0x10000)) / 2;
+                break;
+            default :
+                return t;
+        }
+        return v > EASE_SCALE ? EASE_SCALE : v;
+    }
+
+    // table position as 16.16 fixed point
+    uint32_t pos = x * (EASE_LUT_POINTS - 1);
+    uint32_t i = pos >> 16;
+    if (i >= EASE_LUT_POINTS - 1)
+        return lut[EASE_LUT_POINTS - 1];
+
+    return lut[i] + (((int64_t)lut[i+1] - lut[i]) * (pos & 0xffff) >> 16);
+}
+
+}   // namespace easing
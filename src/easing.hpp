@@ -0,0 +1,104 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#define EASE_SCALE                  0xffff          // fixed point scale for fade progress, 0xffff == 1.0
+#define EASE_LUT_POINTS             65              // table points per easing function, 64 linear segments
+
+/*
+    Easing functions for software fades
+    each function maps fade time progress to value progress, both as 0-EASE_SCALE
+    fixed point numbers. Functions are integer lookup tables with linear interpolation
+    between the points (bounce is integer piecewise quadratic), so evaluation
+    costs about the same for any easing and is cheap enough for every fade tick.
+    Formulas ref: https://easings.net/
+*/
+namespace easing {
+
+enum class ease_t:uint8_t {
+    use_default,        // use light object's own setting
+    linear,
+    in_cubic,
+    out_cubic,
+    inout_cubic,
+    in_sine,
+    out_sine,
+    inout_sine,
+    in_expo,
+    out_expo,
+    inout_expo,
+    in_bounce,
+    out_bounce,
+    inout_bounce,
+    bezier              // custom cubic-bezier curve
+};
+
+/**
+ * @brief cubic-bezier curve control points, same as CSS cubic-bezier(x1, y1, x2, y2)
+ * coordinates are scaled to 0-255 == 0.0-1.0, so no overshooting curves
+ */
+struct bezier_t {
+    uint8_t x1, y1, x2, y2;
+};
+
+/**
+ * @brief easing function
+ * a light object to be kept by fade engines for the duration of a fade,
+ * predefined functions reference const tables, a bezier curve table is
+ * calculated once on construction and shared between copies
+ */
+class Easing {
+    ease_t type;
+    const uint16_t *lut = nullptr;                  // nullptr for functions calculated directly
+    std::shared_ptr<uint16_t> custom;               // bezier table
+
+public:
+    Easing(ease_t e = ease_t::linear, bezier_t b = {0, 0, 255, 255});
+
+    /**
+     * @brief map time progress to value progress
+     *
+     * @param t - time progress, 0-EASE_SCALE
+     * @return uint16_t - value progress, 0-EASE_SCALE
+     */
+    uint16_t operator()(uint16_t t) const;
+
+    bool linear() const { return type == ease_t::linear; };
+};
+
+/**
+ * @brief value between 'from' and 'to' at eased progress
+ *
+ * @param progress - value progress, 0-EASE_SCALE
+ */
+inline uint32_t lerp(uint32_t from, uint32_t to, uint16_t progress){
+    return from + (((int64_t)to - (int64_t)from) * (progress + (progress >> 15)) >> 16);     // no division, progress rescaled to 0x10000
+}
+
+}   // namespace easing
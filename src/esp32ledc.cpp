@@ -25,6 +25,7 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 */
 
 #include "esp32ledc.hpp"
+#include "light_trace.hpp"
 
 #ifdef ARDUINO
 #include "esp32-hal-log.h"
@@ -40,6 +41,7 @@ EventGroupHandle_t PWMCtl::g_fade_evt = nullptr;
 
 
 PWMCtl::PWMCtl(){
+  reg_mtx = xSemaphoreCreateMutex();
   tmInit();
   chInit();
   // fade_func required for thread safe ledc_set_duty_and_update() function to work
@@ -48,6 +50,7 @@ PWMCtl::PWMCtl(){
 
 PWMCtl::~PWMCtl(){
   ledc_fade_func_uninstall();
+  vSemaphoreDelete(reg_mtx);
 }
     //t_cfg.speed_mode = (ledc_mode_t)(i/LEDC_TIMER_MAX);
     //t_cfg.timer_num = (ledc_timer_t)(i%LEDC_TIMER_MAX);
@@ -72,6 +75,115 @@ void PWMCtl::chInit(){
   }
 }
 
+// channel registry
+bool PWMCtl::pin_taken(int pin, uint32_t ch) const {
+  if (pin < 0)
+    return false;
+
+  for (uint32_t i = 0; i < LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX; ++i){
+    if (i != ch && channels[i].owner && channels[i].cfg.gpio_num == pin)
+      return true;
+  }
+  return false;
+}
+
+int PWMCtl::chAlloc(const void *owner, int pin){
+  if (!owner)
+    return PWM_CH_NONE;
+
+  int ch = PWM_CH_NONE;
+  xSemaphoreTake(reg_mtx, portMAX_DELAY);
+  if (!pin_taken(pin, PWM_CH_AUTO)){
+    for (uint32_t i = 0; i < LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX; ++i){
+      if (!channels[i].owner && channels[i].state == ch_state::stop){
+        channels[i].owner = owner;
+        ch = i;
+        break;
+      }
+    }
+  }
+  xSemaphoreGive(reg_mtx);
+
+  if (ch == PWM_CH_NONE)
+    ESP_LOGE(TAG, "can't allocate channel for pin:%d", pin);
+  else
+    ESP_LOGD(TAG, "allocated ch:%d for pin:%d", ch, pin);
+  return ch;
+}
+
+esp_err_t PWMCtl::chClaim(uint32_t ch, const void *owner, int pin){
+  if (!owner || ch >= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_err_t err = ESP_OK;
+  xSemaphoreTake(reg_mtx, portMAX_DELAY);
+  if (channels[ch].owner && channels[ch].owner != owner)
+    err = ESP_ERR_INVALID_STATE;
+  else if (pin_taken(pin, ch))
+    err = ESP_ERR_INVALID_STATE;
+  else
+    channels[ch].owner = owner;
+  xSemaphoreGive(reg_mtx);
+
+  if (err)
+    ESP_LOGE(TAG, "ch:%d / pin:%d conflict, already in use", ch, pin);
+  return err;
+}
+
+esp_err_t PWMCtl::chRelease(uint32_t ch, const void *owner){
+  ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
+  xSemaphoreTake(reg_mtx, portMAX_DELAY);
+  if (!owner || channels[ch].owner != owner){
+    xSemaphoreGive(reg_mtx);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (channels[ch].state == ch_state::active)
+    ledc_stop(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, channels[ch].idle_level);
+  chFadeISR(ch, false);
+
+  // back to defaults, so that next owner gets a clean channel
+  channels[ch].state = ch_state::stop;
+  channels[ch].owner = nullptr;
+  channels[ch].idle_level = 0;
+  channels[ch].cfg.gpio_num = -1;
+  channels[ch].cfg.duty = DEFAULT_PWM_DUTY;
+  channels[ch].cfg.hpoint = 0;
+  channels[ch].cfg.flags.output_invert = 0;
+  xSemaphoreGive(reg_mtx);
+
+  ESP_LOGD(TAG, "released ch:%d", ch);
+  return ESP_OK;
+}
+
+int PWMCtl::chFind(int pin) const {
+  if (pin < 0)
+    return PWM_CH_NONE;
+
+  xSemaphoreTake(reg_mtx, portMAX_DELAY);
+  int ch = PWM_CH_NONE;
+  for (uint32_t i = 0; i < LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX; ++i){
+    if (channels[i].owner && channels[i].cfg.gpio_num == pin){
+      ch = i;
+      break;
+    }
+  }
+  xSemaphoreGive(reg_mtx);
+  return ch;
+}
+
+uint32_t PWMCtl::tmGetUsers(uint8_t tm) const {
+  tm %= LEDC_SPEED_MODE_MAX * LEDC_TIMER_MAX;
+  uint32_t n = 0;
+  xSemaphoreTake(reg_mtx, portMAX_DELAY);
+  for (uint32_t i = 0; i < LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX; ++i){
+    if (channels[i].owner && chGetTimernum(i) == tm)
+      ++n;
+  }
+  xSemaphoreGive(reg_mtx);
+  return n;
+}
+
 // set channel duty
 esp_err_t PWMCtl::chDuty(uint32_t ch, uint32_t duty){
   return chDutyPhase(ch, duty, channels[ch % (LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX)].cfg.hpoint);
@@ -82,6 +194,7 @@ esp_err_t PWMCtl::chPhase(uint32_t ch, uint32_t phase){
 }
 
 esp_err_t PWMCtl::chDutyPhase(uint32_t ch, uint32_t duty, uint32_t phase){
+  LTRACE_SCOPE("PWMCtl::chDutyPhase");
   ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
   //phase %= LEDC_HPOINT_VAL_MAX;
 
@@ -99,14 +212,22 @@ esp_err_t PWMCtl::chDutyPhase(uint32_t ch, uint32_t duty, uint32_t phase){
   return ledc_set_duty_and_update(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, duty, phase);
 #endif
 
-  // Use this as a hackish workaround for older Arduino frameworks
-  if (phase)
-    ledc_set_duty_with_hpoint(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, duty, phase);
-  else
-    ledc_set_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, duty);
+  // hpoint is always written, ledc_set_duty() keeps previous hpoint and zero phase would never be set back
+  ledc_set_duty_with_hpoint(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, duty, phase);
   return ledc_update_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel);
 };
 
+esp_err_t PWMCtl::chDutyStage(uint32_t ch, uint32_t duty){
+  ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
+  channels[ch].cfg.duty = duty;
+  return ledc_set_duty_with_hpoint(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, duty, channels[ch].cfg.hpoint);
+}
+
+esp_err_t PWMCtl::chUpdate(uint32_t ch){
+  ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
+  return ledc_update_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel);
+}
+
 uint32_t PWMCtl::chGetDuty(uint32_t ch) const {
   ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
   return ledc_get_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel);
@@ -195,12 +316,9 @@ int PWMCtl::chFadeISR(uint32_t ch, bool enable){
   ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
   channels[ch].fade_cb = enable;
 
-  if (channels[ch].fade_cb){
-    ledc_cbs_t cbs = { .fade_cb = isr_fade };
-    return ledc_cb_register(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, &cbs, nullptr); // (void *)ch
-  }
-  return ESP_OK;
-  // TODO: is there any way to detach channel fade ISR cb? /it, is!/
+  // registering a null callback detaches the ISR cb
+  ledc_cbs_t cbs = { .fade_cb = enable ? isr_fade : nullptr };
+  return ledc_cb_register(channels[ch].cfg.speed_mode, channels[ch].cfg.channel, &cbs, nullptr); // (void *)ch
 }
 
 uint8_t PWMCtl::chGetTimernum(int32_t ch) const {
@@ -268,11 +386,12 @@ EventGroupHandle_t* PWMCtl::getFaderEventGroup(){
   return &g_fade_evt;
 }
 
-bool IRAM_ATTR PWMCtl::isr_fade(const ledc_cb_param_t *param, void *arg){
+bool IRAM_ATTR PWMCtl::isr_fade(const ledc_cb_param_t *param, void */*arg*/){
         portBASE_TYPE taskAwoken = pdFALSE;
 
         if (g_fade_evt && (param->event == LEDC_FADE_END_EVT)) {
-            uint32_t ch = param->channel * (param->speed_mode ? 2 : 1);
+            LTRACE_ISR("ledc::fade_end");
+            uint32_t ch = param->speed_mode * LEDC_CHANNEL_MAX + param->channel;     // same as PWMCtl channel numbering
             xEventGroupSetBitsFromISR(g_fade_evt, (1<<ch), &taskAwoken);
             //xEventGroupSetBitsFromISR(g_fade_evt, (1<<(uint32_t)arg), &taskAwoken);
         }
@@ -282,11 +401,7 @@ bool IRAM_ATTR PWMCtl::isr_fade(const ledc_cb_param_t *param, void *arg){
 
 
 uint32_t PWMCtl::chGetMaxDuty(uint32_t ch) const {
-    ch %= LEDC_SPEED_MODE_MAX * LEDC_TIMER_MAX;   // return wrap_ledc_get_max_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel); 
-
-    uint8_t chtimer = channels[ch].cfg.timer_sel;
-    if (ch / LEDC_CHANNEL_MAX)      // check if it's a LS esp32 channel
-      chtimer += LEDC_TIMER_MAX;
+    ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;   // return wrap_ledc_get_max_duty(channels[ch].cfg.speed_mode, channels[ch].cfg.channel); 
 
-    return (1 << timers[chtimer].cfg.duty_resolution) - 1;
+    return (1 << timers[chGetTimernum(ch)].cfg.duty_resolution) - 1;
 };
@@ -28,6 +28,7 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "driver/ledc.h"
 
 #define DEFAULT_PWM_FREQ            2000
@@ -36,6 +37,9 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 #define DEFAULT_PWM_DUTY            0                   //  (1<<DEFAULT_PWM_RESOLUTION - 1)     // 50% duty
 #define DEFAULT_MAX_DUTY            ((1<<DEFAULT_PWM_RESOLUTION) - 1)
 
+#define PWM_CH_AUTO                 UINT32_MAX          // allocate any free channel
+#define PWM_CH_NONE                 -1                  // no free channel available
+
 #if configUSE_16_BIT_TICKS
 #define MAX_EG_BITS                 8
 #else
@@ -91,6 +95,7 @@ struct ch {
     //bool initialized = false;
     bool idle_level = 0;
     bool fade_cb = false;
+    const void *owner = nullptr;        // object the channel is allocated to, nullptr - free
     realspeedmode_t getRealSpeedMode() const {
 #if SOC_LEDC_SUPPORT_HS_MODE
         return cfg.speed_mode ? realspeedmode_t::low : realspeedmode_t::high;
@@ -138,6 +143,7 @@ class PWMCtl {
 
     static EventGroupHandle_t g_fade_evt;
     bool faderIRQ = false;     // fader interrupt installed
+    SemaphoreHandle_t reg_mtx;  // channel registry lock
 
 public:
     // this is a singleton
@@ -153,6 +159,58 @@ public:
     }
 
 
+    // Channel registry
+
+    /**
+     * @brief allocate a free channel
+     * channel is reserved for the owner until released
+     *
+     * @param owner - object allocating the channel, i.e. a light
+     * @param pin - gpio the channel is going to drive, -1 if not known yet
+     * @return int - channel number, PWM_CH_NONE if there are no free channels or pin is taken
+     */
+    int chAlloc(const void *owner, int pin = -1);
+
+    /**
+     * @brief reserve a specific channel
+     *
+     * @param ch - channel number
+     * @param owner - object allocating the channel
+     * @param pin - gpio the channel is going to drive, -1 if not known yet
+     * @return esp_err_t - ESP_ERR_INVALID_STATE if channel belongs to another owner
+     * or pin is driven by another channel, ESP_OK if channel is reserved (or was already reserved for the same owner)
+     */
+    esp_err_t chClaim(uint32_t ch, const void *owner, int pin = -1);
+
+    /**
+     * @brief release channel reserved by the owner
+     * channel is stopped with it's idle level, fade ISR is detached
+     * and channel config is reset to defaults
+     *
+     * @return esp_err_t - ESP_ERR_INVALID_STATE if channel is not reserved by the owner
+     */
+    esp_err_t chRelease(uint32_t ch, const void *owner);
+
+    /**
+     * @brief get owner of a channel
+     *
+     * @return const void* - nullptr if channel is free
+     */
+    const void *chGetOwner(uint32_t ch) const { return channels[ch % (LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX)].owner; };
+
+    /**
+     * @brief find reserved channel driving a gpio
+     *
+     * @return int - channel number, PWM_CH_NONE if none
+     */
+    int chFind(int pin) const;
+
+    /**
+     * @brief number of reserved channels clocked by a timer
+     */
+    uint32_t tmGetUsers(uint8_t tm) const;
+
+
     // Channel methods
     int chStart(uint32_t ch, int pin = -1);
     int chStop(uint32_t ch);
@@ -164,6 +222,14 @@ public:
     esp_err_t chPhase(uint32_t ch, uint32_t phase);
     esp_err_t chDutyPhase(uint32_t ch, uint32_t duty, uint32_t phase);
 
+    /**
+     * @brief set channel duty without updating the output
+     * staged duty is applied with chUpdate(), so that a number of channels
+     * could be changed at once
+     */
+    esp_err_t chDutyStage(uint32_t ch, uint32_t duty);
+    esp_err_t chUpdate(uint32_t ch);
+
     uint32_t chGetDuty(uint32_t ch) const;
 
     /**
@@ -208,6 +274,9 @@ private:
     // configure channel with current options
     int chCfg(uint32_t ch);
 
+    // check if pin is driven by a reserved channel other than 'ch', must be called under lock
+    bool pin_taken(int pin, uint32_t ch) const;
+
     /**
     * "Fade ended" callback function will be called on any channed fade operation has ended
     * it is called from an ISR, so I just send an event to the common Event Group and let it
@@ -25,6 +25,9 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 */
 
 #include "esp32ledc_fader.hpp"
+#include "light_trace.hpp"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
 
 // LOGGING
 #ifdef ARDUINO
@@ -43,16 +46,150 @@ using namespace luma;
 
 
 // *** *** //
-// FadeEngineHW methods
-bool FadeEngineHW::fade(uint32_t duty, uint32_t duration){
+// hardware fade helpers
+static bool hw_fade(uint32_t ch, uint32_t duty, uint32_t duration){
     return !ledc_set_fade_time_and_start(
-      PWMCtl::getInstance()->chGet(channel)->cfg.speed_mode,
-      PWMCtl::getInstance()->chGet(channel)->cfg.channel,
+      PWMCtl::getInstance()->chGet(ch)->cfg.speed_mode,
+      PWMCtl::getInstance()->chGet(ch)->cfg.channel,
       duty,
       duration,
       LEDC_FADE_NO_WAIT);
 }
 
+static bool hw_stop(uint32_t ch){
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    return !ledc_fade_stop(
+      PWMCtl::getInstance()->chGet(ch)->cfg.speed_mode,
+      PWMCtl::getInstance()->chGet(ch)->cfg.channel);
+#else
+    return false;
+#endif
+}
+
+// FadeEngine methods
+uint32_t FadeEngine::busy() const {
+    int64_t left = fade_end - esp_timer_get_time();
+    return left > 0 ? (left + 999) / 1000 : 0;
+}
+
+// FadeEngineHW methods
+bool FadeEngineHW::fade(uint32_t duty, uint32_t duration, const easing::Easing &/*e*/){
+    if (!hw_fade(channel, duty, duration))
+      return false;
+
+    fade_end = esp_timer_get_time() + (int64_t)duration * 1000;
+    return true;
+}
+
+bool FadeEngineHW::stop(){
+    if (!busy())
+      return true;
+
+    if (!hw_stop(channel))
+      return false;
+
+    fade_end = 0;
+    return true;
+}
+
+// FadeEngineSeg methods
+bool FadeEngineSeg::fade(uint32_t duty, uint32_t duration, const easing::Easing &e){
+  stop();
+  from = PWMCtl::getInstance()->chGetDuty(channel);
+  to = duty;
+  this->duration = duration;
+  curve = e;
+  segments = e.linear() || duration < FADE_SEGMENTS ? 1 : FADE_SEGMENTS;
+  seg = 0;
+  start = esp_timer_get_time();
+  fade_end = start + (int64_t)duration * 1000;
+  active = true;
+
+  // first segment is started right away, ticker takes the rest
+  uint32_t next = tick(start);
+  if (next)
+    LightTicker::getInstance()->attach(this, next);
+  return true;
+}
+
+bool FadeEngineSeg::stop(){
+  LightTicker::getInstance()->detach(this);
+  if (!active)
+    return true;
+
+  if (!hw_stop(channel)){
+    // segment can't be stopped, it's short enough to let it finish, busy() reports it's end
+    fade_end = start + (int64_t)boundary(seg) * 1000;
+    return false;
+  }
+
+  active = false;
+  fade_end = 0;
+  return true;
+}
+
+uint32_t FadeEngineSeg::tick(int64_t now){
+  if (!active)
+    return 0;
+
+  uint32_t elapsed = (now - start) / 1000;
+  if (seg == segments){
+    if (elapsed < duration)
+      return duration - elapsed;      // last segment is still running
+
+    active = false;
+    if (on_end)
+      on_end();
+    return 0;
+  }
+
+  // previous segment should be over by now, stop it in case of a timer skew, otherwise new fade would block
+  hw_stop(channel);
+  ++seg;
+  uint32_t d = seg == segments ? to : easing::lerp(from, to, curve((uint64_t)boundary(seg) * EASE_SCALE / duration));
+  uint32_t len = boundary(seg) > elapsed ? boundary(seg) - elapsed : 1;
+  hw_fade(channel, d, len);
+  return len;
+}
+
+// FadeEngineSW methods
+bool FadeEngineSW::fade(uint32_t duty, uint32_t duration, const easing::Easing &e){
+  LightTicker::getInstance()->detach(this);
+  from = PWMCtl::getInstance()->chGetDuty(channel);
+  to = duty;
+  this->duration = duration;
+  curve = e;
+  start = esp_timer_get_time();
+  fade_end = start + (int64_t)duration * 1000;
+  active = true;
+  LightTicker::getInstance()->attach(this);
+  return true;
+}
+
+bool FadeEngineSW::stop(){
+  active = false;
+  fade_end = 0;
+  LightTicker::getInstance()->detach(this);
+  return true;
+}
+
+uint32_t FadeEngineSW::tick(int64_t now){
+  if (!active)
+    return 0;
+
+  int64_t elapsed = now - start;
+  int64_t total = (int64_t)duration * 1000;
+  if (elapsed >= total){
+    active = false;
+    PWMCtl::getInstance()->chDuty(channel, to);
+    if (on_end)
+      on_end();
+    return 0;
+  }
+
+  PWMCtl::getInstance()->chDuty(channel, easing::lerp(from, to, curve(elapsed * EASE_SCALE / total)));
+  return LightTicker::getInstance()->getPeriod();
+}
 
 
 /*
@@ -81,7 +218,17 @@ FadeCtrl::FadeCtrl( uint32_t mask ) : events_mask(mask){
 }
 
 FadeCtrl::~FadeCtrl(){
-  vTaskDelete(t_fade_evt);
+  for (uint8_t i = 0; i != LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX; ++i){
+    if (chf[i].fe)
+      releaseFader(i);
+  }
+
+  // events task is either waiting for events or blocked on the lock, never in a callback
+  LightTicker::getInstance()->lock();
+  if (t_fade_evt)
+    vTaskDelete(t_fade_evt);
+  t_fade_evt = nullptr;
+  LightTicker::getInstance()->unlock();
 }
 
 void FadeCtrl::fd_events_handler(){
@@ -98,6 +245,7 @@ void FadeCtrl::fd_events_handler(){
       (portTickType)portMAX_DELAY
     );
 
+    LightTicker::getInstance()->lock();
     //x &= events_mask;
     int i = 0;
     do {
@@ -107,8 +255,8 @@ void FadeCtrl::fd_events_handler(){
           chf[i].cb(i, fade_event_t::fade_end);   // trigger callback with 'fade_end'
       }
       x >>= 1;
-    } while (++i < LEDC_CHANNEL_MAX);
-    //printf("\n");
+    } while (++i < LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX);
+    LightTicker::getInstance()->unlock();
   }
   vTaskDelete(NULL);
 }
@@ -119,36 +267,105 @@ bool FadeCtrl::nofade(uint8_t ch, uint32_t duty){
     return PWMCtl::getInstance()->chDuty(ch, duty);
 };
 
+FadeEngine *FadeCtrl::mk_engine(uint8_t ch, fade_engine_t fe){
+    // fade end of software driven engines goes the same way as LEDC ISR's one
+    auto on_end = [this, ch](){
+      if (eg_fade_evt)
+        xEventGroupSetBits(*eg_fade_evt, 1 << ch);
+    };
+
+    switch (fe){
+      case fade_engine_t::software :
+        return new FadeEngineSW(ch, on_end);
+      case fade_engine_t::segmented :
+        return new FadeEngineSeg(ch, on_end);
+      case fade_engine_t::linear_hw :
+        return new FadeEngineHW(ch);
+      default :
+        return nullptr;
+    }
+}
+
+void FadeCtrl::engine_halt(uint8_t ch, FadeEngine *fe){
+    LightTicker::getInstance()->lock();
+    bool stopped = fe->stop();
+    LightTicker::getInstance()->unlock();
+
+    // fade can't be stopped, wait for it to finish, ticker and fade events are not blocked meanwhile
+    if (!stopped){
+      while (uint32_t left = fe->busy())
+        vTaskDelay(pdMS_TO_TICKS(left) + 1);
+    }
+
+    // drop fade end event that might be pending for the channel
+    if (eg_fade_evt)
+      xEventGroupClearBits(*eg_fade_evt, 1 << ch);
+}
+
 bool FadeCtrl::setFader(uint8_t ch, fade_engine_t fe, fe_callback_t f){
     ch %= LEDC_SPEED_MODE_MAX*LEDC_CHANNEL_MAX;
 
-    ESP_LOGD(TAG, "setFader ch:%d, err:%d\n", ch, PWMCtl::getInstance()->chFadeISR(ch, true));
-
+    LightTicker::getInstance()->lock();
     if (f)
       chf[ch].cb = std::move(f);
 
-    // todo: fade_engine_t fe може опделеять движек отличный от ledc hw
-
-    // todo: пересоздавать объект при повторном вызове или пропускать?
-    if (!chf[ch].fe){
-      chf[ch].fe = new FadeEngineHW(ch);
-      return chf[ch].fe ? true : false;
+    if (getFader(ch) == fe){
+      LightTicker::getInstance()->unlock();
+      return fe != fade_engine_t::none;
     }
 
-    return false;
+    // channel takes no fades while the old engine is halted, that is done without the lock
+    FadeEngine *old = chf[ch].fe;
+    chf[ch].fe = nullptr;
+    LightTicker::getInstance()->unlock();
+    if (old)
+      engine_halt(ch, old);
+
+    LightTicker::getInstance()->lock();
+    chf[ch].fe = mk_engine(ch, fe);
+    // only hardware engine needs LEDC fade end interrupts
+    PWMCtl::getInstance()->chFadeISR(ch, fe == fade_engine_t::linear_hw);
+    LightTicker::getInstance()->unlock();
+
+    delete old;
+    ESP_LOGD(TAG, "setFader ch:%d, engine:%d", ch, (int)fe);
+    return chf[ch].fe ? true : false;
+}
+
+void FadeCtrl::releaseFader(uint8_t ch){
+    ch %= LEDC_SPEED_MODE_MAX*LEDC_CHANNEL_MAX;
+    setFader(ch, fade_engine_t::none);
+    // callbacks are run under the lock, so once it's taken no callback is running
+    LightTicker::getInstance()->lock();
+    chf[ch].cb = nullptr;
+    LightTicker::getInstance()->unlock();
+}
+
+bool FadeCtrl::fadeStop(uint8_t ch){
+    ch %= LEDC_SPEED_MODE_MAX*LEDC_CHANNEL_MAX;
+    LightTicker::getInstance()->lock();
+    bool r = chf[ch].fe ? chf[ch].fe->stop() : true;
+    LightTicker::getInstance()->unlock();
+    return r;
+}
+
+fade_engine_t FadeCtrl::getFader(uint8_t ch) const {
+    ch %= LEDC_SPEED_MODE_MAX*LEDC_CHANNEL_MAX;
+    return chf[ch].fe ? chf[ch].fe->engine : fade_engine_t::none;
 }
 
-bool FadeCtrl::fadebyTime(uint8_t ch, uint32_t duty, uint32_t duration){
-    ch %= LEDC_SPEED_MODE_MAX * LEDC_TIMER_MAX;
+bool FadeCtrl::fadebyTime(uint8_t ch, uint32_t duty, uint32_t duration, const easing::Easing &e){
+    LTRACE_SCOPE("FadeCtrl::fadebyTime");
+    ch %= LEDC_SPEED_MODE_MAX * LEDC_CHANNEL_MAX;
+    LightTicker::getInstance()->lock();
     if (!chf[ch].fe){
+      LightTicker::getInstance()->unlock();
       return nofade(ch, duty);  // do a no-fade duty change if no FadeEngine installed for the channel 
     }
 
-    if(chf[ch].fe->fade(duty, duration)){     // run async fade
-      if (chf[ch].cb)
-        chf[ch].cb(ch, fade_event_t::fade_start);     // trigger callback with 'fade_start'
-      return true;
-    } else
-      return false;
+    bool r = chf[ch].fe->fade(duty, duration, e);     // run async fade
+    if (r && chf[ch].cb)
+      chf[ch].cb(ch, fade_event_t::fade_start);     // trigger callback with 'fade_start'
+    LightTicker::getInstance()->unlock();
+    return r;
 }
-
@@ -27,13 +27,16 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 #pragma once
 #include "esp32ledc.hpp"
 #include "luma_curves.hpp"
+#include "easing.hpp"
+#include "light_ticker.hpp"
 #include <functional>
 
 
 #define DEFAULT_FADE_TIME           1000           // ms
+#define FADE_SEGMENTS               8              // number of hardware fades an eased segmented fade is split to
 
 // a list of implemented fade engines
-enum class fade_engine_t:uint8_t { none, linear_hw };
+enum class fade_engine_t:uint8_t { none, linear_hw, software, segmented };
 
 // a list of fade engine events
 enum class fade_event_t:uint8_t {
@@ -53,6 +56,7 @@ class FadeEngine {
 protected:
     uint32_t channel;                               // PWMCtl channel to work on (not the esp32 channel)
     uint32_t fade_duration = DEFAULT_FADE_TIME;
+    int64_t fade_end = 0;                           // us, end time of the last fade started
 
 public:
     const fade_engine_t engine;
@@ -63,7 +67,31 @@ public:
     FadeEngine(const FadeEngine&) = delete;
     FadeEngine& operator=(const FadeEngine&) = delete;
 
-    virtual bool fade(uint32_t duty, uint32_t duration) = 0;     // pure virtual method, must be redefined in derived classes
+    /**
+     * @brief start fade on engine's channel
+     *
+     * @param duty - target duty
+     * @param duration - fade duration, ms
+     * @param e - easing function, engines that do not support easing run linear fades
+     * @return true - fade has started
+     */
+    virtual bool fade(uint32_t duty, uint32_t duration, const easing::Easing &e) = 0;     // pure virtual method, must be redefined in derived classes
+
+    /**
+     * @brief stop fade in progress, channel holds current duty
+     * no fade end event is triggered for a stopped fade
+     *
+     * @return true - fade is stopped or there was no fade
+     * @return false - engine can't stop a fade
+     */
+    virtual bool stop(){ return true; };
+
+    /**
+     * @brief time left until fade in progress ends
+     *
+     * @return uint32_t - ms, 0 if engine is idle
+     */
+    uint32_t busy() const;
 };
 
 class FadeEngineHW : public FadeEngine {
@@ -75,7 +103,69 @@ public:
     FadeEngineHW(uint32_t ch) : FadeEngine(ch, fade_engine_t::linear_hw) { PWMCtl::getInstance()->chFadeISR(ch, true); };
     virtual ~FadeEngineHW(){};
 
-    virtual bool fade(uint32_t duty, uint32_t duration) override;
+    // hardware fades are linear only, easing is ignored
+    virtual bool fade(uint32_t duty, uint32_t duration, const easing::Easing &e) override;
+
+    // requires IDF 5.0 or later, earlier versions have no API to stop a fade
+    virtual bool stop() override;
+};
+
+/**
+ * @brief Segmented fade engine
+ * eased fade is split into FADE_SEGMENTS linear hardware fades between points of the
+ * easing curve, so duty is interpolated by LEDC and engine only wakes up on segment
+ * boundaries. Linear fades are run as a single hardware fade.
+ * Segments' fade end interrupts are not used, fade end callback is called from
+ * the LightTicker's task once the last segment is over
+ */
+class FadeEngineSeg : public FadeEngine, public TickClient {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    int64_t start = 0;                  // us
+    uint32_t duration = 0;              // ms
+    easing::Easing curve;
+    uint8_t segments = 0;               // segments in current fade
+    uint8_t seg = 0;                    // next segment to start
+    bool active = false;
+    std::function<void ()> on_end;
+
+    // segment boundary time since fade start, ms
+    uint32_t boundary(uint8_t s) const { return (uint64_t)duration * s / segments; };
+
+public:
+    FadeEngineSeg(uint32_t ch, std::function<void ()> end_cb = nullptr) : FadeEngine(ch, fade_engine_t::segmented), on_end(end_cb) {};
+    virtual ~FadeEngineSeg(){ LightTicker::getInstance()->detach(this); };
+
+    virtual bool fade(uint32_t duty, uint32_t duration, const easing::Easing &e) override;
+
+    virtual bool stop() override;
+
+    uint32_t tick(int64_t now) override;
+};
+
+/**
+ * @brief Software fade engine
+ * duty is updated on each LightTicker's tick, fades could follow any easing curve.
+ * Fade end callback is called from the ticker's task
+ */
+class FadeEngineSW : public FadeEngine, public TickClient {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    int64_t start = 0;                  // us
+    uint32_t duration = 0;              // ms
+    easing::Easing curve;
+    bool active = false;
+    std::function<void ()> on_end;
+
+public:
+    FadeEngineSW(uint32_t ch, std::function<void ()> end_cb = nullptr) : FadeEngine(ch, fade_engine_t::software), on_end(end_cb) {};
+    virtual ~FadeEngineSW(){ LightTicker::getInstance()->detach(this); };
+
+    virtual bool fade(uint32_t duty, uint32_t duration, const easing::Easing &e) override;
+
+    virtual bool stop() override;
+
+    uint32_t tick(int64_t now) override;
 };
 
 
@@ -95,6 +185,13 @@ class FadeCtrl {
     // channel faders array
     ChannelFader chf[LEDC_SPEED_MODE_MAX*LEDC_CHANNEL_MAX];
 
+    /*
+        chf[] is guarded with LightTicker's lock, software engines run under it
+        and ticker clients start fades, so a lock of it's own would be taken in
+        reverse order by those. Callbacks are run under the lock, so an engine
+        or callback is never swapped while in use
+    */
+
     PWMCtl *pwm;
     uint32_t events_mask;                        // bit mask for channel event group
     TaskHandle_t t_fade_evt = nullptr;           // fade events ISR task handler
@@ -117,23 +214,50 @@ class FadeCtrl {
      */
     bool nofade(uint8_t ch, uint32_t duty);
 
+    /**
+     * @brief create fade engine of specified type
+     * software engines report fade end via the same event group as the LEDC ISR,
+     * so that all callbacks are run from the fade events task
+     */
+    FadeEngine *mk_engine(uint8_t ch, fade_engine_t fe);
+
+    /**
+     * @brief stop engine and wait for a fade it can't stop to finish
+     * an interrupt of such a fade is discarded. Waiting is done without
+     * LightTicker's lock, caller must not hold it
+     */
+    void engine_halt(uint8_t ch, FadeEngine *fe);
+
 
 public:
     FadeCtrl( uint32_t mask = CH_EVENTS_BIT_MASK );     // channel mask might be needed in case of several FadeCtrl's instances (hipotheticaly)
-    ~FadeCtrl();    // **** todo ****: destruct faders
+    ~FadeCtrl();
 
     /**
      * @brief Set the Fader engine for the channel
-     * activate fade engine for the specified ledc channel
+     * activate fade engine for the specified ledc channel. An engine of another
+     * type installed on the channel is replaced, fade in progress is stopped
+     * and channel holds the duty reached. Hardware fades that can't be stopped
+     * (IDF < 5.0) are waited for, so the call might block up to the fade's duration.
+     * Should not be called with LightTicker's lock held, it is released for the wait
      * 
      * @param ch - channel to activate fade engine on
-     * @param fe - type of fade engine (to be done)
-     * @param f - callback function to call on fader events for this specific channel
-     * @return true 
-     * @return false 
+     * @param fe - type of fade engine, fade_engine_t::none removes the engine
+     * @param f - callback function to call on fader events for this specific channel, nullptr keeps current one
+     * @return true - engine is installed
+     * @return false - engine type is not supported
      */
     bool setFader(uint8_t ch, fade_engine_t fe, fe_callback_t f = nullptr );
 
+    /**
+     * @brief remove fade engine and callback from the channel
+     * fade in progress is stopped, channel is left with no fade engine.
+     * Once returned, callback is not running and won't be called anymore
+     *
+     * @param ch - esp32ledc channel
+     */
+    void releaseFader(uint8_t ch);
+
     /**
      * @brief start fade action on channel
      * runs fade engine on the specified channel
@@ -141,10 +265,26 @@ public:
      * @param ch - esp32ledc channel (NOT IDF's one with speed mode)
      * @param duty - target duty to fade to
      * @param duration - fade duration
+     * @param e - easing function, used by software engine only
      * @return true - async fade has started
      * @return false - failed to start async fade
      */
-    bool fadebyTime(uint8_t ch, uint32_t duty, uint32_t duration);
+    bool fadebyTime(uint8_t ch, uint32_t duty, uint32_t duration, const easing::Easing &e = easing::Easing());
+
+    /**
+     * @brief stop fade in progress on channel
+     * channel holds duty reached by the moment of stop, no fade end event is triggered
+     *
+     * @param ch - esp32ledc channel
+     * @return true - channel is not fading anymore
+     * @return false - fade engine can't stop the fade
+     */
+    bool fadeStop(uint8_t ch);
+
+    /**
+     * @brief Get type of fade engine installed on the channel
+     */
+    fade_engine_t getFader(uint8_t ch) const;
 
     //void setCurve(uint8_t ch, luma::curve curve){ ch %= LEDC_SPEED_MODE_MAX * LEDC_TIMER_MAX; chf[ch].l_curve = curve; }
 
@@ -0,0 +1,431 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_automation.hpp"
+#include "esp_timer.h"
+#include <algorithm>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "automation";
+
+
+template <typename F>
+void Automation::DepIndex::build(size_t keys, rule_state_t const *rules, size_t n, F key){
+    offs.reset(new uint16_t[keys + 1]());
+    for (size_t r = 0; r != n; ++r){
+        int k = key(rules[r]);
+        if (k >= 0)
+            ++offs[k + 1];
+    }
+    for (size_t k = 0; k != keys; ++k)
+        offs[k + 1] += offs[k];
+
+    items.reset(new uint16_t[offs[keys] ? offs[keys] : 1]);
+    std::unique_ptr<uint16_t[]> fill(new uint16_t[keys ? keys : 1]);
+    std::copy(offs.get(), offs.get() + keys, fill.get());
+    // rules are added in order, so each list is sorted by rule index
+    for (size_t r = 0; r != n; ++r){
+        int k = key(rules[r]);
+        if (k >= 0)
+            items[fill[k]++] = r;
+    }
+}
+
+
+Automation::Automation() : ticker(this) {
+    if (esp_event_handler_instance_register_with(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, ESP_EVENT_ANY_ID, Automation::event_hndlr, this, &sensor_instance) != ESP_OK)
+        ESP_LOGW(TAG, "event loop subscribe failed for %s", LSENSOR_EVENTS);
+}
+
+Automation::~Automation(){
+    if (sensor_instance)
+        esp_event_handler_instance_unregister_with(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, ESP_EVENT_ANY_ID, sensor_instance);
+    stop();
+}
+
+void Automation::event_hndlr(void* handler_args, esp_event_base_t /*base*/, int32_t id, void* event_data){
+    auto e = reinterpret_cast<local_sensor_evt*>(event_data);
+    if (!static_cast<Automation*>(handler_args)->setInput(id, e->type, e->value))
+        ESP_LOGD(TAG, "sensor %d: reading of type %u ignored", id, (unsigned)e->type);
+}
+
+int Automation::add(automation_rule_t const &r){
+    if (r.gate != AUTOMATION_NO_RULE && (r.gate < 0 || r.gate >= (int32_t)defs.size())){
+        // gate should be evaluated before the rule, so only preceding rules are allowed
+        ESP_LOGW(TAG, "rule %d: bad gate %d", defs.size(), r.gate);
+        return -1;
+    }
+    if (defs.size() >= INT16_MAX){
+        ESP_LOGW(TAG, "rules table is full");
+        return -1;
+    }
+    defs.add(r);
+    return defs.size() - 1;
+}
+
+int Automation::addSchedule(int32_t target, uint32_t from, uint32_t to, uint32_t level, int32_t gate){
+    automation_rule_t r = {};
+    r.type = rule_t::schedule;
+    r.target = target;
+    r.gate = gate;
+    r.level = level;
+    r.from = from % 86400;
+    r.to = to % 86400;
+    return add(r);
+}
+
+int Automation::addOccupancy(int32_t target, int32_t sensor, uint32_t timeout, uint32_t level, int32_t gate){
+    automation_rule_t r = {};
+    r.type = rule_t::occupancy;
+    r.target = target;
+    r.sensor = sensor;
+    r.gate = gate;
+    r.level = level;
+    r.timeout = timeout;
+    return add(r);
+}
+
+int Automation::addDaylight(int32_t target, int32_t sensor, int32_t lux, uint32_t level, int32_t gate){
+    if (lux <= 0)
+        return -1;
+    automation_rule_t r = {};
+    r.type = rule_t::daylight;
+    r.target = target;
+    r.sensor = sensor;
+    r.gate = gate;
+    r.level = level;
+    r.lux = lux;
+    return add(r);
+}
+
+void Automation::clear(){
+    stop();
+    LightTicker::getInstance()->lock();
+    defs.clear();
+    nrules = ninputs = ntargets = 0;
+    rules.reset();
+    inputs.reset();
+    targets.reset();
+    LightTicker::getInstance()->unlock();
+}
+
+bool Automation::start(){
+    stop();
+    size_t n = defs.size();
+    if (!n)
+        return false;
+
+    std::unique_ptr<rule_state_t[]> r(new rule_state_t[n]());
+    LList<int32_t> sensors, gids;
+    int i = 0;
+    for (auto const &d : defs){
+        r[i++].def = d;
+        if (d.type != rule_t::schedule && std::find(sensors.begin(), sensors.end(), d.sensor) == sensors.end())
+            sensors.add(d.sensor);
+        if (std::find(gids.begin(), gids.end(), d.target) == gids.end())
+            gids.add(d.target);
+    }
+
+    // inputs are kept sorted by sensor id for lookups
+    std::unique_ptr<input_t[]> in(new input_t[sensors.size() ? sensors.size() : 1]());
+    i = 0;
+    for (auto s : sensors)
+        in[i++].sensor = s;
+    std::sort(in.get(), in.get() + sensors.size(), [](input_t const &a, input_t const &b){ return a.sensor < b.sensor; });
+
+    std::unique_ptr<target_t[]> tg(new target_t[gids.size()]());
+    i = 0;
+    for (auto g : gids)
+        tg[i++] = {g, -1, false};
+
+    LightTicker::getInstance()->lock();
+    rules = std::move(r);
+    inputs = std::move(in);
+    targets = std::move(tg);
+    nrules = n;
+    ninputs = sensors.size();
+    ntargets = gids.size();
+
+    for (i = 0; i != nrules; ++i){
+        auto &x = rules[i];
+        x.input = x.def.type == rule_t::schedule ? -1 : input_idx(x.def.sensor);
+        if (x.input >= 0)
+            inputs[x.input].type = x.def.type == rule_t::occupancy ? sensor_t::occupancy : sensor_t::lux;
+        for (uint16_t t = 0; t != ntargets; ++t)
+            if (targets[t].gid == x.def.target)
+                x.tgt = t;
+    }
+
+    input_deps.build(ninputs, rules.get(), nrules, [](rule_state_t const &x){ return (int)x.input; });
+    gate_deps.build(nrules, rules.get(), nrules, [](rule_state_t const &x){ return (int)x.def.gate; });
+    target_rules.build(ntargets, rules.get(), nrules, [](rule_state_t const &x){ return (int)x.tgt; });
+
+    size_t words = (nrules + 31) / 32;
+    dirty.reset(new uint32_t[words]());
+    dirty_cnt = 0;
+    dirty_from = 0;
+    changed.reset(new uint16_t[ninputs ? ninputs : 1]);
+    changed_cnt = 0;
+    pending.reset(new uint16_t[ntargets]);
+    next_wake = 0;
+
+    // everything is evaluated on the first tick and each target gets it's level
+    for (i = 0; i != nrules; ++i)
+        mark(i);
+    for (i = 0; i != ntargets; ++i){
+        targets[i].dirty = true;
+        pending[i] = i;
+    }
+    pending_cnt = ntargets;
+
+    running = true;
+    LightTicker::getInstance()->attach(&ticker);
+    LightTicker::getInstance()->unlock();
+    ESP_LOGI(TAG, "compiled %u rules, %u inputs, %u targets", nrules, ninputs, ntargets);
+    return true;
+}
+
+void Automation::stop(){
+    LightTicker::getInstance()->lock();
+    LightTicker::getInstance()->detach(&ticker);
+    running = false;
+    LightTicker::getInstance()->unlock();
+}
+
+int Automation::input_idx(int32_t sensor) const {
+    auto end = inputs.get() + ninputs;
+    auto it = std::lower_bound(inputs.get(), end, sensor, [](input_t const &a, int32_t s){ return a.sensor < s; });
+    return it != end && it->sensor == sensor ? it - inputs.get() : -1;
+}
+
+bool Automation::setInput(int32_t sensor, sensor_t type, int32_t value){
+    LightTicker::getInstance()->lock();
+    int i = running ? input_idx(sensor) : -1;
+    if (i < 0 || (type != sensor_t::generic && type != inputs[i].type)){
+        LightTicker::getInstance()->unlock();
+        return false;
+    }
+
+    auto &in = inputs[i];
+    if (in.value != value){
+        in.value = value;
+        if (!in.changed){
+            in.changed = true;
+            changed[changed_cnt++] = i;
+        }
+    }
+    LightTicker::getInstance()->unlock();
+    return true;
+}
+
+void Automation::setTimeOfDay(int32_t sec){
+    LightTicker::getInstance()->lock();
+    clock.set(sec);
+    // schedules' due times are no longer valid
+    if (running)
+        mark_type(rule_t::schedule);
+    LightTicker::getInstance()->unlock();
+}
+
+uint32_t Automation::getTimeOfDay() const {
+    return clock.sec();
+}
+
+int32_t Automation::getRuleLevel(int r) const {
+    if (r < 0 || r >= nrules || !rules[r].on)
+        return -1;
+    return rules[r].value;
+}
+
+void Automation::mark(uint16_t r){
+    uint32_t &w = dirty[r / 32];
+    if (w & 1u << r % 32)
+        return;
+    w |= 1u << r % 32;
+    ++dirty_cnt;
+    if (r / 32 < dirty_from)
+        dirty_from = r / 32;
+}
+
+void Automation::mark_type(rule_t t){
+    for (uint16_t i = 0; i != nrules; ++i)
+        if (rules[i].def.type == t)
+            mark(i);
+}
+
+bool Automation::rule_eval(rule_state_t &r, int64_t now, uint32_t tod){
+    auto const &d = r.def;
+    uint32_t value = d.level;
+    int32_t in = r.input < 0 ? 0 : inputs[r.input].value;
+
+    switch (d.type){
+        case rule_t::schedule : {
+            uint32_t from = d.from * 1000, to = d.to * 1000;
+            r.held = from <= to ? tod >= from && tod < to : tod >= from || tod < to;
+            // wake up on the nearest window edge
+            uint32_t edge = r.held ? to : from;
+            r.wake = now + (int64_t)((edge + AUTOMATION_DAY_MS - tod) % AUTOMATION_DAY_MS ? (edge + AUTOMATION_DAY_MS - tod) % AUTOMATION_DAY_MS : AUTOMATION_DAY_MS) * 1000;
+            break;
+        }
+        case rule_t::occupancy :
+            if (in){
+                r.held = true;
+                r.wake = 0;
+            } else if (r.held && !r.wake && d.timeout){
+                r.wake = now + (int64_t)d.timeout * 1000000;     // presence is gone, hold for a timeout
+            } else if (!r.wake || now >= r.wake){
+                r.held = false;
+                r.wake = 0;
+            }
+            break;
+        case rule_t::daylight : {
+            r.held = true;
+            int32_t lack = d.lux - std::max(in, 0);
+            uint32_t raw = lack > 0 ? (uint64_t)d.level * lack / d.lux : 0;
+            uint32_t step = std::max<uint32_t>(d.level / AUTOMATION_DAYLIGHT_STEPS, 1);
+            // keep current level within a step of hysteresis, lux readings are noisy
+            if (r.on && (raw > r.value ? raw - r.value : r.value - raw) <= step)
+                value = r.value;
+            else
+                value = (raw + step / 2) / step * step;
+            break;
+        }
+    }
+
+    bool on = r.held && (d.gate == AUTOMATION_NO_RULE || rules[d.gate].on);
+    bool changed = on != r.on || (on && value != r.value);
+    r.on = on;
+    r.value = value;
+    return changed;
+}
+
+uint32_t Automation::tick(int64_t now){
+    if (!running)
+        return 0;
+
+    // inputs changed since last tick
+    for (uint16_t c = 0; c != changed_cnt; ++c){
+        uint16_t i = changed[c];
+        inputs[i].changed = false;
+        for (uint16_t k = input_deps.offs[i]; k != input_deps.offs[i + 1]; ++k)
+            mark(input_deps.items[k]);
+    }
+    changed_cnt = 0;
+
+    // due timers, table is scanned only when one has fired
+    if (next_wake && now >= next_wake){
+        next_wake = 0;
+        for (uint16_t i = 0; i != nrules; ++i){
+            int64_t w = rules[i].wake;
+            if (!w)
+                continue;
+            if (now >= w)
+                mark(i);
+            else if (!next_wake || w < next_wake)
+                next_wake = w;
+        }
+    }
+
+    if (dirty_cnt){
+        uint32_t tod = clock.ms(now);
+        size_t words = (nrules + 31) / 32;
+        // gated rules always follow their gates, so marks made on the way are picked up by the same pass
+        for (size_t w = dirty_from; w != words && dirty_cnt; ++w){
+            while (dirty[w]){
+                uint16_t i = w * 32 + __builtin_ctz(dirty[w]);
+                dirty[w] &= dirty[w] - 1;
+                --dirty_cnt;
+                auto &r = rules[i];
+                if (rule_eval(r, now, tod)){
+                    for (uint16_t k = gate_deps.offs[i]; k != gate_deps.offs[i + 1]; ++k)
+                        mark(gate_deps.items[k]);
+                    auto &t = targets[r.tgt];
+                    if (!t.dirty){
+                        t.dirty = true;
+                        pending[pending_cnt++] = r.tgt;
+                    }
+                }
+                if (r.wake && (!next_wake || r.wake < next_wake))
+                    next_wake = r.wake;
+            }
+        }
+        dirty_from = words;
+    }
+
+    if (pending_cnt)
+        targets_issue();
+
+    return tick_period;
+}
+
+void Automation::targets_issue(){
+    local_cmd_evt cmd = {};
+    cmd.event = light_event_id_t::goValueScaled;
+    cmd.id = {ID_ANONYMOUS, ID_ANY};
+    cmd.scale = brtscale;
+    cmd.fade_duration = fade;
+
+    uint16_t left = 0;
+    for (uint16_t p = 0; p != pending_cnt; ++p){
+        uint16_t ti = pending[p];
+        auto &t = targets[ti];
+
+        // target gets the max level of it's active rules
+        int32_t level = 0;
+        for (uint16_t k = target_rules.offs[ti]; k != target_rules.offs[ti + 1]; ++k){
+            auto const &r = rules[target_rules.items[k]];
+            if (r.on && (int32_t)r.value > level)
+                level = r.value;
+        }
+
+        if (level == t.issued){
+            t.dirty = false;
+            continue;
+        }
+
+        /*
+         * tick runs under the ticker lock, a loop handler might be waiting for it,
+         * so do not block on a full queue, target is retried on the next tick
+         */
+        cmd.value = level;
+        esp_err_t err = esp_event_post_to(*lightmgr::get_light_evts_loop(), LCMD_EVENTS, t.gid, &cmd, sizeof(cmd), 0);
+        if (err != ESP_OK){
+            ESP_LOGD(TAG, "group %d: command post failed: %s", t.gid, esp_err_to_name(err));
+            pending[left++] = ti;
+            continue;
+        }
+        ESP_LOGD(TAG, "group %d: level %d", t.gid, level);
+        t.issued = level;
+        t.dirty = false;
+    }
+    pending_cnt = left;
+}
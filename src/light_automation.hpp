@@ -0,0 +1,312 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "lightevents.hpp"
+#include "light_ticker.hpp"
+#include "light_generics.hpp"
+#include "LList.h"
+#include <memory>
+
+#define AUTOMATION_TICK             1000            // ms, rules evaluation period
+#define AUTOMATION_FADE             1000            // ms, default fade duration for commands issued by rules
+#define AUTOMATION_DAYLIGHT_STEPS   20              // daylight rule output quantization, steps per rule's level
+#define AUTOMATION_NO_RULE          -1
+
+#define AUTOMATION_DAY_MS           LIGHT_DAY_MS
+
+/**
+ * @brief automation rule types
+ */
+enum class rule_t:uint8_t {
+    schedule,           // on within a time of day window
+    occupancy,          // on while sensor reports presence and for a timeout after
+    daylight            // level is reduced proportionally to daylight illuminance
+};
+
+/**
+ * @brief automation rule definition
+ */
+struct automation_rule_t {
+    rule_t type;
+    int32_t target;             // group id commands are posted to
+    int32_t sensor;             // occupancy or lux sensor id, unused for schedules
+    int32_t gate;               // index of a rule this one is active with only, AUTOMATION_NO_RULE - always active
+    uint32_t level;             // output brightness, in engine's scale
+    uint32_t from, to;          // schedule window, seconds of day [from, to), wraps over midnight if from > to
+    uint32_t timeout;           // occupancy hold time after last presence, s
+    int32_t lux;                // daylight target illuminance, lx
+};
+
+/**
+ * @brief Occupancy and schedule driven automation
+ *
+ * Rules are added first and compiled into a table on start(). Each rule produces
+ * an on/off state and a brightness level for it's target group, the target gets
+ * the max level of it's active rules, or goes off when none is active.
+ *
+ * Rules are evaluated on a fixed tick from LightTicker's task, but only those that could
+ * have changed - compiled table keeps an index of rules depending on each sensor and on each
+ * gating rule, schedules and occupancy timeouts keep their next due time. So a tick costs
+ * nothing unless a sensor has reported a new value or a timer is due. Commands are issued
+ * for targets which level has changed only, all changes of a tick are posted at once, an
+ * EcloGroup on target's gid applies each in one pass.
+ *
+ * Sensor readings are taken from LSENSOR_EVENTS or set directly with setInput().
+ * Time of day is taken from system's clock, or could be set explicitly to be run on a
+ * simulated clock
+ */
+class Automation {
+
+    class Ticker : public TickClient {
+        Automation *a;
+    public:
+        Ticker(Automation *x) : a(x){};
+        uint32_t tick(int64_t now) override { return a->tick(now); };
+    };
+
+    // compiled rule with it's evaluation state
+    struct rule_state_t {
+        automation_rule_t def;
+        int16_t input;              // index in inputs table, -1 for none
+        uint16_t tgt;               // index in targets table
+        bool held;                  // rule's own condition
+        bool on;                    // condition and gate
+        uint32_t value;
+        int64_t wake;               // us, time rule should be reevaluated at, 0 - not needed
+    };
+
+    struct input_t {
+        int32_t sensor;
+        int32_t value;
+        sensor_t type;              // readings expected by the rules using this sensor
+        bool changed;
+    };
+
+    struct target_t {
+        int32_t gid;
+        int32_t issued;             // last level posted, -1 - none yet
+        bool dirty;
+    };
+
+    /**
+     * @brief compiled dependency index
+     * rule lists for each key packed in one array, key k owns items[offs[k]] to items[offs[k+1]]
+     */
+    struct DepIndex {
+        std::unique_ptr<uint16_t[]> offs;
+        std::unique_ptr<uint16_t[]> items;
+
+        /**
+         * @brief build index
+         *
+         * @param keys - number of keys
+         * @param rules - rules table
+         * @param n - number of rules
+         * @param key - rule's key, <0 if rule is not indexed
+         */
+        template <typename F>
+        void build(size_t keys, rule_state_t const *rules, size_t n, F key);
+    };
+
+    LList<automation_rule_t> defs;              // rules as added, compiled on start
+
+    // compiled table
+    std::unique_ptr<rule_state_t[]> rules;
+    std::unique_ptr<input_t[]> inputs;
+    std::unique_ptr<target_t[]> targets;
+    uint16_t nrules = 0, ninputs = 0, ntargets = 0;
+    DepIndex input_deps;                        // rules depending on an input
+    DepIndex gate_deps;                         // rules gated by a rule
+    DepIndex target_rules;                      // rules driving a target
+
+    // pending work
+    std::unique_ptr<uint32_t[]> dirty;          // bitmap of rules to reevaluate
+    uint16_t dirty_cnt = 0;
+    uint16_t dirty_from = 0;                    // first bitmap word with a bit set
+    std::unique_ptr<uint16_t[]> changed;        // inputs changed since last tick
+    uint16_t changed_cnt = 0;
+    std::unique_ptr<uint16_t[]> pending;        // targets to recalculate
+    uint16_t pending_cnt = 0;
+    int64_t next_wake = 0;                      // nearest rule's wake time, 0 - none
+
+    Ticker ticker;
+    uint32_t tick_period = AUTOMATION_TICK;
+    int32_t brtscale = DEFAULT_SCALE;
+    uint32_t fade = AUTOMATION_FADE;
+    bool running = false;
+
+    // time of day anchored to monotonic clock, system clock is used if not set
+    DayClock clock;
+
+    esp_event_handler_instance_t sensor_instance = nullptr;
+
+    static void event_hndlr(void* handler_args, esp_event_base_t base, int32_t id, void* event_data);
+
+    uint32_t tick(int64_t now);
+
+    void mark(uint16_t r);
+
+    /**
+     * @brief evaluate rule
+     *
+     * @return true if rule's output has changed
+     */
+    bool rule_eval(rule_state_t &r, int64_t now, uint32_t tod);
+
+    /**
+     * @brief post level changes of pending targets
+     * targets which post has failed are kept pending to be retried on the next tick
+     */
+    void targets_issue();
+
+    // mark all rules of a type for reevaluation, caller holds the ticker lock
+    void mark_type(rule_t t);
+
+    int add(automation_rule_t const &r);
+
+    int input_idx(int32_t sensor) const;
+
+public:
+    Automation();
+    ~Automation();
+
+    // no copy
+    Automation(Automation const&) = delete;
+    void operator=(Automation const&) = delete;
+
+    /**
+     * @brief add time of day schedule
+     * target is on within [from, to) window
+     *
+     * @param target - group id
+     * @param from - seconds of day
+     * @param to - seconds of day, window wraps over midnight if less than 'from'
+     * @param level - brightness, in engine's scale
+     * @param gate - rule index this rule is active with only
+     * @return int - rule index or -1 on error
+     */
+    int addSchedule(int32_t target, uint32_t from, uint32_t to, uint32_t level, int32_t gate = AUTOMATION_NO_RULE);
+
+    /**
+     * @brief add occupancy rule
+     * target is on while the sensor reports presence and for a timeout after
+     *
+     * @param target - group id
+     * @param sensor - occupancy sensor id
+     * @param timeout - hold time, s
+     * @param level - brightness, in engine's scale
+     * @param gate - rule index this rule is active with only
+     * @return int - rule index or -1 on error
+     */
+    int addOccupancy(int32_t target, int32_t sensor, uint32_t timeout, uint32_t level, int32_t gate = AUTOMATION_NO_RULE);
+
+    /**
+     * @brief add daylight harvesting rule
+     * open loop: level is reduced by the share of target illuminance provided by daylight,
+     * output is quantized to AUTOMATION_DAYLIGHT_STEPS with a step of hysteresis
+     *
+     * @param target - group id
+     * @param sensor - lux sensor id
+     * @param lux - target illuminance
+     * @param level - brightness with no daylight, in engine's scale
+     * @param gate - rule index this rule is active with only, i.e. an occupancy rule
+     * @return int - rule index or -1 on error
+     */
+    int addDaylight(int32_t target, int32_t sensor, int32_t lux, uint32_t level, int32_t gate = AUTOMATION_NO_RULE);
+
+    /**
+     * @brief drop all rules, stops the engine
+     */
+    void clear();
+
+    /**
+     * @brief compile rules table and start evaluation
+     * all rules are evaluated on the first tick and each target gets it's level
+     *
+     * @return true on success
+     */
+    bool start();
+    void stop();
+
+    /**
+     * @brief set sensor's value
+     * change is picked up on the next tick, unknown sensors are ignored
+     *
+     * @return true if sensor is used by rules
+     */
+    bool setInput(int32_t sensor, int32_t value){ return setInput(sensor, sensor_t::generic, value); };
+
+    /**
+     * @brief set sensor's value with a typed reading
+     * readings of a type other than the one rules expect from the sensor are ignored,
+     * sensor_t::generic is accepted by any rule
+     *
+     * @return true if reading is accepted
+     */
+    bool setInput(int32_t sensor, sensor_t type, int32_t value);
+
+    /**
+     * @brief set time of day
+     * engine's clock then follows monotonic clock from this point
+     *
+     * @param sec - seconds of day, <0 - use system's clock
+     */
+    void setTimeOfDay(int32_t sec);
+
+    /**
+     * @brief time of day as seen by the rules, s
+     */
+    uint32_t getTimeOfDay() const;
+
+    /**
+     * @brief Set scale for rule levels
+     */
+    void setScale(int32_t s){ if (s > 0) brtscale = s; };
+
+    /**
+     * @brief Set fade duration for issued commands, ms
+     */
+    void setFade(uint32_t ms){ fade = ms; };
+
+    /**
+     * @brief Set rules evaluation period, ms
+     */
+    void setTickPeriod(uint32_t ms){ if (ms) tick_period = ms; };
+
+    /**
+     * @brief number of compiled rules
+     */
+    int size() const { return nrules; };
+
+    /**
+     * @brief rule's current output
+     *
+     * @param r - rule index
+     * @return int32_t - level, -1 if rule is not active or not compiled
+     */
+    int32_t getRuleLevel(int r) const;
+};
@@ -0,0 +1,178 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_cct.hpp"
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "light_cct";
+
+CCTLight::CCTLight(DimmableLight *warmch, DimmableLight *coolch, const cct_calibration_t &calibration, luma::curve lcurve) :
+    GenericLight(lightsource_t::tunable, 0, lcurve), warm(warmch), cool(coolch), cal(calibration) {
+    kelvin = cal.warm_k;
+    mix_update();
+    warm->onChangeAttach([this](){ ch_change(CCT_CH_WARM); });
+    cool->onChangeAttach([this](){ ch_change(CCT_CH_COOL); });
+}
+
+void CCTLight::mix_update(){
+    if (cal.cool_k <= cal.warm_k)
+        cal.cool_k = cal.warm_k + 1;
+
+    // constant flux is limited by the weaker channel
+    float lm = cal.warm_lm < cal.cool_lm ? cal.warm_lm : cal.cool_lm;
+    float mw = 1e6f / cal.warm_k;
+    float mc = 1e6f / cal.cool_k;
+    float pmax = 0;
+
+    for (uint32_t i = 0; i <= CCT_MIX_STEPS; ++i){
+        // table steps are evenly spaced in kelvins, mixing ratio is linear in mireds
+        float k = cal.warm_k + float(cal.cool_k - cal.warm_k) * i / CCT_MIX_STEPS;
+        float x = (mw - 1e6f / k) / (mw - mc);          // cool channel share of the flux
+        float w = cal.warm_lm > 0 ? (1 - x) * lm / cal.warm_lm : 0;
+        float c = cal.cool_lm > 0 ? x * lm / cal.cool_lm : 0;
+        mix[i].warm = w * 0xffff + 0.5f;
+        mix[i].cool = c * 0xffff + 0.5f;
+
+        float p = w * warm->getMaxPower() + c * cool->getMaxPower();
+        if (p > pmax)
+            pmax = p;
+    }
+    power = pmax;
+    ESP_LOGD(TAG, "mixing table %u-%uK, max power:%.2f", cal.warm_k, cal.cool_k, power);
+}
+
+CCTLight::mix_t CCTLight::gains() const {
+    uint32_t k = kelvin < cal.warm_k ? cal.warm_k : (kelvin > cal.cool_k ? cal.cool_k : kelvin);
+    // table position, 16.16 fixed point
+    uint32_t pos = ((uint64_t)(k - cal.warm_k) * CCT_MIX_STEPS << 16) / (cal.cool_k - cal.warm_k);
+    uint32_t idx = pos >> 16;
+    if (idx >= CCT_MIX_STEPS)
+        return mix[CCT_MIX_STEPS];
+
+    int64_t frac = pos & 0xffff;
+    const mix_t &a = mix[idx];
+    const mix_t &b = mix[idx + 1];
+    return mix_t{
+        (uint16_t)(a.warm + (((int64_t)b.warm - a.warm) * frac >> 16)),
+        (uint16_t)(a.cool + (((int64_t)b.cool - a.cool) * frac >> 16))
+    };
+}
+
+void CCTLight::ch_change(uint8_t ch){
+    if (!(pending & ch))
+        return;
+
+    pending &= ~ch;
+    if (!pending)
+        onChange();
+}
+
+// gain * brightness -> channel duty, integer only
+static inline uint32_t ch_duty(uint16_t gain, uint32_t brt, uint32_t max_duty){
+    return ((uint64_t)((uint32_t)gain * brt) * max_duty + 0x7fffffff) >> 32;
+}
+
+void CCTLight::set_to_value(uint32_t val){
+    pending = 0;
+    value = val > CCT_LIGHT_MAX_VALUE ? CCT_LIGHT_MAX_VALUE : val;
+    ftrack.set(value);
+    mix_t g = gains();
+
+    warm->stageValue(ch_duty(g.warm, value, warm->getMaxValue()));
+    cool->stageValue(ch_duty(g.cool, value, cool->getMaxValue()));
+    warm->flush();
+    cool->flush();
+    onChange();
+}
+
+void CCTLight::fade_to_value(uint32_t val, int32_t duration, const easing::Easing &e){
+    if (duration < 0)
+        duration = fadetime;
+
+    if (!duration)
+        return set_to_value(val);
+
+    uint32_t from = fade_value();
+    value = val > CCT_LIGHT_MAX_VALUE ? CCT_LIGHT_MAX_VALUE : val;
+    mix_t g = gains();
+    // both channels fade along the same curve in duty, so the total flux follows it too
+    pending = 0;
+    warm->fade_to_value(ch_duty(g.warm, value, warm->getMaxValue()), duration, e);
+    cool->fade_to_value(ch_duty(g.cool, value, cool->getMaxValue()), duration, e);
+    fade_track(from, value, duration, warm->ftrack.curve);     // channels' engine decides on easing
+
+    // channels that could not fade have been set already
+    pending = (warm->isFading() ? CCT_CH_WARM : 0) | (cool->isFading() ? CCT_CH_COOL : 0);
+    if (!pending){
+        ftrack.set(value);
+        onChange();
+    }
+}
+
+void CCTLight::fade_halt(){
+    pending = 0;
+    warm->fade_halt();
+    cool->fade_halt();
+    value = fade_value();
+    ftrack.set(value);
+}
+
+light_caps_t CCTLight::mk_caps() const {
+    light_caps_t c = GenericLight::mk_caps();
+    light_caps_t const &w = warm->getCaps();
+    light_caps_t const &k = cool->getCaps();
+    c.flags |= LCAP_CCT | (w.flags & k.flags & (LCAP_FADE | LCAP_EASING));
+    if (c.flags & LCAP_FADE)
+        c.fade_step = w.fade_step > k.fade_step ? w.fade_step : k.fade_step;
+    return c;
+}
+
+void CCTLight::setEasing(easing::ease_t e, easing::bezier_t b){
+    GenericLight::setEasing(e, b);
+    warm->setEasing(e, b);
+    cool->setEasing(e, b);
+}
+
+void CCTLight::cct_preset(uint16_t k){
+    kelvin = k < cal.warm_k ? cal.warm_k : (k > cal.cool_k ? cal.cool_k : k);
+}
+
+void CCTLight::setCCT(uint16_t k, int32_t duration){
+    cct_preset(k);
+    fade_to_value(value, duration, fade_easing());
+}
+
+void CCTLight::setCalibration(const cct_calibration_t &calibration){
+    cal = calibration;
+    mix_update();
+    setCCT(kelvin, 0);
+}
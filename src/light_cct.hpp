@@ -0,0 +1,136 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_generics.hpp"
+
+#define CCT_LIGHT_MAX_VALUE         0xffff          // brightness is a 16 bit linear intensity
+#define CCT_MIX_STEPS               32              // mixing table steps between warm and cool CCT
+#define CCT_DEFAULT_WARM_K          2700
+#define CCT_DEFAULT_COOL_K          6500
+#define CCT_CH_WARM                 1
+#define CCT_CH_COOL                 2
+
+/**
+ * @brief tunable white fixture calibration
+ * CCT and luminous flux of each channel at full duty
+ */
+struct cct_calibration_t {
+    uint16_t warm_k = CCT_DEFAULT_WARM_K;
+    uint16_t cool_k = CCT_DEFAULT_COOL_K;
+    float warm_lm = 1.0;
+    float cool_lm = 1.0;
+};
+
+/**
+ * @brief Tunable white light on warm and cool white dimmable channels
+ * brightness and color temperature are controlled separately. Channels are mixed
+ * in mired space and total flux is kept constant over the whole CCT range, so
+ * changing CCT does not change brightness. Full brightness is limited by the weaker
+ * channel, that is the flux available at both CCT range ends.
+ * Mixing table is precomputed on calibration change, so an update is integer-only
+ *
+ */
+class CCTLight : public GenericLight {
+
+    // channel gains at full brightness, fraction of channel's max duty, 16 bit
+    struct mix_t {
+        uint16_t warm;
+        uint16_t cool;
+    };
+
+    std::unique_ptr<DimmableLight> warm;
+    std::unique_ptr<DimmableLight> cool;
+    cct_calibration_t cal;
+    mix_t mix[CCT_MIX_STEPS + 1];
+    uint32_t value = 0;                             // brightness, linear, fade target while fading
+    uint16_t kelvin;                                // current CCT
+    uint8_t pending = 0;                            // channels a fade end is waited from, CCT_CH_* bits
+
+    // rebuild mixing table and max power for current calibration
+    void mix_update();
+
+    // get channel gains for current CCT
+    mix_t gains() const;
+
+    // channel has reported a state change, fixture's fade end is reported once both channels are done
+    void ch_change(uint8_t ch);
+
+    void set_to_value(uint32_t value) override;
+    void fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e) override;
+    void fade_halt() override;
+    void cct_preset(uint16_t k) override;
+
+    // fades are run by the channels, those are supported if both channels support it
+    light_caps_t mk_caps() const override;
+
+public:
+    /**
+     * @brief Construct a new CCT Light object
+     * channel lights are owned by the CCTLight object and will be destroyed with it.
+     * Channels max power should be set prior to construction, fixture max power is
+     * derived from it
+     *
+     * @param warmch - warm white channel
+     * @param coolch - cool white channel
+     * @param calibration - fixture calibration
+     * @param lcurve - brightness luma curve
+     */
+    CCTLight(DimmableLight *warmch, DimmableLight *coolch, const cct_calibration_t &calibration = cct_calibration_t(), luma::curve lcurve = luma::curve::cie1931);
+
+    // *** Overrides *** //
+    uint32_t getValue()     const override { return fade_value(); };
+    uint32_t getMaxValue()  const override { return CCT_LIGHT_MAX_VALUE; };
+    float getCurrentPower() const override { return warm->getCurrentPower() + cool->getCurrentPower(); };
+    float setMaxPower(float /*p*/) override { return power; }     // max power is derived from channels and calibration
+    void setEasing(easing::ease_t e, easing::bezier_t b = {0, 0, 255, 255}) override;
+
+    // Own methods
+
+    /**
+     * @brief set color temperature, brightness is not changed
+     * value is clamped to calibration CCT range
+     *
+     * @param k - color temperature, K
+     * @param duration - fade duration
+     */
+    void setCCT(uint16_t k, int32_t duration = USE_DEFAULT) override;
+    uint16_t getCCT() const override { return kelvin; };
+
+    /**
+     * @brief set fixture calibration
+     * mixing table is rebuilt and current state reapplied
+     */
+    void setCalibration(const cct_calibration_t &calibration);
+    const cct_calibration_t &getCalibration() const { return cal; };
+
+    /**
+     * @brief access channel lights
+     * channels' state change callbacks are used by the fixture and should not be replaced
+     */
+    DimmableLight *getWarm(){ return warm.get(); };
+    DimmableLight *getCool(){ return cool.get(); };
+};
@@ -0,0 +1,249 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_circadian.hpp"
+#include <algorithm>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "circadian";
+
+#define HMS(h, m)       ((h) * 3600 + (m) * 60)
+
+// built-in profile, percents of DEFAULT_SCALE
+static const struct { uint32_t tod; uint8_t level; uint16_t kelvin; } default_profile[] = {
+    {HMS( 0,  0),    0, 2200},
+    {HMS( 6,  0),    0, 2200},
+    {HMS( 7,  0),   40, 2700},
+    {HMS(10,  0),  100, 5000},
+    {HMS(13,  0),  100, 6500},
+    {HMS(17,  0),   80, 4000},
+    {HMS(20,  0),   40, 2700},
+    {HMS(22,  0),   10, 2200},
+    {HMS(23,  0),    0, 2200},
+};
+
+
+bool CircadianScheduler::addLight(GenericLight *l){
+    if (!l)
+        return false;
+
+    LightTicker::getInstance()->lock();
+    lights.add(l);
+    update();
+    LightTicker::getInstance()->unlock();
+    return true;
+}
+
+bool CircadianScheduler::addPoint(uint32_t tod, uint32_t level, uint16_t kelvin){
+    if (tod >= LIGHT_DAY_MS / 1000 || !kelvin)
+        return false;
+
+    LightTicker::getInstance()->lock();
+    points.add({tod, level, kelvin});
+    update();
+    LightTicker::getInstance()->unlock();
+    return true;
+}
+
+void CircadianScheduler::clearPoints(){
+    LightTicker::getInstance()->lock();
+    points.clear();
+    update();
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::setStep(uint32_t sec){
+    if (!sec || sec > LIGHT_DAY_MS / 1000)
+        return;
+
+    LightTicker::getInstance()->lock();
+    step = sec;
+    update();
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::setPowerBudget(float watts){
+    LightTicker::getInstance()->lock();
+    budget = watts > 0 ? watts : 0;
+    update();
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::setTimeOfDay(int32_t sec){
+    LightTicker::getInstance()->lock();
+    clock.set(sec);
+    // lights are on a track to the wrong entry
+    if (running){
+        synced = false;
+        LightTicker::getInstance()->attach(&ticker);
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::start(){
+    LightTicker::getInstance()->lock();
+    running = true;
+    update();
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::stop(){
+    LightTicker::getInstance()->lock();
+    running = false;
+    LightTicker::getInstance()->detach(&ticker);
+    LightTicker::getInstance()->unlock();
+}
+
+void CircadianScheduler::update(){
+    if (!running)
+        return;
+
+    build();
+    synced = false;
+    LightTicker::getInstance()->attach(&ticker);
+}
+
+void CircadianScheduler::build(){
+    // sorted profile, built-in one if none is set
+    size_t n = points.size();
+    std::unique_ptr<point_t[]> p;
+    if (n){
+        p.reset(new point_t[n]);
+        size_t i = 0;
+        for (auto const &pt : points)
+            p[i++] = {pt.tod, pt.level * LIGHT_LUMA_RESOLUTION / brtscale, pt.kelvin};
+    } else {
+        n = sizeof(default_profile) / sizeof(default_profile[0]);
+        p.reset(new point_t[n]);
+        for (size_t i = 0; i != n; ++i)
+            p[i] = {default_profile[i].tod, (uint32_t)default_profile[i].level * LIGHT_LUMA_RESOLUTION / DEFAULT_SCALE, default_profile[i].kelvin};
+    }
+    std::stable_sort(p.get(), p.get() + n, [](point_t const &a, point_t const &b){ return a.tod < b.tod; });
+
+    entries = (LIGHT_DAY_MS / 1000 + step - 1) / step;
+    table.reset(new entry_t[entries]);
+    float full = power_at(LIGHT_LUMA_RESOLUTION);
+    for (uint32_t i = 0; i != entries; ++i){
+        entry_t e = profile_at(p.get(), n, i * step);
+
+        // highest level within the budget, power grows with level for any curve
+        if (budget && full > budget && power_at(e.level) > budget){
+            uint32_t lo = 0, hi = e.level;
+            while (hi - lo > 1){
+                uint32_t mid = (lo + hi) / 2;
+                if (power_at(mid) > budget)
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            e.level = lo;
+        }
+        table[i] = e;
+    }
+    ESP_LOGD(TAG, "day table: %u entries, step %us, lights:%u, power at full:%.2fW, budget:%.2fW", entries, step, lights.size(), full, budget);
+}
+
+CircadianScheduler::entry_t CircadianScheduler::profile_at(point_t const *p, size_t n, uint32_t tod) const {
+    const uint32_t day = LIGHT_DAY_MS / 1000;
+    // keypoint at or before tod, wraps to the last one of the previous day
+    size_t k = n - 1;
+    for (size_t i = 0; i != n && p[i].tod <= tod; ++i)
+        k = i;
+    point_t const &a = p[k];
+    point_t const &b = p[(k + 1) % n];
+
+    entry_t ea = {(uint16_t)std::min<uint32_t>(a.level, LIGHT_LUMA_RESOLUTION), a.kelvin};
+    entry_t eb = {(uint16_t)std::min<uint32_t>(b.level, LIGHT_LUMA_RESOLUTION), b.kelvin};
+    uint32_t span = (b.tod + day - a.tod) % day;
+    if (!span)
+        return ea;
+    return interpolate(ea, eb, (float)((tod + day - a.tod) % day) / span);
+}
+
+CircadianScheduler::entry_t CircadianScheduler::interpolate(entry_t const &a, entry_t const &b, float f){
+    entry_t e;
+    e.level = a.level + (b.level - a.level) * f + 0.5f;
+    // CCT is perceived uniformly in mired space
+    float ma = 1e6f / a.kelvin, mb = 1e6f / b.kelvin;
+    e.kelvin = 1e6f / (ma + (mb - ma) * f) + 0.5f;
+    return e;
+}
+
+float CircadianScheduler::power_at(uint32_t level) const {
+    float p = 0;
+    for (auto l : lights){
+        uint32_t max = l->getMaxValue();
+        if (max)
+            p += l->getMaxPower() * luma::curveMap(l->getCurve(), level, max, LIGHT_LUMA_RESOLUTION) / max;
+    }
+    return p;
+}
+
+uint32_t CircadianScheduler::step_len(uint32_t idx) const {
+    return std::min<uint32_t>((idx + 1) * step * 1000, LIGHT_DAY_MS) - idx * step * 1000;
+}
+
+void CircadianScheduler::apply(entry_t const &e, uint32_t duration){
+    // one fade per light toward both brightness and CCT
+    for (auto l : lights)
+        l->goValueCCT(e.level, LIGHT_LUMA_RESOLUTION, e.kelvin, duration);
+}
+
+uint32_t CircadianScheduler::tick(int64_t now){
+    if (!running || !entries)
+        return 0;
+
+    ++wakeups;
+    uint32_t tod = clock.ms(now);
+    uint32_t idx = tod / (step * 1000);
+    uint32_t left = step_len(idx) - (tod - idx * step * 1000);      // ms, until the next entry
+    uint32_t next = (idx + 1) % entries;
+
+    if (!synced){
+        synced = true;
+        // lights could be anywhere, catch up with the table first unless the next entry is close enough
+        if (left > catchup + CIRCADIAN_MIN_FADE){
+            apply(interpolate(table[idx], table[next], 1.0f - (float)left / step_len(idx)), catchup);
+            return catchup;
+        }
+    }
+
+    // tick has come just before an entry, the fade to it has been done already
+    if (left < CIRCADIAN_MIN_FADE){
+        left += step_len(next);
+        next = (next + 1) % entries;
+    }
+
+    ESP_LOGD(TAG, "tod %us: entry %u, level:%u, %uK in %ums", tod / 1000, next, table[next].level, table[next].kelvin, left);
+    apply(table[next], left);
+    return left;
+}
@@ -0,0 +1,195 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_ticker.hpp"
+#include "light_generics.hpp"
+#include "LList.h"
+#include <memory>
+
+#define CIRCADIAN_STEP              1200            // s, day table step
+#define CIRCADIAN_CATCHUP           5000            // ms, fade to the table on start
+#define CIRCADIAN_MIN_FADE          2000            // ms, shorter remainders of a step are merged into the next one
+
+/**
+ * @brief Circadian brightness and color temperature scheduler
+ *
+ * A day profile is set with keypoints of brightness and CCT, those are interpolated
+ * into a day table of (brightness, CCT) entries at fixed steps once, on start. Brightness
+ * is interpolated in perceptual units, CCT in mired space, profile wraps at midnight.
+ * Lights then track the table with a single long fade per step, each fade ends at
+ * the next entry exactly on it's time, so scheduler wakes up only once per step,
+ * the rest is done by lights' fade engines. LEDC lights should use the software engine
+ * for fades that long, LEDC hardware caps PWM cycles per duty step, so hardware and
+ * segmented fades of a small change over a step end early.
+ *
+ * Color temperature is set for lights with LCAP_CCT capability, including composites
+ * of tunable lights, others follow brightness only. With a power budget set, table's
+ * brightness is capped so that lights' combined power at full duty share never exceeds it
+ */
+class CircadianScheduler {
+
+    class Ticker : public TickClient {
+        CircadianScheduler *s;
+    public:
+        Ticker(CircadianScheduler *x) : s(x){};
+        uint32_t tick(int64_t now) override { return s->tick(now); };
+    };
+
+    struct point_t {
+        uint32_t tod;               // s of day
+        uint32_t level;             // brightness, scale units
+        uint16_t kelvin;
+    };
+
+    struct entry_t {
+        uint16_t level;             // brightness, LIGHT_LUMA_RESOLUTION units
+        uint16_t kelvin;
+    };
+
+    LList<point_t> points;
+    LList<GenericLight*> lights;
+    std::unique_ptr<entry_t[]> table;
+    uint16_t entries = 0;
+    uint32_t step = CIRCADIAN_STEP;
+    uint32_t catchup = CIRCADIAN_CATCHUP;
+    int32_t brtscale = DEFAULT_SCALE;
+    float budget = 0;               // W, 0 - no limit
+    DayClock clock;
+    Ticker ticker;
+    bool running = false;
+    bool synced = false;            // lights are on the table's track
+    uint32_t wakeups = 0;
+
+    uint32_t tick(int64_t now);
+
+    // build day table from the profile, caller holds the ticker lock
+    void build();
+
+    // rebuild table and resync lights if running
+    void update();
+
+    // profile value at time of day, s
+    entry_t profile_at(point_t const *p, size_t n, uint32_t tod) const;
+
+    // lights' combined power at brightness level, W
+    float power_at(uint32_t level) const;
+
+    // step length, ms, the last one could be shorter to end at midnight
+    uint32_t step_len(uint32_t idx) const;
+
+    // fade lights to entry
+    void apply(entry_t const &e, uint32_t duration);
+
+    static entry_t interpolate(entry_t const &a, entry_t const &b, float f);
+
+public:
+    CircadianScheduler() : ticker(this){};
+    ~CircadianScheduler(){ stop(); };
+
+    // no copy
+    CircadianScheduler(CircadianScheduler const&) = delete;
+    void operator=(CircadianScheduler const&) = delete;
+
+    /**
+     * @brief add a light to follow the schedule
+     *
+     * @return true on success
+     */
+    bool addLight(GenericLight *l);
+
+    /**
+     * @brief add profile keypoint
+     * a built-in profile is used if none are set
+     *
+     * @param tod - time of day, s
+     * @param level - brightness, scale units
+     * @param kelvin - color temperature, K
+     * @return true on success
+     */
+    bool addPoint(uint32_t tod, uint32_t level, uint16_t kelvin);
+
+    /**
+     * @brief remove all profile keypoints
+     */
+    void clearPoints();
+
+    /**
+     * @brief Set brightness scale for keypoints, default is DEFAULT_SCALE
+     */
+    void setScale(int32_t scale){ if (scale > 0) brtscale = scale; };
+
+    /**
+     * @brief Set day table step, s
+     * each step is a single scheduler wakeup
+     */
+    void setStep(uint32_t sec);
+
+    /**
+     * @brief Set duration of the fade to the table on start or time change, ms
+     */
+    void setCatchUp(uint32_t ms){ catchup = ms; };
+
+    /**
+     * @brief Set power budget for the lights
+     *
+     * @param watts - combined power limit, 0 - no limit
+     */
+    void setPowerBudget(float watts);
+
+    /**
+     * @brief set time of day
+     * scheduler's clock then follows monotonic clock from this point
+     *
+     * @param sec - seconds of day, <0 - use system's clock
+     */
+    void setTimeOfDay(int32_t sec);
+
+    /**
+     * @brief time of day as seen by the scheduler, s
+     */
+    uint32_t getTimeOfDay() const { return clock.sec(); };
+
+    /**
+     * @brief build the day table and start tracking it
+     */
+    void start();
+
+    /**
+     * @brief stop tracking, lights are left as is
+     */
+    void stop();
+
+    /**
+     * @brief number of day table entries
+     */
+    uint16_t size() const { return entries; };
+
+    /**
+     * @brief scheduler wakeups since construction
+     */
+    uint32_t getWakeups() const { return wakeups; };
+};
@@ -0,0 +1,283 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_daylight.hpp"
+#include <algorithm>
+#include <cmath>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "daylight";
+
+
+DaylightHarvester::DaylightHarvester() : ticker(this) {
+    if (esp_event_handler_instance_register_with(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, ESP_EVENT_ANY_ID, DaylightHarvester::event_hndlr, this, &sensor_instance) != ESP_OK)
+        ESP_LOGW(TAG, "event loop subscribe failed for %s", LSENSOR_EVENTS);
+}
+
+DaylightHarvester::~DaylightHarvester(){
+    if (sensor_instance)
+        esp_event_handler_instance_unregister_with(*lightmgr::get_light_evts_loop(), LSENSOR_EVENTS, ESP_EVENT_ANY_ID, sensor_instance);
+    stop();
+    for (auto z : zones)
+        delete z;
+}
+
+void DaylightHarvester::event_hndlr(void* handler_args, esp_event_base_t /*base*/, int32_t id, void* event_data){
+    auto e = reinterpret_cast<local_sensor_evt*>(event_data);
+    if (e->type == sensor_t::lux)
+        static_cast<DaylightHarvester*>(handler_args)->setInput(id, e->value);
+}
+
+DaylightHarvester::Zone *DaylightHarvester::zone(int idx) const {
+    if (idx < 0 || idx >= (int)zones.size())
+        return nullptr;
+    for (auto z : zones)
+        if (!idx--)
+            return z;
+    return nullptr;
+}
+
+int DaylightHarvester::addZone(int32_t sensor, uint32_t target, uint32_t lux_full){
+    if (!lux_full)
+        return -1;
+
+    Zone *z = new Zone;
+    z->sensor = sensor;
+    z->target = target;
+    z->lux_full = lux_full;
+    LightTicker::getInstance()->lock();
+    zones.add(z);
+    int idx = zones.size() - 1;
+    LightTicker::getInstance()->unlock();
+    return idx;
+}
+
+bool DaylightHarvester::addLight(int idx, GenericLight *l){
+    Zone *z = zone(idx);
+    if (!z || !l)
+        return false;
+
+    LightTicker::getInstance()->lock();
+    z->outputs.add({l, -1, -1, 0});
+    LightTicker::getInstance()->unlock();
+    return true;
+}
+
+void DaylightHarvester::setTarget(int idx, uint32_t lux){
+    if (Zone *z = zone(idx)){
+        LightTicker::getInstance()->lock();
+        z->target = lux;
+        LightTicker::getInstance()->unlock();
+    }
+}
+
+void DaylightHarvester::setGains(int idx, float kp, float ki){
+    if (Zone *z = zone(idx)){
+        LightTicker::getInstance()->lock();
+        z->kp = kp;
+        z->ki = ki;
+        LightTicker::getInstance()->unlock();
+    }
+}
+
+void DaylightHarvester::setRate(int idx, uint32_t rate){
+    Zone *z = zone(idx);
+    if (!z || !rate)
+        return;
+
+    LightTicker::getInstance()->lock();
+    z->rate = rate;
+    LightTicker::getInstance()->unlock();
+}
+
+void DaylightHarvester::enable(int idx, bool state){
+    Zone *z = zone(idx);
+    if (!z)
+        return;
+
+    LightTicker::getInstance()->lock();
+    if (state && !z->enabled){
+        z->integral = 0;
+        z->last = 0;
+        z->fresh = false;
+    }
+    z->enabled = state;
+    LightTicker::getInstance()->unlock();
+}
+
+void DaylightHarvester::start(){
+    LightTicker::getInstance()->lock();
+    running = true;
+    LightTicker::getInstance()->attach(&ticker, period);
+    LightTicker::getInstance()->unlock();
+}
+
+void DaylightHarvester::stop(){
+    LightTicker::getInstance()->lock();
+    running = false;
+    LightTicker::getInstance()->detach(&ticker);
+    LightTicker::getInstance()->unlock();
+}
+
+bool DaylightHarvester::setInput(int32_t sensor, int32_t lux){
+    bool used = false;
+    LightTicker::getInstance()->lock();
+    for (auto z : zones){
+        if (z->sensor != sensor)
+            continue;
+        z->lux = lux > 0 ? lux : 0;
+        z->fresh = true;
+        used = true;
+    }
+    LightTicker::getInstance()->unlock();
+    return used;
+}
+
+float DaylightHarvester::getOutput(int idx) const {
+    Zone *z = zone(idx);
+    return z ? z->out : 0;
+}
+
+uint32_t DaylightHarvester::tick(int64_t now){
+    if (!running)
+        return 0;
+
+    bool moving = false;
+    for (auto z : zones){
+        if (!z->enabled || !z->outputs.size())
+            continue;
+        if (z->fresh)
+            zone_step(*z, now);
+        moving |= zone_drive(*z, now);
+    }
+    // lights are slewed on each effect tick, otherwise controller waits for readings
+    return moving ? LightTicker::getInstance()->getPeriod() : period;
+}
+
+void DaylightHarvester::zone_step(Zone &z, int64_t now){
+    z.fresh = false;
+    float dt = 0;
+    if (z.last)
+        dt = std::min<int64_t>((now - z.last) / 1000, DAYLIGHT_DT_MAX) / 1000.0f;
+    else
+        z.out = z.integral = zone_share(z);         // bumpless takeover from the level lights are at
+    z.last = now;
+
+    /*
+     * lights approaching their targets are not fully reflected by the reading yet,
+     * error is taken against the illuminance expected once they get there,
+     * so that corrections in flight are not integrated twice. Ambient part of the
+     * reading is smoothed, so that single noisy readings do not move the lights,
+     * while lights' own part is not delayed by smoothing
+     */
+    float ambient = z.lux - z.lux_full * zone_share(z);
+    z.ambient = dt ? z.ambient + (ambient - z.ambient) * DAYLIGHT_SMOOTHING : ambient;
+    float err = z.target - z.ambient - z.lux_full * z.out;
+    if (std::abs(err) * 100 <= z.target * DAYLIGHT_DEADBAND)
+        return;                                     // hold, dropping P term here would move lights back
+
+    float e = err / z.lux_full;
+    // conditional integration, no windup while output is saturated
+    if (!(z.integral >= 1 && e > 0) && !(z.integral <= 0 && e < 0))
+        z.integral = std::min(std::max(z.integral + z.ki * e * dt, 0.0f), 1.0f);
+
+    float out = std::min(std::max(z.kp * e + z.integral, 0.0f), 1.0f);
+    if (out == z.out)
+        return;
+    z.out = out;
+
+    // each light gets the output share mapped to it's own curve
+    for (auto &o : z.outputs){
+        uint32_t max = o.light->getMaxValue();
+        int32_t t = luma::curveUnMap(o.light->getCurve(), z.out * max + 0.5f, max, LIGHT_LUMA_RESOLUTION);
+        if (std::abs(t - out_pos(o)) >= DAYLIGHT_MIN_STEP)
+            o.target = t;
+    }
+    ESP_LOGD(TAG, "zone sensor %d: lux %.0f, err %.0f, out %.3f", z.sensor, z.lux, err, z.out);
+}
+
+int32_t DaylightHarvester::out_pos(Output &o){
+    // position is kept by the controller, curves are too coarse at the low end to read it back,
+    // unless light has been changed by someone else
+    if (o.pos < 0 || o.light->getValue() != o.duty)
+        o.pos = o.light->getValueScaled(LIGHT_LUMA_RESOLUTION);
+    return o.pos;
+}
+
+float DaylightHarvester::zone_share(Zone const &z) const {
+    float share = 0;
+    for (auto const &o : z.outputs)
+        share += o.light->getMaxValue() ? (float)o.light->getValue() / o.light->getMaxValue() : 0;
+    return share / z.outputs.size();
+}
+
+bool DaylightHarvester::zone_drive(Zone &z, int64_t now){
+    bool pending = false;
+    for (auto const &o : z.outputs)
+        pending |= o.target >= 0;
+    if (!pending){
+        z.driven = 0;
+        return false;
+    }
+
+    uint32_t dt = z.driven ? (now - z.driven) / 1000 : LightTicker::getInstance()->getPeriod();
+    int32_t step = z.rate * dt / 1000;
+    if (!step){
+        // too early for a step, keep ticking, time accumulates from the first tick on
+        if (!z.driven)
+            z.driven = now - (int64_t)dt * 1000;
+        return true;
+    }
+    // time for a fraction of a step is carried over to the next one
+    z.driven = now - (int64_t)(z.rate * dt % 1000) * 1000 / z.rate;
+
+    bool moving = false;
+    for (auto &o : z.outputs){
+        if (o.target < 0)
+            continue;
+
+        int32_t diff = o.target - out_pos(o);
+        if (!diff){
+            o.target = -1;
+            continue;
+        }
+
+        // constant perceptual rate, same as ramps
+        o.pos += diff > 0 ? std::min(step, diff) : -std::min(step, -diff);
+        o.light->goValueScaled(o.pos, LIGHT_LUMA_RESOLUTION, 0);
+        o.duty = o.light->getValue();
+        moving = true;
+    }
+    if (!moving)
+        z.driven = 0;
+    return moving;
+}
@@ -0,0 +1,201 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "lightevents.hpp"
+#include "light_ticker.hpp"
+#include "light_generics.hpp"
+#include "LList.h"
+
+#define DAYLIGHT_PERIOD             250             // ms, control loop period
+#define DAYLIGHT_KP                 0.3f            // proportional gain, output share per lux_full of error
+#define DAYLIGHT_KI                 0.8f            // integral gain, 1/s
+#define DAYLIGHT_RATE               128             // max output change, LIGHT_LUMA_RESOLUTION units per second
+#define DAYLIGHT_DEADBAND           2               // error ignored, % of target illuminance
+#define DAYLIGHT_MIN_STEP           4               // min output change to issue, LIGHT_LUMA_RESOLUTION units
+#define DAYLIGHT_SMOOTHING          0.5f            // readings smoothing factor, 1 - no smoothing
+#define DAYLIGHT_DT_MAX             5000            // ms, max integration interval between readings
+
+/**
+ * @brief Closed loop daylight harvesting
+ *
+ * Each zone is a set of lights and a lux sensor, a PI controller holds zone's
+ * illuminance at a target level. Controller works with a linear output share
+ * (lux scales with PWM duty), each light's target is then converted to perceptual
+ * units with the light's luma curve and approached at a constant perceptual rate,
+ * so that corrections are equally (in)visible at any level and the loop does not hunt.
+ * Lights are stepped on each effect tick while approaching their targets, the same
+ * way as ramps, so the rate does not depend on driver's fades. Error is taken against the illuminance expected
+ * once lights reach their targets, so corrections in flight are not integrated twice,
+ * integration is held when output is saturated, errors within a deadband are ignored,
+ * sensor noise does not move the lights.
+ *
+ * Controller runs on LightTicker, lux readings are taken from LSENSOR_EVENTS
+ * or set directly with setInput()
+ */
+class DaylightHarvester {
+
+    class Ticker : public TickClient {
+        DaylightHarvester *d;
+    public:
+        Ticker(DaylightHarvester *x) : d(x){};
+        uint32_t tick(int64_t now) override { return d->tick(now); };
+    };
+
+    struct Output {
+        GenericLight *light;
+        int32_t target;             // perceptual position, 0-LIGHT_LUMA_RESOLUTION, -1 - none
+        int32_t pos;                // perceptual position light was set to, -1 - unknown
+        uint32_t duty;              // light's value for the position
+    };
+
+    struct Zone {
+        int32_t sensor;
+        float target;               // lx
+        float lux_full;             // lx at sensor from zone lights at full power
+        float kp = DAYLIGHT_KP;
+        float ki = DAYLIGHT_KI;
+        uint32_t rate = DAYLIGHT_RATE;
+        bool enabled = true;
+        LList<Output> outputs;
+
+        // controller state
+        float lux = 0;              // last reading
+        float ambient = 0;          // smoothed estimate of illuminance not from zone lights
+        bool fresh = false;         // a reading is pending
+        float integral = 0;
+        float out = 0;              // linear output share, 0-1
+        int64_t last = 0;           // us, last controller step
+        int64_t driven = 0;         // us, last output step, 0 - lights are at their targets
+    };
+
+    LList<Zone*> zones;
+    Ticker ticker;
+    uint32_t period = DAYLIGHT_PERIOD;
+    bool running = false;
+    esp_event_handler_instance_t sensor_instance = nullptr;
+
+    static void event_hndlr(void* handler_args, esp_event_base_t base, int32_t id, void* event_data);
+
+    uint32_t tick(int64_t now);
+
+    /**
+     * @brief controller step on a new reading
+     * caller holds the ticker lock
+     */
+    void zone_step(Zone &z, int64_t now);
+
+    /**
+     * @brief step zone lights towards their targets
+     *
+     * @return true if any light is still approaching it's target
+     */
+    bool zone_drive(Zone &z, int64_t now);
+
+    // light's current perceptual position
+    static int32_t out_pos(Output &o);
+
+    // linear output share zone lights are at now, 0-1
+    float zone_share(Zone const &z) const;
+
+    Zone *zone(int idx) const;
+
+public:
+    DaylightHarvester();
+    ~DaylightHarvester();
+
+    // no copy
+    DaylightHarvester(DaylightHarvester const&) = delete;
+    void operator=(DaylightHarvester const&) = delete;
+
+    /**
+     * @brief add control zone
+     *
+     * @param sensor - lux sensor id
+     * @param target - target illuminance, lx
+     * @param lux_full - illuminance zone lights provide at the sensor at full power, lx
+     * @return int - zone index, -1 on error
+     */
+    int addZone(int32_t sensor, uint32_t target, uint32_t lux_full);
+
+    /**
+     * @brief add light to a zone
+     * light is driven by the controller since the next reading
+     *
+     * @return true on success
+     */
+    bool addLight(int zone, GenericLight *l);
+
+    /**
+     * @brief Set zone's target illuminance, lx
+     */
+    void setTarget(int zone, uint32_t lux);
+
+    /**
+     * @brief Set zone's PI gains
+     *
+     * @param kp - output share per lux_full of error
+     * @param ki - kp units per second
+     */
+    void setGains(int zone, float kp, float ki);
+
+    /**
+     * @brief Set zone's max output rate
+     *
+     * @param rate - LIGHT_LUMA_RESOLUTION units per second
+     */
+    void setRate(int zone, uint32_t rate);
+
+    /**
+     * @brief enable/disable zone control
+     * disabled zone keeps lights as is, controller state is reset on enable
+     */
+    void enable(int zone, bool state);
+
+    /**
+     * @brief Set controller period, ms
+     */
+    void setPeriod(uint32_t ms){ if (ms) period = ms; };
+
+    /**
+     * @brief start/stop control loop
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief set lux sensor reading
+     * reading is picked up on the next tick
+     *
+     * @return true if sensor is used by a zone
+     */
+    bool setInput(int32_t sensor, int32_t lux);
+
+    /**
+     * @brief zone's controller output, linear share 0-1
+     */
+    float getOutput(int zone) const;
+};
@@ -34,33 +34,124 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 
 #define PWM PWMCtl::getInstance()
 
-LEDCLight::LEDCLight(uint32_t channel, int pin, FadeCtrl *fader, luma::curve lcurve, float power) : DimmableLight(power, lcurve), ch(channel), gpio(pin), fc(fader){
+LEDCLight::LEDCLight(uint32_t channel, int pin, FadeCtrl *fader, luma::curve lcurve, float power, fade_engine_t engine) : DimmableLight(power, lcurve), ch(channel), gpio(pin), fc(fader){
+    if (ch == PWM_CH_AUTO){
+        int c = PWM->chAlloc(this, gpio);
+        owned = c != PWM_CH_NONE;
+        ch = owned ? c : 0;
+    } else
+        owned = !PWM->chClaim(ch, this, gpio);
+
+    if (!owned){
+        ESP_LOGE(TAG, "light for pin:%d is not bound to a channel", gpio);
+        return;
+    }
+
+    ftrack.set(PWM->chGetDuty(ch));
     if (!PWM->chStart(ch, gpio) && fc){              // attach to fader if channel init had no issues and we have a proper FadeController pointer
         fc->setFader(ch,
-            fade_engine_t::linear_hw,
+            engine,
             [this](uint32_t c, fade_event_t e){ onFadeEvent(c, e); }        // lamda passing callback to local method
         );
     }
 }
 
-void LEDCLight::fade_to_value(uint32_t value, int32_t duration){
+LEDCLight::~LEDCLight(){
+    if (!owned)
+        return;
+
+    if (fc)
+        fc->releaseFader(ch);
+    PWM->chRelease(ch, this);
+}
+
+void LEDCLight::set_to_value(uint32_t value){
+    if (!owned)
+        return;
+
+    if (isFading())
+        fade_halt();        // otherwise fade engine would override the new duty
+    PWM->chDuty(ch, value);
+    ftrack.set(value);
+    onChange();
+}
+
+void LEDCLight::fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e){
     if (duration < 0)
         duration = fadetime;
 
-    if (fc && duration)
-        fc->fadebyTime(ch, value, duration);
+    if (!fc || !duration || !owned)
+        return set_to_value(value);
+
+    if (isFading())
+        fade_halt();        // new fade starts from the level reached, engines won't take a new fade while busy
+
+    easing::Easing curve = fc->getFader(ch) == fade_engine_t::linear_hw ? easing::Easing() : e;     // hardware fades are linear only
+    uint32_t from = fade_value();
+    if (fc->fadebyTime(ch, value, duration, curve))
+        fade_track(from, value, duration, curve);
     else
         set_to_value(value);
 }
 
+void LEDCLight::fade_halt(){
+    if (!owned)
+        return;
+
+    if (fc && !fc->fadeStop(ch))
+        return;             // fade can't be stopped, keep tracking it
+
+    ftrack.set(PWM->chGetDuty(ch));
+}
+
 void LEDCLight::setPWM(uint8_t resolution, uint32_t freq){
+    if (!owned)
+        return;
+
     if (resolution >= LEDC_TIMER_BIT_MAX)
         resolution = LEDC_TIMER_BIT_MAX - 1;
 
     PWM->tmSet(PWM->chGetTimernum(ch), (ledc_timer_bit_t)resolution, freq);
+    caps_reset();
+}
+
+bool LEDCLight::setFader(fade_engine_t engine){
+    if (!owned || !fc)
+        return false;
+
+    if (fc->getFader(ch) == engine)
+        return engine != fade_engine_t::none;
+
+    bool r = fc->setFader(ch, engine);              // event callback is kept
+    ftrack.set(PWM->chGetDuty(ch));                 // fade in progress is stopped by the switch
+    caps_reset();
+    return r;
+}
+
+light_caps_t LEDCLight::mk_caps() const {
+    light_caps_t c = DimmableLight::mk_caps();
+    if (!owned)
+        return c;
+
+    c.flags |= LCAP_ACTIVE_LEVEL | LCAP_DUTY_SHIFT | LCAP_STAGED;
+    if (!fc)
+        return c;
+
+    fade_engine_t fe = fc->getFader(ch);
+    if (fe != fade_engine_t::none)
+        c.flags |= LCAP_FADE;
+    if (fe == fade_engine_t::software || fe == fade_engine_t::segmented)
+        c.flags |= LCAP_EASING;                     // hardware fades are linear only
+    c.engines = 1 << (uint8_t)fade_engine_t::linear_hw | 1 << (uint8_t)fade_engine_t::software | 1 << (uint8_t)fade_engine_t::segmented;
+    uint32_t freq = PWM->tmGetFreq(PWM->chGetTimernum(ch));
+    c.fade_step = freq && freq < 1000 ? 1000 / freq : 1;
+    return c;
 }
 
 void LEDCLight::setDutyShift(uint32_t dshift){
+    if (!owned)
+        return;
+
     if (dshift > getMaxValue())
         dshift = getMaxValue();
 
@@ -68,17 +159,24 @@ void LEDCLight::setDutyShift(uint32_t dshift){
 }
 
 void LEDCLight::setDutyShift(uint32_t duty, uint32_t dshift){
+    if (!owned)
+        return;
+
     if (dshift > getMaxValue())
         dshift = getMaxValue();
 
     PWM->chDutyPhase(ch, duty, dshift);
+    ftrack.set(duty);
 }
 
 void LEDCLight::setActiveLogicLevel(bool lvl){
+    if (!owned)
+        return;
+
     PWM->chSet(ch, gpio, !lvl, !lvl);    // invert LED logic level
 }
 
-void LEDCLight::onFadeEvent(uint32_t fch, fade_event_t e){
+void LEDCLight::onFadeEvent(uint32_t /*fch*/, fade_event_t e){
     // (fch == ch)  - all calls are for local channel only
     if (e == fade_event_t::fade_end)       // fade_start пока не нужен
         onChange();
@@ -88,6 +186,25 @@ uint32_t LEDCLight::getDutyShift() const {
     return PWM->chGetPhase(ch);
 };
 
+void LEDCLight::stageValue(uint32_t value){
+    if (!owned)
+        return;
+
+    if (isFading())
+        fade_halt();
+    PWM->chDutyStage(ch, value);
+    ftrack.set(value);
+    staged = true;
+}
+
+void LEDCLight::flush(){
+    if (!staged)
+        return;
+
+    PWM->chUpdate(ch);
+    staged = false;
+}
+
 
 /* **** GPIOLight Implementation    **** */
 
@@ -99,7 +216,7 @@ GPIOLight::GPIOLight(int pin, float power, bool lvl) : ConstantLight(power), all
     gpio_init(static_cast<gpio_num_t>(pin), lvl);
 }
 
-void GPIOLight::gpio_init(gpio_num_t pin, bool active_level){
+void GPIOLight::gpio_init(gpio_num_t pin, bool /*active_level*/){
     if (!GPIO_IS_VALID_OUTPUT_GPIO(pin)){
         ESP_LOGE(TAG, "pin:%d can't be used as OUTPUT\n", pin);
         return;
@@ -28,7 +28,7 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 #include "light_generics.hpp"
 #include "esp32ledc_fader.hpp"
 
-static const char* TAG = "light_gnrc";
+static const char* TAG __attribute__((unused)) = "light_gnrc";
 
 /**
  * @brief ESP32 LEDC engine light
@@ -40,9 +40,18 @@ class LEDCLight : public DimmableLight {
     uint32_t ch;
     int gpio;
     FadeCtrl *fc;
+    bool staged = false;                // channel has duty not applied to the output yet
+    bool owned = false;                 // channel is reserved for this light in PWMCtl registry
 
-    inline void set_to_value(uint32_t value) override { PWMCtl::getInstance()->chDuty(ch, value); onChange(); };
-    void fade_to_value(uint32_t value, int32_t duration) override;
+    void set_to_value(uint32_t value) override;
+    void fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e) override;
+
+    /**
+     * @brief stop channel's fade engine
+     * hardware fades could be stopped with IDF 5.0 or later only,
+     * with earlier versions fade runs to it's end
+     */
+    void fade_halt() override;
 
     /**
      * @brief callback function for fader events
@@ -52,14 +61,54 @@ class LEDCLight : public DimmableLight {
      */
     void onFadeEvent(uint32_t fch, fade_event_t e);
 
+    /**
+     * @brief LEDC capabilities
+     * fade step is the one of hardware driven engines, a PWM period,
+     * software engine steps on LightTicker's period
+     */
+    light_caps_t mk_caps() const override;
+
 public:
-    LEDCLight(uint32_t channel, int pin, FadeCtrl *fader = nullptr, luma::curve lcurve = luma::curve::cie1931, float power = 1.0);
-    virtual ~LEDCLight(){};     // TODO: make a proper destructor for fade engine
+    /**
+     * channel is reserved for the light in PWMCtl registry and released on destruction.
+     * If channel or pin is already used by another light, the conflict is logged and
+     * the light is left unbound, it won't touch the channel, check with isBound()
+     *
+     * @param channel - PWMCtl channel, PWM_CH_AUTO - allocate any free channel
+     * @param pin - gpio
+     * @param fader - fade controller, fades are not available if nullptr
+     * @param lcurve - luma curve
+     * @param power - light power, W
+     * @param engine - fade engine for the channel, hardware fades are linear only, software and segmented ones support easing
+     */
+    LEDCLight(uint32_t channel, int pin, FadeCtrl *fader = nullptr, luma::curve lcurve = luma::curve::cie1931, float power = 1.0, fade_engine_t engine = fade_engine_t::linear_hw);
+    virtual ~LEDCLight();
+
+    /**
+     * @brief check if light has got it's channel
+     */
+    bool isBound() const { return owned; };
+
+    /**
+     * @brief PWMCtl channel driven by the light
+     */
+    uint32_t getChannel() const { return ch; };
 
     PWMCtl *pwmGet(){ return PWMCtl::getInstance(); };
 
+    /**
+     * @brief switch fade engine for the light's channel
+     * fade in progress is stopped, see FadeCtrl::setFader(). Engine should be switched
+     * via the light rather than FadeCtrl, so that light's capabilities follow the change
+     *
+     * @param engine - fade engine type, fade_engine_t::none disables fades
+     * @return true - engine is installed
+     */
+    bool setFader(fade_engine_t engine);
+
     // *** Overrides *** //
-    uint32_t getValue()     const override { return PWMCtl::getInstance()->chGetDuty(ch); };
+    // duty is interpolated during fades, LEDC registers are not read back
+    uint32_t getValue()     const override { return fade_value(); };
     uint32_t getMaxValue()  const override { return PWMCtl::getInstance()->chGetMaxDuty(ch); };
 
     void setPWM(uint8_t resolution, uint32_t freq) override;
@@ -93,6 +142,10 @@ public:
     void setDutyShift(uint32_t duty, uint32_t dshift) override;
 
     uint32_t getDutyShift() const override;
+
+    void stageValue(uint32_t value) override;
+    void flush() override;
+
     // Own methods
 
 };
@@ -149,5 +202,8 @@ public:
      */
     virtual void setActiveLogicLevel(bool lvl) override;
 
-    luma::curve setCurve( luma::curve curve) override { return luma; };
+    luma::curve setCurve( luma::curve /*curve*/) override { return luma; };
+
+protected:
+    light_caps_t mk_caps() const override { light_caps_t c = ConstantLight::mk_caps(); c.flags |= LCAP_ACTIVE_LEVEL; return c; };
 };
\ No newline at end of file
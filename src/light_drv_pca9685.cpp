@@ -0,0 +1,100 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_drv_pca9685.hpp"
+
+PCA9685Light::PCA9685Light(PCA9685 *pca, uint8_t channel, luma::curve lcurve, float power) : DimmableLight(power, lcurve), chip(pca), ch(channel % PCA9685_CHANNELS){
+    chip->chSetCallback(ch, [this](uint8_t){ onChange(); });     // notify on fade end
+}
+
+PCA9685Light::~PCA9685Light(){
+    chip->chSetCallback(ch, nullptr);
+    chip->chDuty(ch, 0);
+    flush();
+}
+
+void PCA9685Light::set_to_value(uint32_t value){
+    chip->chDuty(ch, value);
+    ftrack.set(value);
+    flush();
+    onChange();
+}
+
+void PCA9685Light::fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e){
+    if (duration < 0)
+        duration = fadetime;
+
+    uint32_t from = getValue();
+    if (duration && chip->chFade(ch, value, duration, e))
+        fade_track(from, value, duration, e);
+    else
+        set_to_value(value);
+}
+
+void PCA9685Light::fade_halt(){
+    ftrack.set(chip->chFadeStop(ch));
+    flush();
+}
+
+light_caps_t PCA9685Light::mk_caps() const {
+    light_caps_t c = DimmableLight::mk_caps();
+    c.flags |= LCAP_ACTIVE_LEVEL | LCAP_DUTY_SHIFT | LCAP_STAGED;
+    if (chip->autocommit()){
+        c.flags |= LCAP_FADE | LCAP_EASING;
+        c.fade_step = chip->getTick();
+    }
+    return c;
+}
+
+void PCA9685Light::setPWM(uint8_t, uint32_t freq){
+    chip->setFreq(freq);
+}
+
+void PCA9685Light::setActiveLogicLevel(bool lvl){
+    chip->chInvert(ch, !lvl);
+    flush();
+}
+
+void PCA9685Light::setDutyShift(uint32_t dshift){
+    if (dshift > getMaxValue())
+        dshift = getMaxValue();
+
+    chip->chPhase(ch, dshift);
+    flush();
+}
+
+void PCA9685Light::setDutyShift(uint32_t duty, uint32_t dshift){
+    if (dshift > getMaxValue())
+        dshift = getMaxValue();
+
+    if (chip->chFading(ch) && chip->chGetFadeTarget(ch) == duty)
+        chip->chPhase(ch, dshift);
+    else {
+        chip->chDutyPhase(ch, duty, dshift);
+        ftrack.set(duty);
+    }
+    flush();
+}
@@ -0,0 +1,103 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_generics.hpp"
+#include "pca9685.hpp"
+
+/**
+ * @brief PCA9685 PWM channel light
+ * a dimmable light driven by a channel of external I2C PWM controller.
+ * Duty changes are buffered by the controller and sent to the chip in bursts,
+ * fades are done by controller's software fader
+ *
+ */
+class PCA9685Light : public DimmableLight {
+
+    PCA9685 *chip;
+    uint8_t ch;
+
+    void set_to_value(uint32_t value) override;
+    void fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e) override;
+    void fade_halt() override;
+
+    // fades step on chip's update period and are available with update task running only
+    light_caps_t mk_caps() const override;
+
+public:
+    PCA9685Light(PCA9685 *pca, uint8_t channel, luma::curve lcurve = luma::curve::cie1931, float power = 1.0);
+    virtual ~PCA9685Light();
+
+    // *** Overrides *** //
+    uint32_t getValue()     const override { return chip->chGetDuty(ch); };
+    uint32_t getMaxValue()  const override { return PCA9685_MAX_DUTY; };
+
+    /**
+     * @brief set PWM frequency
+     * PCA9685 has fixed 12 bit resolution and a single frequency for all channels,
+     * so resolution is ignored and frequency is changed for the whole chip
+     */
+    void setPWM(uint8_t resolution, uint32_t freq) override;
+
+    /**
+     * @brief Set active logic level to HIGH or LOW
+     * inverts channel's output only, not the whole chip
+     *
+     * @param lvl - logic level true/false
+     */
+    void setActiveLogicLevel(bool lvl) override;
+    bool getActiveLogicLevel() const override { return !chip->chGetInvert(ch); };
+
+    /**
+     * @brief Set the Duty Shift for PWM channel
+     * used for Phase-Shifted PWM dimming.
+     * @param dshift - Supported range for dshift is (0-MAX_DUTY)
+     */
+    void setDutyShift(uint32_t dshift) override;
+
+    /**
+     * @brief Set Duty and Duty-Shift for PWM channel
+     * if channel is fading to the same duty, only duty shift is changed
+     * and fade continues
+     * @param duty - PWM duty
+     * @param dshift - Supported range for dshift is (0-MAX_DUTY)
+     */
+    void setDutyShift(uint32_t duty, uint32_t dshift) override;
+
+    uint32_t getDutyShift() const override { return chip->chGetPhase(ch); };
+
+    /**
+     * @brief change duty in controller's shadow registers only
+     * all channels of the chip staged before flush() are sent in a single burst
+     */
+    void stageValue(uint32_t value) override { chip->chDuty(ch, value); ftrack.set(value); };
+
+    /**
+     * @brief send changes to the chip if it has no update task running
+     * otherwise changes are sent on the next tick
+     */
+    inline void flush() override { if (!chip->autocommit()) chip->commit(); };
+};
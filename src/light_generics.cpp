@@ -25,6 +25,8 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 */
 
 #include "light_generics.hpp"
+#include "light_trace.hpp"
+#include "esp_timer.h"
 #include <string.h>
 
 // LOGGING
@@ -41,43 +43,294 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 
 static const char* TAG = "light_gnrc";
 
-void GenericLight::goValue(uint32_t value, int32_t duration){
+// ********************************************************
+// FadeTrack methods
+uint32_t FadeTrack::value(int64_t now) const {
+    if (!active(now))
+        return to;
+
+    int64_t elapsed = now - start;
+    if (elapsed < 0)
+        return from;
+    return easing::lerp(from, to, curve(elapsed * EASE_SCALE / ((int64_t)duration * 1000)));
+}
 
-    if(luma != luma::curve::linear)
-        value = curveMap(luma, value, getMaxValue(), getMaxValue());        // map to luma curve if non-linear
+uint32_t FadeTrack::eta(int64_t now) const {
+    if (!active(now))
+        return 0;
+    return (start + (int64_t)duration * 1000 - now + 999) / 1000;      // round up, so that an active fade never reports 0
+}
 
-    if (duration < 0)
-        duration = fadetime;
 
+// ********************************************************
+// GenericLight methods
+GenericLight::~GenericLight(){
+    if (reporter)
+        LightTicker::getInstance()->detach(reporter.get());
+    if (ramp)
+        LightTicker::getInstance()->detach(ramp.get());
+}
+
+uint32_t GenericLight::ProgressReporter::tick(int64_t now){
+    if (!light->ftrack.active(now))
+        return 0;       // final state is reported by the driver on fade end
+
+    light->onChange();
+    return light->progress_period;
+}
+
+void GenericLight::Ramp::begin(int32_t r, int32_t s){
+    if (light->isFading())
+        light->fade_halt();
+
+    rate = r;
+    scale = s;
+    from = luma::curveUnMap(light->luma, light->getValue(), light->getMaxValue(), LIGHT_LUMA_RESOLUTION);
+    start = esp_timer_get_time();
+    light->ramping = true;
+    ESP_LOGD(TAG, "ramp from:%u, rate:%d/%d per s", from, rate, scale);
+}
+
+void GenericLight::Ramp::end(){
+    light->ramping = false;
+}
+
+uint32_t GenericLight::Ramp::position(int64_t now) const {
+    int64_t pos = from + (now - start) * rate * LIGHT_LUMA_RESOLUTION / ((int64_t)scale * 1000000);
+    return pos < 0 ? 0 : (pos > LIGHT_LUMA_RESOLUTION ? LIGHT_LUMA_RESOLUTION : pos);
+}
+
+uint32_t GenericLight::Ramp::tick(int64_t now){
+    // steps are run from the ticker, while commands touch the light from the event loop
+    LightTicker::getInstance()->lock();
+    uint32_t next = step(now);
+    LightTicker::getInstance()->unlock();
+    return next;
+}
+
+uint32_t GenericLight::Ramp::step(int64_t now){
+    if (!light->ramping)
+        return 0;
+
+    // ms since start until ramp's end position is reached
+    uint32_t distance = rate > 0 ? LIGHT_LUMA_RESOLUTION - from : from;
+    int64_t total = (int64_t)distance * scale * 1000 / ((int64_t)(rate > 0 ? rate : -rate) * LIGHT_LUMA_RESOLUTION);
+    int64_t elapsed = (now - start) / 1000;
+    if (elapsed >= total){
+        end();
+        return 0;
+    }
+
+    uint32_t seg = total - elapsed < LIGHT_RAMP_SEGMENT ? total - elapsed : LIGHT_RAMP_SEGMENT;
+    uint32_t value = luma::curveMap(light->luma, position(now + seg * 1000), light->getMaxValue(), LIGHT_LUMA_RESOLUTION);
+    if (rate < 0 && !value)
+        value = 1;          // dimming never turns the light off
+
+    light->fade_to_value(value, seg, easing::Easing());            // segments are linear, light's easing is not for ramps
+    return seg;
+}
+
+void GenericLight::fade_track(uint32_t from, uint32_t to, uint32_t duration, const easing::Easing &e){
+    ftrack.begin(from, to, duration, esp_timer_get_time(), e);
+    if (reporter && progress_period && duration > progress_period)
+        LightTicker::getInstance()->attach(reporter.get(), progress_period);
+}
+
+int32_t GenericLight::fade_duration(uint32_t to) const {
+    if (fademode == fade_mode_t::duration)
+        return fadetime;
+
+    uint32_t m = getMaxValue();
+    int32_t from = luma::curveUnMap(luma, getValue(), m, LIGHT_LUMA_RESOLUTION);
+    int32_t dist = (int32_t)luma::curveUnMap(luma, to, m, LIGHT_LUMA_RESOLUTION) - from;
+    return (int64_t)faderate * (dist < 0 ? -dist : dist) / LIGHT_LUMA_RESOLUTION;
+}
+
+uint32_t GenericLight::fade_value() const {
+    return ftrack.value(esp_timer_get_time());
+}
+
+uint32_t GenericLight::getFadeTarget() const {
+    int64_t now = esp_timer_get_time();
+    return ftrack.active(now) ? ftrack.to : getValue();
+}
+
+uint32_t GenericLight::getFadeEta() const {
+    return ftrack.eta(esp_timer_get_time());
+}
+
+void GenericLight::setProgressPeriod(uint32_t ms){
+    progress_period = ms;
+    if (!ms){
+        if (reporter)
+            LightTicker::getInstance()->detach(reporter.get());
+        return;
+    }
+
+    if (!reporter)
+        reporter.reset(new ProgressReporter(this));
+}
+
+void GenericLight::setEasing(easing::ease_t e, easing::bezier_t b){
+    if (e == easing::ease_t::use_default)
+        return;
+
+    ease = e;
+    bezier = b;
+}
+
+void GenericLight::goValue(uint32_t value, int32_t duration, const easing::Easing *e){
+    LTRACE_SCOPE("GenericLight::goValue");
+
+    value = mapValue(value);
     ESP_LOGD(TAG, "goValue val:%d, duration:%d", value, duration);
-    fade_to_value(value, duration);
+    goMapped(value, duration, e);
 };
 
-void GenericLight::goValueScaled(uint32_t value, int32_t scale, int32_t duration){
+void GenericLight::goValueScaled(uint32_t value, int32_t scale, int32_t duration, const easing::Easing *e){
     if (scale <= 0)
         scale = brtscale;
 
-    if (value >= scale)
-        return goMax(duration);
+    if (value >= (uint32_t)scale)
+        return goMax(duration, e);
 
     if (value == 0)
-        return goOff(duration);
+        return goOff(duration, e);
 
+    value = mapValueScaled(value, scale);
     ESP_LOGD(TAG, "val:%d, scale:%d, duration:%d\n", value, scale, duration);
 
-    return fade_to_value( curveMap(luma, value, getMaxValue(), scale), duration );
+    return goMapped(value, duration, e);
 }
 
-void GenericLight::goStepScaled(int32_t step, int32_t scale, int32_t duration){
+void GenericLight::goMapped(uint32_t value, int32_t duration, const easing::Easing *e){
+    LTRACE_SCOPE("GenericLight::goMapped");
+
+    if (duration < 0)
+        duration = fade_duration(value);
+
+    value_reset();
+    fade_to_value(value, duration, e ? *e : fade_easing());
+}
+
+uint32_t GenericLight::mapValue(uint32_t value) const {
+    if(luma != luma::curve::linear)
+        value = curveMap(luma, value, getMaxValue(), getMaxValue());        // map to luma curve if non-linear
+    return value;
+}
+
+uint32_t GenericLight::mapValueScaled(uint32_t value, int32_t scale) const {
+    if (scale <= 0)
+        scale = brtscale;
+
+    // same as goMax()/goOff()
+    if (value >= (uint32_t)scale)
+        return mapValue(getMaxValue());
+    if (value == 0)
+        return mapValue(0);
+
+    return curveMap(luma, value, getMaxValue(), scale);
+}
+
+void GenericLight::goValueCCT(uint32_t value, int32_t scale, uint16_t k, int32_t duration){
+    if (getCaps().flags & LCAP_CCT)
+        cct_preset(k);
+    goValueScaled(value, scale, duration);
+}
+
+void GenericLight::goStepScaled(int32_t step, int32_t scale, int32_t duration, const easing::Easing *e){
     if (!step)
         return;
 
     uint32_t cur = getValueScaled(scale);
     if (cur + step <= 0)     // do not go to negative
-        return goOff();
+        return goOff(USE_DEFAULT, e);
 
     ESP_LOGD(TAG, "step:%d, scale: %d, current value:%d, new value:%d duration:%d\n", step, scale, cur, step + cur, duration);
-    return goValueScaled(step + cur, scale, duration);
+    return goValueScaled(step + cur, scale, duration, e);
+}
+
+void GenericLight::fadeStop(){
+    value_reset();
+    if (!isFading())
+        return;
+
+    fade_halt();
+    onChange();
+}
+
+void GenericLight::fadePause(){
+    ramp_cancel();          // a ramp has no target to resume to
+    uint32_t left = getFadeEta();
+    if (!left)
+        return;
+
+    pause_to = getFadeTarget();
+    fade_halt();
+    pause_left = left;
+    ESP_LOGD(TAG, "fade paused, to:%u, left:%u ms", pause_to, pause_left);
+    onChange();
+}
+
+void GenericLight::fadeResume(){
+    if (!pause_left)
+        return;
+
+    uint32_t left = pause_left;
+    pause_left = 0;
+    fade_to_value(pause_to, left, fade_easing());
+}
+
+void GenericLight::goRetarget(uint32_t value, const easing::Easing *e){
+    int32_t left = pause_left ? pause_left : getFadeEta();
+    if (left)
+        fade_halt();        // new fade starts from the level reached
+    goValue(value, left ? left : USE_DEFAULT, e);
+}
+
+void GenericLight::ramp_cancel(){
+    // a step in progress is finished once the lock is taken
+    LightTicker::getInstance()->lock();
+    if (ramping){
+        ramp->end();
+        LightTicker::getInstance()->detach(ramp.get());
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+void GenericLight::rampStart(bool up, int32_t rate, int32_t scale){
+    if (rate <= 0)
+        rate = ramprate;
+    if (scale <= 0)
+        scale = brtscale;
+
+    LightTicker::getInstance()->lock();
+    value_reset();
+    if (!ramp)
+        ramp.reset(new Ramp(this));
+
+    ramp->begin(up ? rate : -rate, scale);
+    // first segment is started right away, ticker takes the rest
+    uint32_t next = ramp->tick(esp_timer_get_time());
+    if (next)
+        LightTicker::getInstance()->attach(ramp.get(), next);
+    LightTicker::getInstance()->unlock();
+
+    if (!next)
+        onChange();         // already at the end, nothing to ramp
+}
+
+void GenericLight::rampStop(){
+    LightTicker::getInstance()->lock();
+    bool r = ramping;
+    if (r){
+        ramp_cancel();
+        fade_halt();
+    }
+    LightTicker::getInstance()->unlock();
+
+    if (r)
+        onChange();
 }
 
 float GenericLight::setMaxPower(float p){
@@ -93,11 +346,11 @@ float GenericLight::getCurrentPower() const {
     return getMaxPower() * getValue() / getMaxValue();
 }
 
-void GenericLight::goToggle(int32_t duration){
+void GenericLight::goToggle(int32_t duration, const easing::Easing *e){
     if (getValue())
-        goOff(duration);
+        goOff(duration, e);
     else
-        goOn(duration);
+        goOn(duration, e);
 }
 
 uint32_t GenericLight::getValueScaled(int32_t scale) const {
@@ -106,6 +359,26 @@ uint32_t GenericLight::getValueScaled(int32_t scale) const {
     return luma::curveUnMap(luma, getValue(), getMaxValue(), scale);
 }
 
+light_caps_t GenericLight::mk_caps() const {
+    uint32_t max = getMaxValue();
+    light_caps_t c = {
+        LCAP_CURVES | (max > 1 ? LCAP_DIMMABLE : 0),
+        max,
+        static_cast<uint8_t>(max ? 32 - __builtin_clz(max) : 0),
+        0,
+        0
+    };
+    return c;
+}
+
+light_caps_t const &GenericLight::getCaps() const {
+    if (!caps_valid){
+        caps = mk_caps();
+        caps_valid = true;
+    }
+    return caps;
+}
+
 light_state_t GenericLight::getState() const{
     light_state_t state = {
         ltype,      //    lightsource_t ltype;
@@ -118,7 +391,12 @@ light_state_t GenericLight::getState() const{
         getValueScaled(),       //    uint32_t value_scaled;
         getCurrentPower(),      //    float power;
         power,                  //    float power_max;
-        getActiveLogicLevel()   //    bool active_ll;             // active logic level
+        getActiveLogicLevel(),  //    bool active_ll;             // active logic level
+        getFadeTarget(),        //    uint32_t fade_to;
+        getFadeEta(),           //    uint32_t fade_eta;
+        fademode,               //    fade_mode_t fade_mode;
+        faderate,               //    int32_t fade_rate;
+        getCaps()               //    light_caps_t caps;
     };
     return state;
 }
@@ -154,6 +432,8 @@ bool CompositeLight::addLight(GenericLight *gl, uint8_t id){
     if (!ls.add(node))
         return false;
 
+    caps_reset();
+
     switch(ps){
         case power_share_t::equal :
         case power_share_t::phaseshift : {
@@ -224,6 +504,95 @@ float CompositeLight::getCurrentPower() const {
     }
 }
 
+uint32_t CompositeLight::getFadeTarget() const {
+    switch(ps){
+        case power_share_t::equal :
+        case power_share_t::phaseshift :{
+            if (ls.size())
+                return ls.head()->light->getFadeTarget();
+            return 0;
+        }
+        default : {
+            uint32_t val = 0;
+            for (auto _i = ls.cbegin(); _i != ls.cend(); ++_i){
+                val += _i->get()->light->getFadeTarget();
+            }
+            return val;
+        }
+    }
+}
+
+uint32_t CompositeLight::getFadeEta() const {
+    uint32_t eta = 0;
+    for (auto _i = ls.cbegin(); _i != ls.cend(); ++_i){
+        uint32_t e = _i->get()->light->getFadeEta();
+        if (e > eta)
+            eta = e;
+    }
+    return eta;
+}
+
+void CompositeLight::fade_halt(){
+    for (auto _i = ls.begin(); _i != ls.end(); ++_i){
+        _i->get()->light->fade_halt();
+    }
+}
+
+void CompositeLight::setEasing(easing::ease_t e, easing::bezier_t b){
+    GenericLight::setEasing(e, b);
+    for (auto _i = ls.begin(); _i != ls.end(); ++_i){
+        _i->get()->light->setEasing(e, b);
+    }
+}
+
+void CompositeLight::setCCT(uint16_t k, int32_t duration){
+    // default duration is resolved once here, so that all children end their fades together
+    if (duration < 0)
+        duration = fadetime;
+    for (auto _i = ls.begin(); _i != ls.end(); ++_i){
+        GenericLight *l = _i->get()->light.get();
+        if (l->getCaps().flags & LCAP_CCT)
+            l->setCCT(k, duration);
+    }
+}
+
+void CompositeLight::cct_preset(uint16_t k){
+    for (auto _i = ls.begin(); _i != ls.end(); ++_i){
+        GenericLight *l = _i->get()->light.get();
+        if (l->getCaps().flags & LCAP_CCT)
+            l->cct_preset(k);
+    }
+}
+
+uint16_t CompositeLight::getCCT() const {
+    for (auto _i = ls.cbegin(); _i != ls.cend(); ++_i){
+        if (uint16_t k = _i->get()->light->getCCT())
+            return k;
+    }
+    return 0;
+}
+
+light_caps_t CompositeLight::mk_caps() const {
+    light_caps_t c = GenericLight::mk_caps();
+    if (!ls.size())
+        return c;
+
+    // fades and CCT are supported if all light sources support those
+    uint32_t common = LCAP_FADE | LCAP_EASING | LCAP_CCT;
+    uint16_t step = 0;
+    for (auto _i = ls.cbegin(); _i != ls.cend(); ++_i){
+        light_caps_t const &lc = _i->get()->light->getCaps();
+        common &= lc.flags;
+        if (lc.fade_step > step)
+            step = lc.fade_step;
+    }
+
+    c.flags |= common;
+    if (common & LCAP_FADE)
+        c.fade_step = step;
+    return c;
+}
+
 luma::curve CompositeLight::setCurve( luma::curve curve){
     // curve cant't be changed for constant lights
     if (sub_type == lightsource_t::constant)
@@ -237,48 +606,48 @@ luma::curve CompositeLight::setCurve( luma::curve curve){
 }
 
 
-void CompositeLight::goValueIncremental(uint32_t value, int32_t duration){
+void CompositeLight::goValueIncremental(uint32_t value, int32_t duration, const easing::Easing &e){
     for (auto _i = ls.begin(); _i != ls.end(); ++_i){
         uint32_t m = _i->get()->light->getMaxValue();
 
         if (value >= m){    // кратное увеличение яркости
-            _i->get()->light->fade_to_value(m, duration);
+            _i->get()->light->fade_to_value(m, duration, e);
             ESP_LOGD(TAG, "Composite incremental: set val:%d/%d", m, value);
             value -= m;
             continue;
         }
 
-        _i->get()->light->fade_to_value(value, duration);   // выставляем остаток
+        _i->get()->light->fade_to_value(value, duration, e);   // выставляем остаток
         value = 0;                                          // остальные источники гасим
         ESP_LOGD(TAG, "Composite incremental: set val:%d", value);
     }
 }
 
-void CompositeLight::goValueEqual(uint32_t value, int32_t duration){
+void CompositeLight::goValueEqual(uint32_t value, int32_t duration, const easing::Easing &e){
     for (auto _i = ls.begin(); _i != ls.end(); ++_i){
-        _i->get()->light->fade_to_value(value, duration);
+        _i->get()->light->fade_to_value(value, duration, e);
     }
 }
 
-void CompositeLight::goValueComposite(uint32_t value, int32_t duration){
+void CompositeLight::goValueComposite(uint32_t value, int32_t duration, const easing::Easing &e){
     if (!ls.size())
         return;         // skip if container is empty
 
     switch(ps){
         case power_share_t::equal :
-            return goValueEqual(value, duration);
+            return goValueEqual(value, duration, e);
         case power_share_t::phaseshift :
-            return goValuePhaseShift(value, duration);
+            return goValuePhaseShift(value, duration, e);
         default :
-            return goValueIncremental(value, duration);
+            return goValueIncremental(value, duration, e);
     }
 }
 
 
-void CompositeLight::goValuePhaseShift(uint32_t value, int32_t duration){
+void CompositeLight::goValuePhaseShift(uint32_t value, int32_t duration, const easing::Easing &e){
     // check if we hold dimmable lights, otherwise use 'equal' control
     if (ls.head()->light->getLType() != lightsource_t::dimmable)
-        return goValueEqual(value, duration);
+        return goValueEqual(value, duration, e);
 
     // calculate per-source duty offset for phase-shifted PWM
     uint32_t flags = 0;
@@ -292,9 +661,9 @@ void CompositeLight::goValuePhaseShift(uint32_t value, int32_t duration){
 
             if ( l->getDutyShift() + value > l->getMaxValue() ){   // new duty value can't be reached, need phase down-shifting first
                 l->setDutyShift(duty_shift);
-                l->fade_to_value(value, duration);
+                l->fade_to_value(value, duration, e);
             } else {    // if ( l->getValue() + duty_shift > l->getMaxValue() ) // new duty_shift can't be set with current duty
-                l->fade_to_value(value, duration);
+                l->fade_to_value(value, duration, e);
                 BIT_SET(flags, channel);
                 // l->setDutyShift(value, duty_shift);              // for LEDC driver chennel is blocked until fade is over
                                                                     // need to WA this in some ugly manner, so I postpone DutyShift operation
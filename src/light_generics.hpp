@@ -26,6 +26,8 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 
 #pragma once
 #include "light_types.hpp"
+#include "light_ticker.hpp"
+#include "easing.hpp"
 #include <memory>
 #include <functional>
 #include "LList.h"
@@ -34,30 +36,174 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 #define DEFAULT_SCALE               100             // fits percent control 0%-100%
 #define DEFAULT_SCALE_STEP          10              // 10% step
 #define USE_DEFAULT                 -1              // Use light object's own setting
+#define DEFAULT_FADE_RATE           2000            // ms, full range fade time for fade_mode_t::rate
+#define DEFAULT_RAMP_RATE           25              // scale units per second, full range in 4 s
+#define LIGHT_RAMP_SEGMENT          100             // ms, ramp is run by fade engine in linear segments of this length
+#define LIGHT_LUMA_RESOLUTION       1024            // perceptual position steps for full scale, ramps and fade rates
 
 
 typedef std::function<void ()> callback_t;
 //typedef std::function<void (event_t event, const event_args*)> callback_t;
 
 
+/**
+ * @brief fade progress tracker
+ * keeps end points and timing of a fade, so that current value could be
+ * interpolated at any moment without reading it back from the hardware
+ */
+struct FadeTrack {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    int64_t start = 0;                              // us
+    uint32_t duration = 0;                          // ms, 0 - not fading
+    easing::Easing curve;                           // easing applied by the fade engine
+
+    void begin(uint32_t value_from, uint32_t value_to, uint32_t duration_ms, int64_t now, const easing::Easing &e){ from = value_from; to = value_to; duration = duration_ms; start = now; curve = e; };
+    void set(uint32_t value){ from = to = value; duration = 0; };
+    bool active(int64_t now) const { return duration && now - start < (int64_t)duration * 1000; };
+
+    /**
+     * @brief interpolated value at time 'now'
+     */
+    uint32_t value(int64_t now) const;
+
+    /**
+     * @brief time left until fade end at time 'now', ms
+     */
+    uint32_t eta(int64_t now) const;
+};
+
+
 class GenericLight {
 friend class CompositeLight;
+friend class RGBLight;
+friend class CCTLight;
+friend class EcloGroup;
+
+    // calls onChange() periodically while light is fading
+    class ProgressReporter : public TickClient {
+        GenericLight *light;
+    public:
+        ProgressReporter(GenericLight *l) : light(l){};
+        uint32_t tick(int64_t now) override;
+    };
+
+    std::unique_ptr<ProgressReporter> reporter;
+
+    /*
+        continuous brightness ramp
+        ramp position moves along the light's luma curve at a constant rate, so the
+        change is perceptually even. Position is mapped to the light's value once per
+        segment and fade engine does linear fade to it, so the curve is followed
+        piecewise with no events in between
+    */
+    class Ramp : public TickClient {
+        GenericLight *light;
+        int64_t start = 0;                          // us
+        uint32_t from = 0;                          // ramp position at start, 0-LIGHT_LUMA_RESOLUTION
+        int32_t rate = 0;                           // scale units per second, negative for ramping down
+        int32_t scale = DEFAULT_SCALE;
+
+        // ramp position at time 'now'
+        uint32_t position(int64_t now) const;
+
+        // start next linear segment, returns it's length, ms, 0 - ramp is over
+        uint32_t step(int64_t now);
+
+    public:
+        Ramp(GenericLight *l) : light(l){};
+        void begin(int32_t rate, int32_t scale);
+        void end();
+        uint32_t tick(int64_t now) override;
+    };
+
+    std::unique_ptr<Ramp> ramp;
+    bool ramping = false;
+    int32_t ramprate = DEFAULT_RAMP_RATE;           // default ramp rate, scale units per second
+
+    // stop ramp, if any, light is not halted
+    void ramp_cancel();
+
+    uint32_t pause_to = 0;                          // target of a paused fade
+    uint32_t pause_left = 0;                        // ms left for a paused fade, 0 - not paused
+
+    mutable light_caps_t caps;                      // capabilities, computed on first request
+    mutable bool caps_valid = false;
 
 protected:
     lightsource_t const ltype;
     float power;
     luma::curve luma;
     int32_t fadetime = DEFAULT_FADE_TIME;           // default fade time duration
+    fade_mode_t fademode = fade_mode_t::duration;   // how default fade time for brightness changes is calculated
+    int32_t faderate = DEFAULT_FADE_RATE;           // ms for a full range fade, fade_mode_t::rate
     int32_t brtscale = DEFAULT_SCALE;               // default scale for brightness
     int32_t increment = DEFAULT_SCALE_STEP;         // default increment step
+    bool silent = false;                            // onChange() notifications are suppressed
 
     callback_t callback = nullptr;                  // external callback function to call on state change
 
+    FadeTrack ftrack;                               // progress of a fade in progress, if any
+    uint32_t progress_period = 0;                   // ms, fade progress reports period, 0 - reports disabled
+    easing::ease_t ease = easing::ease_t::linear;   // default easing for fades
+    easing::bezier_t bezier = {0, 0, 255, 255};     // curve for easing::ease_t::bezier
+
+    /**
+     * @brief start tracking a fade
+     * should be called by drivers on each fade start, value changes
+     * without a fade should be tracked with ftrack.set()
+     *
+     * @param from - value fade starts with
+     * @param to - target value
+     * @param duration - fade duration, ms
+     * @param e - easing the fade is actually run with, engines not supporting easing are linear
+     */
+    void fade_track(uint32_t from, uint32_t to, uint32_t duration, const easing::Easing &e = easing::Easing());
+
+    /**
+     * @brief default duration for a brightness fade from current level to 'to'
+     * for fade_mode_t::rate duration is proportional to perceptual distance
+     * along the light's luma curve, composites resolve it once for all children
+     *
+     * @param to - target value
+     * @return int32_t - duration, ms
+     */
+    int32_t fade_duration(uint32_t to) const;
+
+    /**
+     * @brief easing function for a fade, as set with setEasing()
+     */
+    easing::Easing fade_easing() const { return easing::Easing(ease, bezier); };
+
+    /**
+     * @brief current value interpolated by tracked fade progress
+     */
+    uint32_t fade_value() const;
+
+    /**
+     * @brief drop paused fade and running ramp, if any
+     * a new brightness value overrides both, light is not halted
+     */
+    void value_reset(){ pause_left = 0; ramp_cancel(); };
+
+    /**
+     * @brief describe light's capabilities
+     * drivers extend their parent's descriptor. Called once, result is cached
+     * until caps_reset(), so it should not touch hardware
+     */
+    virtual light_caps_t mk_caps() const;
+
+    /**
+     * @brief drop cached capabilities
+     * should be called by drivers on configuration changes affecting capabilities
+     */
+    void caps_reset(){ caps_valid = false; };
+
     /**
      * @brief run external callback function
      * every time objects state changes a callback triggered to notify
      */
-    virtual void onChange(){ if (callback) callback(); };
+    virtual void onChange(){ if (callback && !silent) callback(); };
 
     /**
      * @brief set normalized power/brightness level
@@ -71,32 +217,125 @@ protected:
      * if fade is not implemented than a direct set_to_value() called
      * @param value - normalized value
      * @param duration - fade duration in ms
+     * @param e - easing for the fade, drivers that can't ease fade linearly
+     */
+    virtual void fade_to_value(uint32_t value, int32_t /*duration*/, const easing::Easing &/*e*/){ return set_to_value(value); };    // should be overriden with drivers supporting fade
+
+    /**
+     * @brief stop fade in progress, light holds current level
+     * should be overriden with drivers supporting fade, must leave ftrack
+     * set to the level reached, no state change is reported
      */
-    virtual void fade_to_value(uint32_t value, int32_t duration){ return set_to_value(value); };    // should be overriden with drivers supporting fade
+    virtual void fade_halt(){ ftrack.set(fade_value()); };
+
+    /**
+     * @brief set color temperature target without applying it
+     * the next brightness change fades to the new mix, see goValueCCT().
+     * Overriden by lights with LCAP_CCT capability
+     */
+    virtual void cct_preset(uint16_t /*k*/){};
 
 public:
     GenericLight(lightsource_t type = lightsource_t::generic, float pwr = 1.0, luma::curve lcurve = luma::curve::linear) : ltype(type), power(pwr), luma(lcurve){};
-    virtual ~GenericLight(){};
+    virtual ~GenericLight();
 
     // Brightness functions
-    virtual void goValue(uint32_t value, int32_t duration = USE_DEFAULT);
+    // optional easing 'e' is used for this fade only, nullptr - light's own easing set with setEasing()
+    virtual void goValue(uint32_t value, int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr);
 
-    inline virtual void goMax(int32_t duration = USE_DEFAULT){ return goValue( getMaxValue(), duration); };
-    inline virtual void goMin(int32_t duration = USE_DEFAULT){ return goValue(1, duration); };
-    inline virtual void goOn(int32_t duration = USE_DEFAULT){  return goMax(duration); };
-    inline virtual void goOff(int32_t duration = USE_DEFAULT){ return goValue(0, duration); };
-    virtual void goToggle(int32_t duration = USE_DEFAULT);
-    virtual void   goIncr(int32_t duration = USE_DEFAULT){ return goStepScaled(increment, brtscale, duration); };
-    virtual void   goDecr(int32_t duration = USE_DEFAULT){ return goStepScaled(-1*increment, brtscale, duration); };
+    inline virtual void goMax(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goValue( getMaxValue(), duration, e); };
+    inline virtual void goMin(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goValue(1, duration, e); };
+    inline virtual void goOn(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){  return goMax(duration, e); };
+    inline virtual void goOff(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goValue(0, duration, e); };
+    virtual void goToggle(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr);
+    virtual void   goIncr(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goStepScaled(increment, brtscale, duration, e); };
+    virtual void   goDecr(int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goStepScaled(-1*increment, brtscale, duration, e); };
 
-    virtual void goStep(int32_t step, int32_t duration = USE_DEFAULT){ return goValue( getValue() + step, duration); };
+    virtual void goStep(int32_t step, int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr){ return goValue( getValue() + step, duration, e); };
 
-    virtual void  goStepScaled(int32_t step, int32_t scale=USE_DEFAULT, int32_t duration = USE_DEFAULT);
+    virtual void  goStepScaled(int32_t step, int32_t scale=USE_DEFAULT, int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr);
 
-    virtual void goValueScaled(uint32_t value, int32_t scale=USE_DEFAULT, int32_t duration = USE_DEFAULT);
+    virtual void goValueScaled(uint32_t value, int32_t scale=USE_DEFAULT, int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr);
+
+    /**
+     * @brief go to a value that is already mapped to the luma curve
+     * with mapValue() or mapValueScaled(), common tail of goValue() and goValueScaled().
+     * Lets a controller map a value once for many lights with the same curve
+     *
+     * @param value - mapped value
+     * @param duration - fade duration in ms, negative for default duration
+     * @param e - easing for this fade, nullptr - light's own one
+     */
+    void goMapped(uint32_t value, int32_t duration = USE_DEFAULT, const easing::Easing *e = nullptr);
+
+    /**
+     * @brief value goValue() would send to the driver, mapped to the luma curve
+     */
+    uint32_t mapValue(uint32_t value) const;
+
+    /**
+     * @brief value goValueScaled() would send to the driver, mapped to the luma curve
+     * values at or above scale map to max, 0 is off
+     *
+     * @param scale - brightness scale, <=0 for light's own one
+     */
+    uint32_t mapValueScaled(uint32_t value, int32_t scale = USE_DEFAULT) const;
 
     inline virtual void pwr(bool state, int32_t duration = USE_DEFAULT){ state ? goOn(duration) : goOff(duration); };
 
+    // Fade control
+
+    /**
+     * @brief stop fade in progress, light holds the level reached
+     * paused fade is discarded
+     */
+    virtual void fadeStop();
+
+    /**
+     * @brief pause fade in progress
+     * light holds the level reached, fade target and time left are kept
+     * until fadeResume(). Any new value change discards paused fade
+     */
+    virtual void fadePause();
+
+    /**
+     * @brief resume paused fade
+     * fade continues from current level to the same target in the time that was left
+     */
+    virtual void fadeResume();
+
+    /**
+     * @brief change target of a fade in progress
+     * light fades from it's current level to the new value in the time left
+     * for the fade in progress (or paused one). If light is not fading,
+     * it's the same as goValue() with default duration
+     *
+     * @param value - new target value
+     * @param e - easing for the new fade, nullptr - light's own one
+     */
+    virtual void goRetarget(uint32_t value, const easing::Easing *e = nullptr);
+
+    bool isPaused() const { return pause_left; };
+
+    /**
+     * @brief start continuous brightness ramp, i.e. for hold-to-dim wall switches
+     * light changes brightness at a constant perceptual rate until rampStop()
+     * or any other value change. Ramp up stops at max value, ramp down stops
+     * at the lowest non-zero value, so a light is never turned off by dimming
+     *
+     * @param up - ramp direction, true - brighter
+     * @param rate - ramp speed, scale units per second
+     * @param scale - brightness scale for the rate
+     */
+    virtual void rampStart(bool up, int32_t rate = USE_DEFAULT, int32_t scale = USE_DEFAULT);
+
+    /**
+     * @brief stop the ramp, light holds the level reached
+     */
+    virtual void rampStop();
+
+    bool isRamping() const { return ramping; };
+
 
     // set methods
     inline virtual luma::curve setCurve( luma::curve curve) { luma = curve; return luma; };
@@ -116,6 +355,18 @@ public:
      */
     virtual void setFadeTime(int32_t t){ if(t>=0) fadetime = t; };
 
+    /**
+     * @brief Set how default fade time is calculated for brightness changes
+     * fade_mode_t::duration - each fade takes setFadeTime() ms
+     * fade_mode_t::rate - fades have constant perceptual speed, a full range
+     * fade takes 'rate' ms and a small step is quick. Color/CCT changes
+     * at the same brightness still use fade time
+     *
+     * @param m - fade mode
+     * @param rate - ms for a full range fade, USE_DEFAULT keeps current one
+     */
+    virtual void setFadeMode(fade_mode_t m, int32_t rate = USE_DEFAULT){ fademode = m; if (rate > 0) faderate = rate; };
+
     /**
      * @brief Set default Brightness Scale for the object
      * scale can't be less than '1'
@@ -131,6 +382,13 @@ public:
      */
     virtual void setScaleStep(int32_t step){ if(step > 0 && step < brtscale) increment = step; }
 
+    /**
+     * @brief Set default ramp rate for rampStart()
+     *
+     * @param rate - scale units per second
+     */
+    virtual void setRampRate(int32_t rate){ if (rate > 0) ramprate = rate; };
+
     /**
      * @brief Set active logic level to HIGH or LOW
      * i.e. could be required to inverse on/off logic or PWM active level
@@ -138,7 +396,29 @@ public:
      * 
      * @param lvl - logic level true/false
      */
-    virtual void setActiveLogicLevel(bool lvl){};
+    virtual void setActiveLogicLevel(bool /*lvl*/){};
+
+    /**
+     * @brief Set color temperature, brightness is not changed
+     * supported by lights with LCAP_CCT capability, others ignore it
+     *
+     * @param k - color temperature, K
+     * @param duration - fade duration
+     */
+    virtual void setCCT(uint16_t /*k*/, int32_t /*duration*/ = USE_DEFAULT){};
+
+    /**
+     * @brief fade to brightness and color temperature at once
+     * a single fade is run toward the new level and mix, unlike goValueScaled() followed
+     * by setCCT(), where the second call restarts the fade just started.
+     * Lights without LCAP_CCT capability change brightness only
+     *
+     * @param value - brightness, scale units
+     * @param scale - brightness scale, <=0 for light's own one
+     * @param k - color temperature, K
+     * @param duration - fade duration
+     */
+    void goValueCCT(uint32_t value, int32_t scale, uint16_t k, int32_t duration = USE_DEFAULT);
 
 
     // get methods
@@ -151,8 +431,20 @@ public:
      */
     virtual bool getActiveLogicLevel() const { return true; };
 
+    /**
+     * @brief Get color temperature, K
+     * 0 for lights without LCAP_CCT capability
+     */
+    virtual uint16_t getCCT() const { return 0; };
+
     virtual lightsource_t getLType() const { return ltype; }
 
+    /**
+     * @brief Get light capabilities descriptor
+     * controllers could check it to choose command forms and skip unsupported settings
+     */
+    light_caps_t const &getCaps() const;
+
     virtual uint32_t getValue() const = 0;                      // pure virtual
     virtual uint32_t getMaxValue() const = 0;                   // pure virtual
     virtual uint32_t getValueScaled(int32_t scale=USE_DEFAULT) const;
@@ -170,8 +462,52 @@ public:
     virtual light_state_t getState() const;
 
     virtual int32_t getFadeTime() const { return fadetime; }
+    virtual fade_mode_t getFadeMode() const { return fademode; }
+    virtual int32_t getFadeRate() const { return faderate; }
     virtual int32_t getScale() const { return brtscale; }
     virtual int32_t getScaleStep() const { return increment; }
+    virtual int32_t getRampRate() const { return ramprate; }
+
+    /**
+     * @brief check if light has a fade in progress
+     */
+    bool isFading() const { return getFadeEta(); };
+
+    /**
+     * @brief Get target value of a fade in progress
+     *
+     * @return uint32_t - fade target, or current value if not fading
+     */
+    virtual uint32_t getFadeTarget() const;
+
+    /**
+     * @brief Get time left until fade end
+     *
+     * @return uint32_t - ms, 0 if not fading
+     */
+    virtual uint32_t getFadeEta() const;
+
+    /**
+     * @brief Set fade progress reports period
+     * while fading, state change callback is triggered each 'ms' milliseconds,
+     * so that subscribers could follow intermediate values.
+     * Reports are run from LightTicker's task
+     *
+     * @param ms - reports period, 0 disables reports (default)
+     */
+    void setProgressPeriod(uint32_t ms);
+
+    /**
+     * @brief Set easing function for fades
+     * applies to software and segmented fade engines, hardware fades are always linear
+     *
+     * @param e - easing function, easing::ease_t::use_default is ignored
+     * @param b - control points for easing::ease_t::bezier
+     */
+    virtual void setEasing(easing::ease_t e, easing::bezier_t b = {0, 0, 255, 255});
+
+    easing::ease_t getEasing() const { return ease; };
+    easing::bezier_t getBezier() const { return bezier; };
 
     // CallBacks
     /**
@@ -198,9 +534,12 @@ public:
 class ConstantLight : public GenericLight {
 public:
     ConstantLight(float power = 1.0) : GenericLight(lightsource_t::constant, power, luma::curve::binary){};
-    luma::curve setCurve( luma::curve curve) { return luma; };
+    luma::curve setCurve( luma::curve /*curve*/) { return luma; };
     uint32_t getMaxValue() const override { return 1; }
     float getCurrentPower() const override { return getMaxPower(); };
+
+protected:
+    light_caps_t mk_caps() const override { light_caps_t c = GenericLight::mk_caps(); c.flags &= ~(LCAP_CURVES | LCAP_DIMMABLE); return c; };
 };
 
 
@@ -218,7 +557,7 @@ public:
      * 
      * @param dshift duty shift value (0 - MAX_DUTY_VALUE) 
      */
-    virtual void setDutyShift(uint32_t dshift){};
+    virtual void setDutyShift(uint32_t /*dshift*/){};
 
     /**
      * @brief Set Duty and Duty Shift value for the light source if supported by backend driver
@@ -226,11 +565,27 @@ public:
      * @param duty - PWM duty value
      * @param dshift duty shift value (0 - MAX_DUTY_VALUE) 
      */
-    virtual void setDutyShift(uint32_t duty, uint32_t dshift){};
+    virtual void setDutyShift(uint32_t /*duty*/, uint32_t /*dshift*/){};
 
     // virtual int getPhaseShift(){ return 0; };    // no use case
 
     virtual uint32_t getDutyShift() const { return 0; };
+
+    /**
+     * @brief set PWM duty without applying it to the output
+     * staged values of several lights could be applied with flush() calls
+     * one right after another, so that multichannel lights change without tearing.
+     * Backend drivers that do not support this apply the value immediately.
+     * No state change callback is triggered for either, it's up to the caller
+     *
+     * @param value - PWM duty
+     */
+    virtual void stageValue(uint32_t value){ silent = true; set_to_value(value); silent = false; };
+
+    /**
+     * @brief apply staged PWM duty to the output
+     */
+    virtual void flush(){};
 };
 
 
@@ -273,7 +628,7 @@ class CompositeLight : public GenericLight {
      * 
      * @param value 
      */
-    void goValueIncremental(uint32_t value, int32_t duration);
+    void goValueIncremental(uint32_t value, int32_t duration, const easing::Easing &e);
 
     /**
      * @brief Set the to value for equal-type lights
@@ -283,15 +638,16 @@ class CompositeLight : public GenericLight {
      * @param value - brightness value in range 0-MAX_BRIGHTNESS of a first light
      * @param duration - fade duration (if supported by backend driver)
      */
-    void goValueEqual(uint32_t value, int32_t duration);
+    void goValueEqual(uint32_t value, int32_t duration, const easing::Easing &e);
 
     /**
      * @brief a selector for specific methods depending on power_share type
      * 
      * @param value
      * @param duration
+     * @param e - easing passed to children's fades
      */
-    void goValueComposite(uint32_t value, int32_t duration);
+    void goValueComposite(uint32_t value, int32_t duration, const easing::Easing &e);
 
     /**
      * @brief Set the to value for dimmable lights
@@ -306,11 +662,13 @@ class CompositeLight : public GenericLight {
      * @param value - brightness value in range 0-MAX_BRIGHTNESS of a first light
      * @param duration - fade duration (if supported by backend driver)
      */
-    void goValuePhaseShift(uint32_t value, int32_t duration);
+    void goValuePhaseShift(uint32_t value, int32_t duration, const easing::Easing &e);
 
     // *** overrides *** //
-    inline void set_to_value(uint32_t value) override { goValueComposite(value, 0); };
-    inline void fade_to_value(uint32_t value, int32_t duration) override { goValueComposite(value, duration); };
+    inline void set_to_value(uint32_t value) override { goValueComposite(value, 0, fade_easing()); };
+    // default duration is resolved once here, so that all children end their fades together
+    inline void fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e) override { goValueComposite(value, duration < 0 ? fade_duration(value) : duration, e); };
+    void fade_halt() override;
 
 public:
     CompositeLight(lightsource_t type, power_share_t share = power_share_t::incremental) : GenericLight(lightsource_t::composite, 0), sub_type(type), ps(share){};
@@ -320,13 +678,29 @@ public:
     // set methods
     luma::curve setCurve( luma::curve curve) override;
 
-    float setMaxPower(float p) override { return power; }     // combined power change is not supported
+    float setMaxPower(float /*p*/) override { return power; }     // combined power change is not supported
 
     // get methods
     uint32_t getValue() const override;
     inline uint32_t getMaxValue() const override { return combined_value; }
     float getCurrentPower() const override;
+    uint32_t getFadeTarget() const override;
+    uint32_t getFadeEta() const override;
+
+    void setEasing(easing::ease_t e, easing::bezier_t b = {0, 0, 255, 255}) override;
 
+    // color temperature is set for tunable light sources
+    void setCCT(uint16_t k, int32_t duration = USE_DEFAULT) override;
+    uint16_t getCCT() const override;
+
+protected:
+    // fade and CCT support is common for all light sources
+    light_caps_t mk_caps() const override;
+
+    // presets color temperature of tunable light sources
+    void cct_preset(uint16_t k) override;
+
+public:
     // Own methods
 
     /**
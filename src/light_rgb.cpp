@@ -0,0 +1,342 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_rgb.hpp"
+#include "esp_timer.h"
+#include <algorithm>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "light_rgb";
+
+RGBLight::RGBLight(DimmableLight *r, DimmableLight *g, DimmableLight *b, DimmableLight *w, luma::curve lcurve) : GenericLight(lightsource_t::rgb, 0, lcurve) {
+    ch[0].reset(r);
+    ch[1].reset(g);
+    ch[2].reset(b);
+    ch[3].reset(w);
+    chnum = w ? 4 : 3;
+
+    for (uint8_t i = 0; i != chnum; ++i){
+        power += ch[i]->getMaxPower();
+        lut_update(i);
+    }
+    color_update(color);
+}
+
+RGBLight::~RGBLight(){
+    fade_cancel();
+}
+
+void RGBLight::lut_update(uint8_t idx){
+    luma::curve c = ch[idx]->getCurve();
+    for (uint32_t i = 0; i != 256; ++i)
+        lut[idx][i] = luma::curveMap(c, i, 0xffff, 255) * wb[idx] / 255;
+}
+
+void RGBLight::color_update(rgb8_t c){
+    color = c;
+    comp[3] = chnum == 4 ? color::rgb2w(c) : 0;
+    comp[0] = c.r;
+    comp[1] = c.g;
+    comp[2] = c.b;
+}
+
+uint32_t RGBLight::ch_duty(uint8_t idx, uint32_t brt) const {
+    // 16 bit component intensity * 16 bit brightness -> 32 bit fraction of a channel's max duty
+    uint32_t i = (uint32_t)lut[idx][comp[idx]] * brt;
+    return ((uint64_t)i * ch[idx]->getMaxValue() + 0x7fffffff) >> 32;
+}
+
+void RGBLight::apply(const uint32_t *d){
+    for (uint8_t i = 0; i != chnum; ++i){
+        duty[i] = d[i];
+        ch[i]->stageValue(d[i]);
+    }
+    for (uint8_t i = 0; i != chnum; ++i)
+        ch[i]->flush();
+}
+
+void RGBLight::set_to_value(uint32_t val){
+    fade_cancel();
+    recolor = false;
+    value = val > RGB_MAX_VALUE ? RGB_MAX_VALUE : val;
+    ftrack.set(value);
+
+    uint32_t d[RGB_CHANNELS];
+    for (uint8_t i = 0; i != chnum; ++i)
+        d[i] = ch_duty(i, value);
+    apply(d);
+
+    ESP_LOGD(TAG, "set val:%u, color:%u,%u,%u,%u", value, comp[0], comp[1], comp[2], comp[3]);
+    onChange();
+}
+
+void RGBLight::fade_to_value(uint32_t val, int32_t duration, const easing::Easing &e){
+    if (duration < 0)
+        duration = fadetime;
+
+    if (!duration)
+        return set_to_value(val);
+
+    // fade path and tracked easing are read by ticks, set them up under the ticker's lock
+    LightTicker::getInstance()->lock();
+    uint32_t from = fade_value();
+    value = val > RGB_MAX_VALUE ? RGB_MAX_VALUE : val;
+    fade_track(from, value, duration, e);                 // ticks follow tracked easing, so track first
+    fade_begin(duration);
+    LightTicker::getInstance()->unlock();
+}
+
+void RGBLight::fade_begin(uint32_t duration){
+    LightTicker::getInstance()->detach(this);
+
+    // fade path end points as linear channel intensities
+    float from[RGB_CHANNELS], to[RGB_CHANNELS];
+    for (uint8_t i = 0; i != chnum; ++i){
+        float m = ch[i]->getMaxValue();
+        from[i] = duty[i] / m;
+        to[i] = ch_duty(i, value) / m;
+    }
+
+    color::oklab_t lab_from = color::linear2oklab(from[0], from[1], from[2]);
+    color::oklab_t lab_to = color::linear2oklab(to[0], to[1], to[2]);
+    // white channel follows OKLab lightness, interpolated in cube-root domain
+    float w_from = cbrtf(from[3]), w_to = cbrtf(to[3]);
+
+    for (uint32_t k = 0; k <= RGB_FADE_SEGMENTS; ++k){
+        float t = float(k) / RGB_FADE_SEGMENTS;
+        float lin[RGB_CHANNELS];
+        color::oklab2linear(color::lerp(lab_from, lab_to, t), lin[0], lin[1], lin[2]);
+        if (chnum == 4){
+            float w = w_from + (w_to - w_from) * t;
+            lin[3] = w * w * w;
+        }
+
+        for (uint8_t i = 0; i != chnum; ++i){
+            float v = lin[i] < 0 ? 0 : (lin[i] > 1 ? 1 : lin[i]);
+            kf[k][i] = v * ch[i]->getMaxValue() + 0.5f;
+        }
+    }
+    // keep exact end points, float round-trip might be off by one
+    for (uint8_t i = 0; i != chnum; ++i){
+        kf[0][i] = duty[i];
+        kf[RGB_FADE_SEGMENTS][i] = ch_duty(i, value);
+    }
+
+    fade_start = esp_timer_get_time();
+    fade_duration = duration;
+    fading = true;
+    LightTicker::getInstance()->attach(this);
+}
+
+void RGBLight::fade_cancel(){
+    // a tick in progress is finished once the lock is taken
+    LightTicker::getInstance()->lock();
+    if (fading){
+        fading = false;
+        LightTicker::getInstance()->detach(this);
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+void RGBLight::fade_halt(){
+    // no tick should move channels between the halt point and fade cancel
+    LightTicker::getInstance()->lock();
+    if (!fading){
+        value = fade_value();
+        ftrack.set(value);
+        LightTicker::getInstance()->unlock();
+        return;
+    }
+
+    // channels are brought to the current point on the path, so that color is taken right from them
+    uint32_t d[RGB_CHANNELS];
+    path_duties(esp_timer_get_time(), d);
+    apply(d);
+    fade_cancel();
+    value = fade_value();
+    ftrack.set(value);
+
+    resume_color = color;
+    resume_kelvin = kelvin;
+    if (recolor && !hold_color){
+        color_hold(value);
+        recolor = false;
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+void RGBLight::color_hold(uint32_t brt){
+    if (!brt)
+        return;             // nothing is lit, target color is as good as any
+
+    uint8_t c[RGB_CHANNELS] = {0};
+    for (uint8_t i = 0; i != chnum; ++i){
+        // component intensity is the inverse of ch_duty(), looked up in channel's LUT
+        uint64_t in = ((uint64_t)duty[i] << 32) / ((uint64_t)ch[i]->getMaxValue() * brt);
+        if (in > 0xffff)
+            in = 0xffff;
+        const uint16_t *l = lut[i];
+        const uint16_t *it = std::lower_bound(l, l + 255, in);
+        if (it != l && (int64_t)in - *(it - 1) < (int64_t)*it - (int64_t)in)
+            --it;
+        c[i] = it - l;
+    }
+
+    // components are taken as is, white is not extracted again
+    for (uint8_t i = 0; i != RGB_CHANNELS; ++i)
+        comp[i] = c[i];
+    color = {(uint8_t)std::min(255, c[0] + c[3]), (uint8_t)std::min(255, c[1] + c[3]), (uint8_t)std::min(255, c[2] + c[3])};
+    kelvin = 0;
+    ESP_LOGD(TAG, "color held at:%u,%u,%u,%u", comp[0], comp[1], comp[2], comp[3]);
+}
+
+void RGBLight::color_resume(){
+    if (!isPaused())
+        return;
+
+    recolor = resume_color.r != color.r || resume_color.g != color.g || resume_color.b != color.b;
+    color_update(resume_color);
+    kelvin = resume_kelvin;
+}
+
+void RGBLight::fadeResume(){
+    color_resume();
+    GenericLight::fadeResume();
+}
+
+void RGBLight::goRetarget(uint32_t val, const easing::Easing *e){
+    color_resume();
+    hold_color = true;
+    GenericLight::goRetarget(val, e);
+    hold_color = false;
+}
+
+light_caps_t RGBLight::mk_caps() const {
+    light_caps_t c = GenericLight::mk_caps();
+    c.flags |= LCAP_COLOR | LCAP_CCT | LCAP_FADE | LCAP_EASING;
+    c.fade_step = LightTicker::getInstance()->getPeriod();
+    return c;
+}
+
+uint32_t RGBLight::tick(int64_t now){
+    if (!fading)
+        return 0;
+
+    int64_t elapsed = now - fade_start;
+    int64_t total = (int64_t)fade_duration * 1000;
+    if (elapsed >= total){
+        fading = false;
+        recolor = false;
+        apply(kf[RGB_FADE_SEGMENTS]);
+        onChange();
+        return 0;
+    }
+
+    uint32_t d[RGB_CHANNELS];
+    path_duties(now, d);
+    apply(d);
+
+    return LightTicker::getInstance()->getPeriod();
+}
+
+void RGBLight::path_duties(int64_t now, uint32_t *d) const {
+    int64_t elapsed = now - fade_start;
+    int64_t total = (int64_t)fade_duration * 1000;
+    if (elapsed >= total){
+        for (uint8_t i = 0; i != chnum; ++i)
+            d[i] = kf[RGB_FADE_SEGMENTS][i];
+        return;
+    }
+
+    // eased fade progress as 16.16 fixed point segment position
+    uint32_t p = ftrack.curve(elapsed * EASE_SCALE / total);
+    uint32_t pos = (p + (p >> 15)) * RGB_FADE_SEGMENTS;
+    uint32_t seg = pos >> 16;
+    if (seg >= RGB_FADE_SEGMENTS){
+        seg = RGB_FADE_SEGMENTS - 1;
+        pos = seg << 16 | 0xffff;
+    }
+    int64_t frac = pos & 0xffff;
+
+    for (uint8_t i = 0; i != chnum; ++i)
+        d[i] = kf[seg][i] + (((int64_t)kf[seg + 1][i] - kf[seg][i]) * frac >> 16);
+}
+
+float RGBLight::getCurrentPower() const {
+    float p = 0;
+    for (uint8_t i = 0; i != chnum; ++i)
+        p += ch[i]->getCurrentPower();
+    return p;
+}
+
+void RGBLight::setColor(rgb8_t c, int32_t duration){
+    bool changed = recolor || c.r != color.r || c.g != color.g || c.b != color.b;
+    kelvin = resume_kelvin = 0;
+    resume_color = c;               // new color is the target of a paused fade too
+    color_update(c);
+    fade_to_value(value, duration, fade_easing());
+    recolor = changed && fading;
+}
+
+void RGBLight::setCCT(uint16_t k, int32_t duration){
+    setColor(color::cct2rgb(k), duration);
+    kelvin = resume_kelvin = k;
+}
+
+void RGBLight::cct_preset(uint16_t k){
+    rgb8_t c = color::cct2rgb(k);
+    // color change is a part of the next fade, set_to_value() drops the flag
+    recolor = recolor || c.r != color.r || c.g != color.g || c.b != color.b;
+    resume_color = c;
+    color_update(c);
+    kelvin = resume_kelvin = k;
+}
+
+void RGBLight::setWhiteBalance(uint8_t r, uint8_t g, uint8_t b, uint8_t w){
+    wb[0] = r;
+    wb[1] = g;
+    wb[2] = b;
+    wb[3] = w;
+    for (uint8_t i = 0; i != chnum; ++i)
+        lut_update(i);
+    set_to_value(value);
+}
+
+void RGBLight::setChannelCurve(rgb_ch_t c, luma::curve curve){
+    uint8_t idx = static_cast<uint8_t>(c);
+    if (idx >= chnum)
+        return;
+
+    ch[idx]->setCurve(curve);
+    lut_update(idx);
+    set_to_value(value);
+}
@@ -0,0 +1,199 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_generics.hpp"
+#include "color_math.hpp"
+#include "light_ticker.hpp"
+
+#define RGB_MAX_VALUE               0xffff          // brightness is a 16 bit linear intensity
+#define RGB_CHANNELS                4
+#define RGB_FADE_SEGMENTS           16              // number of precomputed fade path segments
+
+enum class rgb_ch_t:uint8_t { r, g, b, w };
+
+/**
+ * @brief RGB/RGBW light composed of dimmable channels
+ * brightness and color are controlled separately. Color could be set as RGB, HSV
+ * or color temperature, brightness is a regular light value mapped with a luma curve.
+ * Each channel has it's own luma LUT, converting color component to a linear
+ * channel intensity with channel's curve and white balance gain. LUTs are rebuilt only
+ * on calibration changes, so an update is integer-only.
+ * All channels are updated at once via staged duty changes.
+ *
+ * Fades are done by software on LightTicker. Color path is interpolated in OKLab
+ * space, so hue, saturation and brightness change perceptually even. The path is
+ * resolved to channel duties once per fade at RGB_FADE_SEGMENTS+1 keyframes,
+ * each tick is a plain integer interpolation between two of them
+ *
+ */
+class RGBLight : public GenericLight, public TickClient {
+
+    std::unique_ptr<DimmableLight> ch[RGB_CHANNELS];
+    uint8_t chnum;                                  // number of channels, 3 or 4
+    uint32_t value = 0;                             // brightness, linear, fade target while fading
+    rgb8_t color = {255, 255, 255};
+    uint16_t kelvin = 0;                            // color temperature color has been set with, 0 - none
+    uint8_t comp[RGB_CHANNELS] = {255, 255, 255, 0};    // channel components, white extracted for rgbw lights
+    uint8_t wb[RGB_CHANNELS] = {255, 255, 255, 255};    // white balance gains
+    uint16_t lut[RGB_CHANNELS][256];                // per-channel component to linear intensity tables
+    uint32_t duty[RGB_CHANNELS] = {0};              // channel duties applied last
+    uint32_t kf[RGB_FADE_SEGMENTS + 1][RGB_CHANNELS];   // fade path keyframes, channel duties
+    int64_t fade_start = 0;                         // us
+    uint32_t fade_duration = 0;                     // ms
+    bool fading = false;
+    bool recolor = false;                           // fade in progress changes color
+    bool hold_color = false;                        // fade_halt() keeps target color, fade is retargeted
+    rgb8_t resume_color = {255, 255, 255};          // color a halted fade was going to
+    uint16_t resume_kelvin = 0;
+
+    // rebuild LUT for a channel
+    void lut_update(uint8_t idx);
+
+    // calculate channel duty for current color and specified brightness
+    uint32_t ch_duty(uint8_t idx, uint32_t brt) const;
+
+    // split color to rgb(w) components
+    void color_update(rgb8_t c);
+
+    // stage and flush channel duties
+    void apply(const uint32_t *d);
+
+    // precompute fade path from current duties to the target ones and start fading, run under the ticker's lock
+    void fade_begin(uint32_t duration);
+
+    // stop fade in progress, channels are left at current duties
+    void fade_cancel();
+
+    // fade path duties at time 'now'
+    void path_duties(int64_t now, uint32_t *d) const;
+
+    // take the color on channels at brightness 'brt' as the current one, color is halted mid-fade
+    void color_hold(uint32_t brt);
+
+    // restore the color a paused fade was going to
+    void color_resume();
+
+    void set_to_value(uint32_t value) override;
+    void fade_to_value(uint32_t value, int32_t duration, const easing::Easing &e) override;
+    void fade_halt() override;
+    void cct_preset(uint16_t k) override;
+
+    // color fades are run on LightTicker
+    light_caps_t mk_caps() const override;
+
+public:
+    /**
+     * @brief Construct a new RGB(W) Light object
+     * channel lights are owned by the RGBLight object and will be destroyed with it
+     *
+     * @param r, g, b - color channels
+     * @param w - white channel, optional
+     * @param lcurve - brightness luma curve
+     */
+    RGBLight(DimmableLight *r, DimmableLight *g, DimmableLight *b, DimmableLight *w = nullptr, luma::curve lcurve = luma::curve::cie1931);
+    ~RGBLight();
+
+    // *** Overrides *** //
+    uint32_t getValue()     const override { return fade_value(); };
+    uint32_t getMaxValue()  const override { return RGB_MAX_VALUE; };
+    float getCurrentPower() const override;
+    float setMaxPower(float) override { return power; }     // combined power change is not supported
+
+    /**
+     * @brief resume paused fade
+     * color fade goes on from the color reached to it's target
+     */
+    void fadeResume() override;
+
+    /**
+     * @brief change brightness target of a fade in progress
+     * color fade goes on to it's target
+     */
+    void goRetarget(uint32_t value, const easing::Easing *e = nullptr) override;
+
+    /**
+     * @brief fade engine tick, advances fade in progress
+     */
+    uint32_t tick(int64_t now) override;
+
+    // Own methods
+
+    /**
+     * @brief set color, brightness is not changed
+     * for RGBW lights common part of RGB components is rendered with white channel
+     *
+     * @param c - color
+     * @param duration - fade duration
+     */
+    void setColor(rgb8_t c, int32_t duration = USE_DEFAULT);
+
+    /**
+     * @brief set color as HSV
+     *
+     * @param hue - hue, degrees 0-359
+     * @param sat - saturation 0-255
+     * @param duration - fade duration
+     */
+    void setHSV(uint16_t hue, uint8_t sat, int32_t duration = USE_DEFAULT){ setColor(color::hsv2rgb(hue, sat), duration); };
+
+    /**
+     * @brief set white color with specified color temperature
+     *
+     * @param kelvin - color temperature, K
+     * @param duration - fade duration
+     */
+    void setCCT(uint16_t kelvin, int32_t duration = USE_DEFAULT) override;
+
+    /**
+     * @brief color temperature set with setCCT()
+     * 0 if color has been set otherwise
+     */
+    uint16_t getCCT() const override { return kelvin; };
+
+    rgb8_t getColor() const { return color; };
+
+    /**
+     * @brief set white balance calibration
+     * gains are applied to channel's full intensity, 255 is 100%.
+     * Usually the brightest channel is scaled down to match the others
+     */
+    void setWhiteBalance(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 255);
+
+    /**
+     * @brief set luma curve for a color channel
+     * curve converts color component to channel's intensity
+     */
+    void setChannelCurve(rgb_ch_t c, luma::curve curve);
+
+    /**
+     * @brief access a channel light
+     * could be nullptr for white channel of RGB light
+     */
+    DimmableLight *getChannel(rgb_ch_t c){ return ch[static_cast<uint8_t>(c)].get(); };
+
+    uint8_t channels() const { return chnum; };
+};
@@ -0,0 +1,240 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_strip.hpp"
+#include <string.h>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "light_strip";
+
+// component indexes in rgb8_t for each wire order
+static const uint8_t order_map[][3] = {
+    {0, 1, 2},      // rgb
+    {0, 2, 1},      // rbg
+    {1, 0, 2},      // grb
+    {1, 2, 0},      // gbr
+    {2, 0, 1},      // brg
+    {2, 1, 0}       // bgr
+};
+
+// ns to ticks, rounded
+static inline uint32_t ns2ticks(uint32_t ns, uint32_t tick_hz){
+    return ((uint64_t)ns * tick_hz + 500000000) / 1000000000;
+}
+
+
+// *** WS2812Encoder ***
+WS2812Encoder::WS2812Encoder(uint32_t tick_hz, color_order_t order, uint32_t t0h, uint32_t t0l, uint32_t t1h, uint32_t t1l) : order(order) {
+    bit0.level0 = 1;
+    bit0.duration0 = ns2ticks(t0h, tick_hz);
+    bit0.level1 = 0;
+    bit0.duration1 = ns2ticks(t0l, tick_hz);
+    bit1.level0 = 1;
+    bit1.duration0 = ns2ticks(t1h, tick_hz);
+    bit1.level1 = 0;
+    bit1.duration1 = ns2ticks(t1l, tick_hz);
+}
+
+size_t WS2812Encoder::encode(const rgb8_t *px, size_t count, const uint8_t *lut, strip_symbol_t *out) const {
+    const uint8_t *idx = order_map[static_cast<uint8_t>(order)];
+    strip_symbol_t *o = out;
+
+    for (size_t i = 0; i != count; ++i){
+        const uint8_t *c = &px[i].r;
+        for (uint8_t k = 0; k != 3; ++k){
+            uint8_t v = lut ? lut[c[idx[k]]] : c[idx[k]];
+            for (uint8_t mask = 0x80; mask; mask >>= 1)
+                (o++)->val = (v & mask) ? bit1.val : bit0.val;
+        }
+    }
+    return o - out;
+}
+
+
+// *** StripOutputRMT ***
+StripOutputRMT::StripOutputRMT(int gpio, rmt_channel_t channel, uint8_t clkdiv) : ch(channel), clk_div(clkdiv ? clkdiv : 1) {
+    rmt_config_t cfg = RMT_DEFAULT_CONFIG_TX((gpio_num_t)gpio, ch);
+    cfg.clk_div = clk_div;
+
+    esp_err_t err = rmt_config(&cfg);
+    if (err == ESP_OK)
+        err = rmt_driver_install(ch, 0, 0);
+    if (err == ESP_OK)
+        err = rmt_translator_init(ch, translate);
+    if (err == ESP_OK)
+        err = rmt_translator_set_context(ch, this);
+
+    if (err != ESP_OK){
+        ESP_LOGE(TAG, "RMT channel %d init failed: %s", ch, esp_err_to_name(err));
+        return;
+    }
+    ready = true;
+}
+
+StripOutputRMT::~StripOutputRMT(){
+    if (!ready)
+        return;
+    wait();
+    rmt_driver_uninstall(ch);
+}
+
+void StripOutputRMT::translate(const void *src, rmt_item32_t *dest, size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num){
+    StripOutputRMT *self = nullptr;
+    rmt_translator_get_context(item_num, (void**)&self);
+    if (!self || !self->enc){
+        *translated_size = 0;
+        *item_num = 0;
+        return;
+    }
+
+    size_t px = wanted_num / self->enc->symbolsPerPixel();
+    if (px > src_size / sizeof(rgb8_t))
+        px = src_size / sizeof(rgb8_t);
+
+    *item_num = self->enc->encode(static_cast<const rgb8_t*>(src), px, self->lut, reinterpret_cast<strip_symbol_t*>(dest));
+    *translated_size = px * sizeof(rgb8_t);
+}
+
+esp_err_t StripOutputRMT::write(const rgb8_t *px, size_t count, const PixelEncoder *encoder, const uint8_t *table){
+    if (!ready)
+        return ESP_ERR_INVALID_STATE;
+
+    enc = encoder;
+    lut = table;
+    return rmt_write_sample(ch, reinterpret_cast<const uint8_t*>(px), count * sizeof(rgb8_t), false);
+}
+
+esp_err_t StripOutputRMT::wait(uint32_t timeout_ms){
+    if (!ready)
+        return ESP_ERR_INVALID_STATE;
+
+    return rmt_wait_tx_done(ch, timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+
+
+// *** StripLight ***
+StripLight::StripLight(size_t length, PixelEncoder *encoder, StripOutput *output, luma::curve lcurve, float power) :
+    GenericLight(lightsource_t::dynamic, power, lcurve), len(length), enc(encoder), out(output) {
+    buff[0].reset(new rgb8_t[len]());
+    buff[1].reset(new rgb8_t[len]());
+    front = buff[0].get();
+    back = buff[1].get();
+    lut_update();
+}
+
+StripLight::~StripLight(){
+    // buffers must not be released while streaming
+    if (out)
+        out->wait();
+}
+
+void StripLight::lut_update(){
+    for (uint32_t i = 0; i <= STRIP_MAX_BRIGHTNESS; ++i)
+        lut[i] = (i * brt + STRIP_MAX_BRIGHTNESS/2) / STRIP_MAX_BRIGHTNESS;
+}
+
+void StripLight::set_to_value(uint32_t value){
+    // lut is in use by encoder until transmission is done
+    if (out)
+        out->wait();
+    brt = value > STRIP_MAX_BRIGHTNESS ? STRIP_MAX_BRIGHTNESS : value;
+    lut_update();
+    refresh();
+    onChange();
+}
+
+float StripLight::getCurrentPower() const {
+    if (!len)
+        return 0;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i != len; ++i)
+        sum += lut[front[i].r] + lut[front[i].g] + lut[front[i].b];
+
+    return power * sum / (len * 3 * STRIP_MAX_BRIGHTNESS);
+}
+
+void StripLight::setPixel(size_t idx, rgb8_t color){
+    if (idx < len)
+        back[idx] = color;
+}
+
+rgb8_t StripLight::getPixel(size_t idx) const {
+    return idx < len ? back[idx] : rgb8_t{0, 0, 0};
+}
+
+void StripLight::fill(size_t from, size_t count, rgb8_t color){
+    if (from >= len)
+        return;
+    if (count > len - from)
+        count = len - from;
+
+    for (rgb8_t *p = &back[from], *end = p + count; p != end; ++p)
+        *p = color;
+}
+
+void StripLight::scaleRange(size_t from, size_t count, uint8_t scale){
+    if (from >= len)
+        return;
+    if (count > len - from)
+        count = len - from;
+
+    // nscale8: 255 keeps color as is, 0 turns pixel off
+    uint16_t s = scale + 1;
+    for (rgb8_t *p = &back[from], *end = p + count; p != end; ++p){
+        p->r = (p->r * s) >> 8;
+        p->g = (p->g * s) >> 8;
+        p->b = (p->b * s) >> 8;
+    }
+}
+
+esp_err_t StripLight::show(){
+    if (!out || !enc)
+        return ESP_ERR_INVALID_STATE;
+
+    // old front buffer becomes a back one, it must not be streaming anymore
+    out->wait();
+    std::swap(front, back);
+    return out->write(front, len, enc, lut);
+}
+
+esp_err_t StripLight::refresh(){
+    if (!out || !enc)
+        return ESP_ERR_INVALID_STATE;
+
+    out->wait();
+    return out->write(front, len, enc, lut);
+}
+
+void StripLight::sync(){
+    memcpy(back, front, len * sizeof(rgb8_t));
+}
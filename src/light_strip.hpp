@@ -0,0 +1,274 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "light_generics.hpp"
+#include "driver/rmt.h"
+
+#define STRIP_MAX_BRIGHTNESS        255
+#define WS2812_T0H_NS               400
+#define WS2812_T0L_NS               850
+#define WS2812_T1H_NS               800
+#define WS2812_T1L_NS               450
+#define RMT_DEFAULT_CLK_DIV         8           // 80 MHz APB / 8 = 10 MHz RMT tick
+#define RMT_APB_CLK_HZ              80000000
+
+/**
+ * @brief output symbol, a pair of level/duration pulses
+ * bit layout matches RMT's rmt_item32_t, so symbols could be sent to RMT as is
+ */
+union strip_symbol_t {
+    struct {
+        uint32_t duration0 :15;
+        uint32_t level0 :1;
+        uint32_t duration1 :15;
+        uint32_t level1 :1;
+    };
+    uint32_t val;
+};
+
+// wire order of color components
+enum class color_order_t:uint8_t { rgb, rbg, grb, gbr, brg, bgr };
+
+/**
+ * @brief Abstract pixel encoder
+ * converts pixels to a stream of output symbols
+ */
+class PixelEncoder {
+public:
+    virtual ~PixelEncoder(){};
+
+    /**
+     * @brief number of output symbols per one pixel
+     */
+    virtual size_t symbolsPerPixel() const = 0;
+
+    /**
+     * @brief encode pixels to output symbols
+     *
+     * @param px - pixels to encode
+     * @param count - number of pixels
+     * @param lut - brightness lookup table applied to each color component, might be nullptr
+     * @param out - output buffer, must fit count * symbolsPerPixel() symbols
+     * @return size_t - number of symbols written
+     */
+    virtual size_t encode(const rgb8_t *px, size_t count, const uint8_t *lut, strip_symbol_t *out) const = 0;
+};
+
+/**
+ * @brief WS2812 family (and alike one-wire NRZ) pixel encoder
+ * each bit of a color component becomes a symbol, MSB first
+ */
+class WS2812Encoder : public PixelEncoder {
+    strip_symbol_t bit0;
+    strip_symbol_t bit1;
+    color_order_t order;
+
+public:
+    /**
+     * @brief Construct a new WS2812 Encoder
+     *
+     * @param tick_hz - output clock, symbol durations are calculated in ticks of this clock
+     * @param order - wire order of color components
+     * @param t0h, t0l, t1h, t1l - pulse timings, ns
+     */
+    WS2812Encoder(uint32_t tick_hz = RMT_APB_CLK_HZ / RMT_DEFAULT_CLK_DIV, color_order_t order = color_order_t::grb,
+                    uint32_t t0h = WS2812_T0H_NS, uint32_t t0l = WS2812_T0L_NS, uint32_t t1h = WS2812_T1H_NS, uint32_t t1l = WS2812_T1L_NS);
+
+    size_t symbolsPerPixel() const override { return 24; };
+    size_t encode(const rgb8_t *px, size_t count, const uint8_t *lut, strip_symbol_t *out) const override;
+};
+
+
+/**
+ * @brief Abstract strip output
+ * streams pixels to the wire, pixels are converted to symbols by the encoder
+ * on demand, in chunks, so full symbol stream is never materialized in memory
+ */
+class StripOutput {
+public:
+    virtual ~StripOutput(){};
+
+    /**
+     * @brief start pixels transmission
+     * call does not block until transmission is done, pixels buffer and lut
+     * must not be changed until wait() returns
+     *
+     * @param px - pixels to send
+     * @param count - number of pixels
+     * @param enc - pixel encoder
+     * @param lut - brightness lookup table for the encoder, might be nullptr
+     * @return esp_err_t
+     */
+    virtual esp_err_t write(const rgb8_t *px, size_t count, const PixelEncoder *enc, const uint8_t *lut) = 0;
+
+    /**
+     * @brief wait for transmission in progress to complete
+     *
+     * @param timeout_ms - max time to wait, ms
+     * @return esp_err_t
+     */
+    virtual esp_err_t wait(uint32_t timeout_ms = portMAX_DELAY) = 0;
+};
+
+/**
+ * @brief RMT peripheral strip output
+ * pixels are encoded by RMT translator, each time driver refills channel's memory
+ *
+ */
+class StripOutputRMT : public StripOutput {
+    rmt_channel_t ch;
+    uint8_t clk_div;
+    bool ready = false;
+    const PixelEncoder *enc = nullptr;              // encoder and lut of the transmission in progress
+    const uint8_t *lut = nullptr;
+
+    // RMT translator, converts as many pixels as fits into wanted_num symbols
+    static void translate(const void *src, rmt_item32_t *dest, size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num);
+
+public:
+    StripOutputRMT(int gpio, rmt_channel_t channel = RMT_CHANNEL_0, uint8_t clkdiv = RMT_DEFAULT_CLK_DIV);
+    ~StripOutputRMT();
+
+    /**
+     * @brief RMT tick rate, Hz
+     * to be used as encoder's clock
+     */
+    uint32_t getTickHz() const { return RMT_APB_CLK_HZ / clk_div; };
+
+    // *** Overrides *** //
+    esp_err_t write(const rgb8_t *px, size_t count, const PixelEncoder *enc, const uint8_t *lut) override;
+    esp_err_t wait(uint32_t timeout_ms = portMAX_DELAY) override;
+};
+
+
+/**
+ * @brief Addressable LED strip light
+ * holds a pair of framebuffers with pixels colors. All pixel methods draw
+ * into the back buffer while the front one is streamed to the strip, show()
+ * swaps the buffers without copying.
+ * Brightness is a global scale applied to all pixels on output via lookup
+ * table, so framebuffers content is never changed by brightness controls
+ *
+ */
+class StripLight : public GenericLight {
+
+    size_t len;                                     // number of pixels
+    std::unique_ptr<rgb8_t[]> buff[2];              // framebuffers
+    rgb8_t *front;                                  // buffer being sent to the strip
+    rgb8_t *back;                                   // buffer to draw in
+    PixelEncoder *enc;
+    StripOutput *out;
+    uint8_t brt = 0;                                // global brightness (curve-mapped)
+    uint8_t lut[STRIP_MAX_BRIGHTNESS + 1];          // brightness scale lookup table
+
+    // rebuild brightness LUT for current brightness
+    void lut_update();
+
+    void set_to_value(uint32_t value) override;
+
+    light_caps_t mk_caps() const override { light_caps_t c = GenericLight::mk_caps(); c.flags |= LCAP_COLOR; return c; };
+
+public:
+    /**
+     * @brief Construct a new Strip Light object
+     * encoder and output objects are not owned by the strip and must outlive it
+     *
+     * @param length - number of pixels
+     * @param encoder - pixel encoder
+     * @param output - strip output
+     * @param lcurve - luma curve for global brightness
+     * @param power - power of the strip when all pixels are at full white
+     */
+    StripLight(size_t length, PixelEncoder *encoder, StripOutput *output, luma::curve lcurve = luma::curve::cie1931, float power = 1.0);
+    ~StripLight();
+
+    // *** Overrides *** //
+    uint32_t getValue()     const override { return brt; };
+    uint32_t getMaxValue()  const override { return STRIP_MAX_BRIGHTNESS; };
+
+    /**
+     * @brief Get Current Power
+     * estimated from front buffer content scaled by brightness
+     */
+    float getCurrentPower() const override;
+
+    // Own methods
+    size_t length() const { return len; };
+
+    /**
+     * @brief direct access to the back buffer
+     * pointer is valid until next show() call
+     */
+    rgb8_t *framebuffer(){ return back; };
+
+    void setPixel(size_t idx, rgb8_t color);
+    rgb8_t getPixel(size_t idx) const;
+
+    /**
+     * @brief fill a range of pixels with color
+     *
+     * @param from - first pixel
+     * @param count - number of pixels
+     * @param color - color
+     */
+    void fill(size_t from, size_t count, rgb8_t color);
+    void fill(rgb8_t color){ fill(0, len, color); };
+    void clear(){ fill(0, len, rgb8_t{0, 0, 0}); };
+
+    /**
+     * @brief scale pixel brightness
+     * pixel color is multiplied by scale/256 (nscale8), it's a framebuffer change,
+     * not related to global brightness
+     *
+     * @param idx - pixel index
+     * @param scale - scale 0-255
+     */
+    void scalePixel(size_t idx, uint8_t scale){ scaleRange(idx, 1, scale); };
+    void scaleRange(size_t from, size_t count, uint8_t scale);
+
+    /**
+     * @brief swap buffers and send the new front buffer to the strip
+     * waits for previous frame transmission to complete. After swap back buffer
+     * holds the frame before the current one, call sync() first if
+     * the next frame is drawn incrementally
+     *
+     * @return esp_err_t
+     */
+    esp_err_t show();
+
+    /**
+     * @brief resend front buffer to the strip, i.e. on brightness change
+     *
+     * @return esp_err_t
+     */
+    esp_err_t refresh();
+
+    /**
+     * @brief copy front buffer into the back one
+     */
+    void sync();
+};
@@ -0,0 +1,167 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_ticker.hpp"
+#include "esp_timer.h"
+#include <time.h>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "LTicker";
+
+LightTicker::LightTicker(){
+    mtx = xSemaphoreCreateRecursiveMutex();
+}
+
+LightTicker::~LightTicker(){
+    if (t_tick)
+        vTaskDelete(t_tick);
+    vSemaphoreDelete(mtx);
+}
+
+void LightTicker::attach(TickClient *c, uint32_t delay_ms){
+    if (!c)
+        return;
+
+    int64_t due = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+
+    xSemaphoreTakeRecursive(mtx, portMAX_DELAY);
+    bool found = false;
+    for (auto _i = clients.begin(); _i != clients.end(); ++_i){
+        if (_i->c == c){
+            _i->due = due;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+        clients.add(client_t({c, due}));
+
+    if (!t_tick){
+        if (pdPASS != xTaskCreate(LightTicker::tickerTask, TICKER_TASK_NAME, TICKER_TASK_STACK, (void *)this, TICKER_TASK_PRIO, &t_tick))
+            ESP_LOGE(TAG, "Can't create ticker task");
+    } else if (!ticking)
+        xTaskNotifyGive(t_tick);        // wake up the task to recalculate next due time
+    xSemaphoreGiveRecursive(mtx);
+}
+
+void LightTicker::detach(TickClient *c){
+    xSemaphoreTakeRecursive(mtx, portMAX_DELAY);
+    for (auto _i = clients.begin(); _i != clients.end(); ++_i){
+        if (_i->c == c){
+            _i->c = nullptr;            // mark for removal, list could be iterated by the ticker right now
+            purge = true;
+            break;
+        }
+    }
+    if (t_tick && !ticking)
+        xTaskNotifyGive(t_tick);
+    xSemaphoreGiveRecursive(mtx);
+}
+
+void LightTicker::tick_handler(){
+    TickType_t sleep = 0;           // task is started by the first client attached
+
+    for (;;){
+        ulTaskNotifyTake(pdTRUE, sleep);
+
+        xSemaphoreTakeRecursive(mtx, portMAX_DELAY);
+        ticking = true;
+        int64_t now = esp_timer_get_time();
+
+        for (auto _i = clients.begin(); _i != clients.end(); ++_i){
+            if (!_i->c)
+                continue;
+
+            if (_i->due <= now){
+                TickClient *c = _i->c;
+                uint32_t delay = c->tick(now);
+                if (!_i->c || _i->c != c)
+                    continue;           // client has detached itself
+                if (!delay){
+                    _i->c = nullptr;
+                    purge = true;
+                    continue;
+                }
+                _i->due = now + (int64_t)delay * 1000;
+            }
+        }
+
+        // remove detached clients
+        while (purge){
+            purge = false;
+            for (int i = 0; i != clients.size(); ++i){
+                if (!clients.get(i).c){
+                    clients.remove(i);
+                    purge = true;
+                    break;
+                }
+            }
+        }
+        // clients could be rescheduled from callbacks, so find the nearest due time in a separate pass
+        int64_t next = INT64_MAX;
+        for (auto _i = clients.cbegin(); _i != clients.cend(); ++_i){
+            if (_i->due < next)
+                next = _i->due;
+        }
+        ticking = false;
+        xSemaphoreGiveRecursive(mtx);
+
+        if (next == INT64_MAX)
+            sleep = portMAX_DELAY;
+        else {
+            // round up, so that client is never called before it's due
+            int64_t t = (next - esp_timer_get_time() + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000);
+            sleep = t > 0 ? t : 0;
+        }
+    }
+}
+
+
+void DayClock::set(int32_t sec){
+    anchored = sec >= 0;
+    anchor = (uint32_t)(sec % 86400) * 1000;
+    anchor_us = esp_timer_get_time();
+}
+
+uint32_t DayClock::ms(int64_t now) const {
+    if (anchored)
+        return (anchor + (uint64_t)(now - anchor_us) / 1000) % LIGHT_DAY_MS;
+
+    time_t t = time(nullptr);
+    struct tm lt;
+    localtime_r(&t, &lt);
+    return ((lt.tm_hour * 60 + lt.tm_min) * 60 + lt.tm_sec) * 1000;
+}
+
+uint32_t DayClock::sec() const {
+    return ms(esp_timer_get_time()) / 1000;
+}
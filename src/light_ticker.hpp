@@ -0,0 +1,165 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "LList.h"
+
+#define LIGHT_TICK_PERIOD           20              // ms, default period for software fades/effects
+
+#define TICKER_TASK_NAME            "LTicker"
+#define TICKER_TASK_STACK           4096
+#define TICKER_TASK_PRIO            3
+
+#define LIGHT_DAY_MS                86400000UL      // ms in a day
+
+/**
+ * @brief Abstract ticker client
+ * anything that needs to be run periodically - software fades, effects, schedulers
+ */
+class TickClient {
+public:
+    virtual ~TickClient(){};
+
+    /**
+     * @brief ticker callback, executed from ticker's task
+     *
+     * @param now - current time, us
+     * @return uint32_t - delay until next call, ms. Returning 0 detaches client from ticker
+     */
+    virtual uint32_t tick(int64_t now) = 0;
+};
+
+/**
+ * @brief Light ticker
+ * a shared time base for software fade engines and effects. Runs a single task
+ * that calls each attached client when it's due. Each client chooses it's own next due time,
+ * task sleeps until the nearest one, so with no active clients CPU is not woken up at all
+ *
+ */
+class LightTicker {
+
+    struct client_t {
+        TickClient *c;
+        int64_t due;                // us
+    };
+
+    TaskHandle_t t_tick = nullptr;
+    SemaphoreHandle_t mtx;
+    LList<client_t> clients;
+    uint32_t period = LIGHT_TICK_PERIOD;
+    bool ticking = false;           // clients iteration in progress
+    bool purge = false;             // there are detached clients to remove from the list
+
+    LightTicker();
+    ~LightTicker();
+
+    void tick_handler();
+
+    // static wrapper for ticker Task
+    static void tickerTask(void* pvParams){
+        ((LightTicker*)pvParams)->tick_handler();
+    }
+
+public:
+    // this is a singleton
+    LightTicker(LightTicker const&) = delete;
+    void operator=(LightTicker const&) = delete;
+
+    /**
+     * obtain a pointer to singleton instance
+     */
+    static LightTicker *getInstance(){
+        static LightTicker instance;
+        return &instance;
+    }
+
+    /**
+     * @brief attach client to the ticker or reschedule an attached one
+     *
+     * @param c - client
+     * @param delay_ms - delay until first call, ms. 0 means call on the next ticker run
+     */
+    void attach(TickClient *c, uint32_t delay_ms = 0);
+
+    /**
+     * @brief detach client from the ticker
+     * it is safe to call from client's tick() callback
+     */
+    void detach(TickClient *c);
+
+    /**
+     * @brief default tick period for fades and effects
+     */
+    uint32_t getPeriod() const { return period; };
+    void setPeriod(uint32_t ms){ if (ms) period = ms; };
+
+    /**
+     * @brief take ticker's lock, recursive
+     * clients' tick() calls are run under this lock. Objects shared between tick() callbacks
+     * and other tasks could be guarded with it instead of their own mutex, this keeps a single
+     * lock order when a tick and another task call into each other
+     */
+    void lock(){ xSemaphoreTakeRecursive(mtx, portMAX_DELAY); };
+    void unlock(){ xSemaphoreGiveRecursive(mtx); };
+
+    /**
+     * @brief check if the calling task holds ticker's lock
+     * code that could be run under the lock should not block on anything else
+     */
+    bool holding() const { return xSemaphoreGetMutexHolder(mtx) == xTaskGetCurrentTaskHandle(); };
+};
+
+/**
+ * @brief time of day for schedulers
+ * either set explicitly and then anchored to the monotonic clock, or taken from system's clock
+ */
+class DayClock {
+    bool anchored = false;
+    uint32_t anchor = 0;            // ms of day
+    int64_t anchor_us = 0;
+
+public:
+    /**
+     * @brief set time of day
+     * clock then follows monotonic clock from this point
+     *
+     * @param sec - seconds of day, <0 - use system's clock
+     */
+    void set(int32_t sec);
+
+    /**
+     * @brief time of day at monotonic time 'now', ms
+     */
+    uint32_t ms(int64_t now) const;
+
+    /**
+     * @brief current time of day, s
+     */
+    uint32_t sec() const;
+};
@@ -0,0 +1,160 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "light_trace.hpp"
+
+#ifdef LIGHTMGR_TRACE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <string.h>
+
+#define TRACE_MAX_TASKS         16
+#define TRACE_TASK_NAME_LEN     16
+
+namespace {
+
+struct trace_evt_t {
+    std::atomic<uint32_t> seq;      // sequence number + 1 of the event in the slot, written last
+    const char *name;
+    int64_t ts;                     // us
+    void *task;                     // nullptr for ISR
+    char ph;
+};
+
+struct trace_task_t {
+    std::atomic<bool> claimed;
+    std::atomic<void*> handle;      // published once name is set
+    char name[TRACE_TASK_NAME_LEN];
+};
+
+trace_evt_t ring[LIGHTMGR_TRACE_RING_SIZE];
+std::atomic<uint32_t> head{0};
+std::atomic<bool> enabled{true};
+trace_task_t tasks[TRACE_MAX_TASKS];
+
+static_assert((LIGHTMGR_TRACE_RING_SIZE & (LIGHTMGR_TRACE_RING_SIZE - 1)) == 0, "trace ring size must be a power of 2");
+
+// remember task name the first time task is seen, names are resolved on dump, when task might be gone already
+void task_register(void *t){
+    for (auto &i : tasks){
+        if (i.handle.load(std::memory_order_acquire) == t)
+            return;
+    }
+
+    // only the task itself registers it's handle, a slot is claimed first and published with the name set
+    for (auto &i : tasks){
+        bool expected = false;
+        if (!i.claimed.load(std::memory_order_relaxed) && i.claimed.compare_exchange_strong(expected, true)){
+            strncpy(i.name, pcTaskGetName((TaskHandle_t)t), TRACE_TASK_NAME_LEN - 1);
+            i.handle.store(t, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+inline void IRAM_ATTR record(const char *name, char ph, void *task){
+    if (!enabled.load(std::memory_order_relaxed))
+        return;
+
+    uint32_t seq = head.fetch_add(1, std::memory_order_relaxed);
+    trace_evt_t &e = ring[seq & (LIGHTMGR_TRACE_RING_SIZE - 1)];
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);        // slot is marked invalid before fields change
+    e.name = name;
+    e.ts = esp_timer_get_time();
+    e.task = task;
+    e.ph = ph;
+    e.seq.store(seq + 1, std::memory_order_release);
+}
+
+}   // namespace
+
+namespace lighttrace {
+
+void event(const char *name, char ph){
+    void *t = xTaskGetCurrentTaskHandle();
+    task_register(t);
+    record(name, ph, t);
+}
+
+void IRAM_ATTR isr_event(const char *name){
+    record(name, 'i', nullptr);
+}
+
+void enable(bool state){
+    enabled = state;
+}
+
+void clear(){
+    for (auto &e : ring)
+        e.seq = 0;
+    head = 0;
+}
+
+size_t dump(FILE *f){
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ISR\"}}");
+    for (unsigned i = 0; i != TRACE_MAX_TASKS; ++i){
+        if (tasks[i].handle.load(std::memory_order_acquire))
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", i + 1, tasks[i].name);
+    }
+
+    uint32_t end = head.load();
+    uint32_t begin = end > LIGHTMGR_TRACE_RING_SIZE ? end - LIGHTMGR_TRACE_RING_SIZE : 0;
+    size_t cnt = 0;
+    for (uint32_t seq = begin; seq != end; ++seq){
+        const trace_evt_t &slot = ring[seq & (LIGHTMGR_TRACE_RING_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != seq + 1)
+            continue;       // slot is being rewritten
+
+        // seqlock read, a copy is valid only if the slot was not rewritten while copying
+        struct { const char *name; int64_t ts; void *task; char ph; } e = {slot.name, slot.ts, slot.task, slot.ph};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq + 1)
+            continue;
+
+        unsigned tid = 0;
+        for (unsigned i = 0; e.task && i != TRACE_MAX_TASKS; ++i){
+            if (tasks[i].handle.load(std::memory_order_acquire) == e.task){
+                tid = i + 1;
+                break;
+            }
+        }
+
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%u%s}",
+            e.name, e.ph, (long long)e.ts, tid, e.ph == 'i' ? ",\"s\":\"t\"" : "");
+        ++cnt;
+    }
+    fprintf(f, "\n]}\n");
+    return cnt;
+}
+
+}   // namespace lighttrace
+
+#endif  // LIGHTMGR_TRACE
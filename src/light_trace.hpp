@@ -0,0 +1,102 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+
+/*
+    Execution tracing hooks
+
+    Trace points record begin/end/instant events with timestamps into a lock-free
+    in-memory ring, the ring could be dumped as a Chrome trace JSON
+    (chrome://tracing, https://ui.perfetto.dev).
+    Tracing is compiled in only when LIGHTMGR_TRACE is defined, otherwise all
+    trace macros are empty
+*/
+
+#ifdef LIGHTMGR_TRACE
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef LIGHTMGR_TRACE_RING_SIZE
+#define LIGHTMGR_TRACE_RING_SIZE    1024            // number of events kept, must be a power of 2
+#endif
+
+namespace lighttrace {
+
+/**
+ * @brief record an event
+ *
+ * @param name - trace point name, must be a string with static storage
+ * @param ph - Chrome trace event phase, 'B' - begin, 'E' - end, 'i' - instant
+ */
+void event(const char *name, char ph);
+
+/**
+ * @brief record an instant event from an ISR
+ */
+void isr_event(const char *name);
+
+/**
+ * @brief enable/disable recording, enabled by default
+ */
+void enable(bool state);
+
+/**
+ * @brief drop all recorded events
+ */
+void clear();
+
+/**
+ * @brief write recorded events as Chrome trace JSON
+ * recording should be disabled while dumping, otherwise events being written
+ * might be skipped
+ *
+ * @param f - output stream
+ * @return size_t - number of events written
+ */
+size_t dump(FILE *f = stdout);
+
+// RAII begin/end pair
+class Scope {
+    const char *name;
+public:
+    Scope(const char *n) : name(n) { event(name, 'B'); };
+    ~Scope(){ event(name, 'E'); };
+};
+
+}   // namespace lighttrace
+
+#define LTRACE_SCOPE(name)      lighttrace::Scope _ltrace_scope(name)
+#define LTRACE_INSTANT(name)    lighttrace::event(name, 'i')
+#define LTRACE_ISR(name)        lighttrace::isr_event(name)
+
+#else
+
+#define LTRACE_SCOPE(name)
+#define LTRACE_INSTANT(name)
+#define LTRACE_ISR(name)
+
+#endif  // LIGHTMGR_TRACE
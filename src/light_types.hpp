@@ -34,7 +34,8 @@ enum class lightsource_t:uint8_t {
     dimmable,           // dimmable sources
     rgb,                // any rgb's, including rgbw, rgbww, etc...
     dynamic,            // all kinds of addressable leds, etc...
-    composite           // light units with more than one light source
+    composite,          // light units with more than one light source
+    tunable             // tunable white, warm and cool white channels
 };
 
 enum class power_share_t:uint8_t {
@@ -43,6 +44,39 @@ enum class power_share_t:uint8_t {
     phaseshift          // sources try to do max load in a round robbin time slots (phase-shifted PWM)
 };
 
+enum class fade_mode_t:uint8_t {
+    duration,           // default fades take fixed time
+    rate                // default fades take time proportional to perceptual distance (constant speed)
+};
+
+
+// light capability flags
+#define LCAP_DIMMABLE           (1U << 0)       // has brightness levels besides on/off
+#define LCAP_CURVES             (1U << 1)       // luma curve could be changed
+#define LCAP_FADE               (1U << 2)       // driver does fades, otherwise value changes at once
+#define LCAP_EASING             (1U << 3)       // fades could follow easing functions
+#define LCAP_ACTIVE_LEVEL       (1U << 4)       // active logic level could be inverted
+#define LCAP_DUTY_SHIFT         (1U << 5)       // PWM duty shift for phase-shifted dimming
+#define LCAP_STAGED             (1U << 6)       // values could be staged and flushed together, see DimmableLight::stageValue()
+#define LCAP_COLOR              (1U << 7)       // color control
+#define LCAP_CCT                (1U << 8)       // color temperature control
+
+/**
+ * @brief light capabilities descriptor
+ * computed once per light object, describes what is supported by the driver
+ */
+struct light_caps_t {
+    uint32_t flags;             // LCAP_* bits
+    uint32_t value_max;         // max brightness value
+    uint8_t resolution;         // bits per brightness value
+    uint8_t engines;            // fade engines driver could be switched to, bit per fade_engine_t, 0 - no choice
+    uint16_t fade_step;         // ms, min interval between fade steps, 0 - no fades
+};
+
+// 24 bit color pixel
+struct rgb8_t {
+    uint8_t r, g, b;
+};
 
 struct light_state_t {
     lightsource_t ltype;
@@ -56,5 +90,23 @@ struct light_state_t {
     float power;
     float power_max;
     bool active_ll;             // active logic level
+    uint32_t fade_to;           // target value of a fade in progress, same as value if not fading
+    uint32_t fade_eta;          // ms until fade end, 0 if not fading
+    fade_mode_t fade_mode;      // default fade duration mode
+    int32_t fade_rate;          // ms for a full-range fade in fade_mode_t::rate mode
+    light_caps_t caps;          // capabilities descriptor
 };
 
+/**
+ * @brief aggregated state of a group of lights
+ * brightness values are on group's own scale
+ */
+struct group_state_t {
+    uint16_t members;           // lights in a group
+    uint16_t on;                // lights with non-zero brightness
+    int32_t brtscale;           // scale for brightness values
+    uint32_t value_scaled;      // average brightness
+    uint32_t value_min;         // min brightness
+    uint32_t value_max;         // max brightness
+    float power;                // current power of all lights, W
+};
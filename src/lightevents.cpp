@@ -36,10 +36,11 @@ extern "C" {
 #include "esp_system.h"
 }   //extern "C"
 
+#include <algorithm>
+
 
 static const char* TAG = "light_evt";
 
-#define LOOP_LEVT_Q_SIZE        32              // events loop queue size
 #define LOOP_LEVT_T_PRIORITY    2               // task priority is a bit higher that arduino's loop()
 #define LOOP_LEVT_T_STACK_SIZE  4096            // task stack size
 
@@ -48,6 +49,7 @@ static const char* TAG = "light_evt";
 ESP_EVENT_DEFINE_BASE(LCMD_EVENTS);
 ESP_EVENT_DEFINE_BASE(LSTATE_EVENTS);
 ESP_EVENT_DEFINE_BASE(LSERVICE_EVENTS);
+ESP_EVENT_DEFINE_BASE(LSENSOR_EVENTS);
 ESP_EVENT_DEFINE_BASE(RCMD_EVENTS);
 ESP_EVENT_DEFINE_BASE(RSTATE_EVENTS);
 ESP_EVENT_DEFINE_BASE(RSERVICE_EVENTS);
@@ -57,6 +59,37 @@ static esp_event_loop_handle_t loop_levt_h = nullptr;
 
 
 // Implementations
+AddrMatcher::AddrMatcher(uint16_t dst, light_addr_t const &a){
+    switch (a.type){
+        case addr_type_t::range :
+            lo = a.first;
+            hi = a.last;
+            break;
+        case addr_type_t::mask : {
+            // drop bits past the id space
+            uint64_t m = a.mask;
+            if (ID_ANY - a.first < 63)
+                m &= (1ULL << (ID_ANY - a.first + 1)) - 1;
+            if (!m)
+                break;
+            // trim window to the bits set
+            lo = a.first + __builtin_ctzll(m);
+            hi = a.first + 63 - __builtin_clzll(m);
+            mask = m >> (lo - a.first);
+            if (lo == hi)
+                mask = 0;
+            break;
+        }
+        default :
+            if (dst == ID_ANY){
+                lo = 0;
+                hi = ID_ANY;
+            } else
+                lo = hi = dst;
+    }
+}
+
+
 namespace lightmgr {
 
 
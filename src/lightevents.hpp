@@ -32,6 +32,7 @@ extern "C" {
 }   //extern "C"
 
 #include "light_types.hpp"
+#include "easing.hpp"
 #include <bitset>
 
 // Event Base declarations
@@ -39,6 +40,7 @@ extern "C" {
 ESP_EVENT_DECLARE_BASE(LCMD_EVENTS);        // declaration of the local Light Command events base
 ESP_EVENT_DECLARE_BASE(LSTATE_EVENTS);      // declaration of the local Light State events base
 ESP_EVENT_DECLARE_BASE(LSERVICE_EVENTS);    // declaration of the local Light Service events base
+ESP_EVENT_DECLARE_BASE(LSENSOR_EVENTS);     // declaration of the local Sensor events base, event id is sensor's id
 // remote events
 ESP_EVENT_DECLARE_BASE(RCMD_EVENTS);        // declaration of the remote LightCommand events base
 ESP_EVENT_DECLARE_BASE(RSTATE_EVENTS);      // declaration of the remote LightState events base
@@ -50,6 +52,17 @@ ESP_EVENT_DECLARE_BASE(RSERVICE_EVENTS);    // declaration of the remote Light S
 #define GROUP_ANY       ESP_EVENT_ANY_ID    // ESP_EVENT_ANY_ID     -1
 #define NO_OVERRIDE     -1                  // Use light object's own setting
 
+/*
+ * events loop queue size
+ * state updates made by a command are posted from the loop's task with no wait, so a group command
+ * delivered to more Eclo subscribers than that loses the stateUpdate's of the rest, use EcloGroup for larger groups
+ */
+#define LOOP_LEVT_Q_SIZE        32
+
+#define INVENTORY_PAGE_SIZE     16          // items per inventory reply
+#define INVENTORY_DESCR_LEN     16          // description length in inventory item, including null
+#define INVENTORY_GROUPS        4           // group ids listed per inventory item
+
 
 // group permissions
 #define GRP_BIT_R     0
@@ -77,17 +90,28 @@ enum class light_event_id_t:uint8_t {
     goDecr,
     goStep,
     goStepScaled,
+    fadeStop,           // stop fade in progress, hold current level
+    fadePause,
+    fadeResume,
+    goRetarget,         // fade to a new value in the time left for current fade
+    rampUp,             // start continuous ramp, rate is passed as a step per second
+    rampDown,
+    rampStop,
     lce_end,            // end marker
     // Light State Events
     lse_start,
     stateReport,
     stateUpdate,
+    grpReport,          // group state report, reply to getState
+    grpUpdate,          // group state after a group command
     lse_end,
     // Service events
     se_start,
     echoRq,             // echo request
-    echoRpl,            // echo reply
+    echoRpl,            // echo reply, a reply to a multi-recipient request lists responders as an id mask
     getState,           // Get generic status info
+    inventoryRq,        // inventory listing request, 'value' is the id to start listing from, requests past ID_ANY are dropped
+    inventoryRpl,       // inventory listing page
     se_end
 };
 
@@ -101,6 +125,50 @@ struct local_peers_id_t {
     uint16_t dst;
 };
 
+/**
+ * @brief service event recipients addressing
+ */
+enum class addr_type_t:uint8_t {
+    id,                 // single id in local_peers_id_t::dst, ID_ANY for broadcast
+    range,              // ids from 'first' to 'last', inclusive
+    mask                // ids 'first' + n for each bit n set in 'mask'
+};
+
+/**
+ * @brief a set of recipient ids
+ */
+struct light_addr_t {
+    addr_type_t type = addr_type_t::id;
+    uint16_t first = 0;
+    uint16_t last = 0;
+    uint64_t mask = 0;
+};
+
+/**
+ * @brief precompiled address matcher
+ * any addressing is reduced to an id window and an optional bitmask,
+ * so matching an id takes a couple of compares and recipients sorted by id
+ * need to be scanned within the window only
+ */
+struct AddrMatcher {
+    uint16_t lo = 1;            // empty window by default
+    uint16_t hi = 0;
+    uint64_t mask = 0;          // bit per id starting from 'lo', 0 - any id in the window
+
+    /**
+     * @brief compile matcher for event's address
+     *
+     * @param dst - destination id, used for addr_type_t::id
+     * @param a - address set
+     */
+    AddrMatcher(uint16_t dst, light_addr_t const &a);
+
+    bool operator()(uint16_t id) const { return id >= lo && id <= hi && (!mask || (mask >> (id - lo) & 1)); };
+
+    // matches more than one id
+    bool multi() const { return lo < hi; };
+};
+
 /**
  * @brief Local service event data structure
  * a generic data carrier for service events
@@ -109,6 +177,7 @@ struct local_srvc_evt {
     light_event_id_t event;
     local_peers_id_t id;
     uint32_t value;         // abstract data field
+    light_addr_t addr;      // recipients, default is id.dst
 };
 
 
@@ -125,6 +194,8 @@ struct local_cmd_evt {
     int32_t step = NO_OVERRIDE;
     int32_t scale = NO_OVERRIDE;
     int32_t fade_duration = NO_OVERRIDE;
+    easing::ease_t ease = easing::ease_t::use_default;     // easing for fades started by the command
+    easing::bezier_t bezier = {0, 0, 255, 255};             // control points for easing::ease_t::bezier
 };
 
 
@@ -134,6 +205,58 @@ struct local_state_evt {
     light_state_t state;
 };
 
+/**
+ * @brief Local group state event data
+ * posted by EcloGroup to group's gid, src id is ID_ANONYMOUS
+ */
+struct local_grpstate_evt {
+    light_event_id_t event;
+    local_peers_id_t id;
+    group_state_t state;
+};
+
+/**
+ * @brief sensor kinds
+ */
+enum class sensor_t:uint8_t {
+    generic = 0,
+    occupancy,          // presence detector, value != 0 - occupied
+    lux                 // illuminance, lx
+};
+
+/**
+ * @brief Local sensor reading event data
+ * posted to LSENSOR_EVENTS with sensor's id as an event id
+ */
+struct local_sensor_evt {
+    sensor_t type;
+    int32_t value;
+};
+
+/**
+ * @brief inventory item, compact description of a local light
+ */
+struct inventory_item_t {
+    uint16_t id;
+    lightsource_t ltype;
+    uint8_t ngroups;                            // number of groups light is a member of, might be more than listed
+    char descr[INVENTORY_DESCR_LEN];            // truncated mnemonic name
+    uint16_t groups[INVENTORY_GROUPS];          // group ids, except own private group
+    light_caps_t caps;                          // capabilities descriptor
+};
+
+/**
+ * @brief Local inventory reply event data
+ * one page of inventory listing, posted to the group request was posted to
+ */
+struct local_inventory_evt {
+    light_event_id_t event;
+    local_peers_id_t id;
+    uint16_t next;                              // id to request next page from, 0 - this is the last page
+    uint8_t count;                              // items in this page
+    inventory_item_t items[INVENTORY_PAGE_SIZE];
+};
+
 /**
  * @brief event loop subscription
  * describe event subscription for an object
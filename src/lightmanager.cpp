@@ -25,7 +25,10 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 */
 
 #include "lightmanager.hpp"
+#include "freertos/task.h"
+#include "light_trace.hpp"
 #include <string.h>
+#include <algorithm>
 
 // LOGGING
 #ifdef ARDUINO
@@ -36,6 +39,12 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 
 static const char* TAG = "light_mgr";
 
+#define EVT_POST_TIMEOUT        100             // ms
+#define GROUP_LOOKUP_SIZE       4               // distinct member configs with shared curve lookups per group command
+
+// event loop task, captured on first event handled
+static TaskHandle_t loop_task = nullptr;
+
 using namespace lightmgr;
 
 // Classes implementation
@@ -49,6 +58,7 @@ Eclo::Eclo(GenericLight *l, uint16_t id, const char *_descr) : myid(id) {
     light.reset(std::move(l));                              // relocate GenericLight object
 
     grp_subscribe(myid, grp_perms_t::rw);                   // subscribe to local private group matching myid (default one)
+    EcloRegistry::getInstance()->add(this);
 
     /*
      * Attach to onChange() light object handler
@@ -56,21 +66,34 @@ Eclo::Eclo(GenericLight *l, uint16_t id, const char *_descr) : myid(id) {
      * to all registered groups with WRITE permission
      */
     light->onChangeAttach([this](){
-        for (auto i : subscr){
-            if (i.base != LSTATE_EVENTS || !i.grpmode.test(GRP_BIT_W))     // skip non-writable groups
-                continue;
-
-            evt_state_post(light_event_id_t::stateUpdate, i.gid, ID_ANONYMOUS);
+        // muted is set by a group from the event loop, changes could be reported from fader tasks
+        LightTicker::getInstance()->lock();
+        EcloGroup *mg = muted;
+        for (auto &g : groups){
+            if (g.counted && g.group != mg)
+                g.group->member_update(g, light.get());
         }
+        // muting group posts it's own report first, then the members' updates to their other groups
+        if (mg)
+            muted_change = true;
+        LightTicker::getInstance()->unlock();
+
+        if (!mg)
+            state_update_post();
     });
 }
 
 Eclo::~Eclo(){
+    while (groups.size())
+        groups.head().group->remove(this);
+    EcloRegistry::getInstance()->remove(this);
     unsubscribe();
 }
 
 void Eclo::event_hndlr(void* handler_args, esp_event_base_t base, int32_t gid, void* event_data){
     ESP_LOGD(TAG, "eclo event handling %s:%d", base, gid);
+    if (!loop_task)
+        loop_task = xTaskGetCurrentTaskHandle();
     reinterpret_cast<Eclo*>(handler_args)->event_picker(base, gid, event_data);
 }
 
@@ -86,7 +109,7 @@ bool Eclo::evt_subscribe(esp_event_base_t base, int32_t gid, grp_perms_t perm){
 
     esp_event_handler_instance_t evt_instance;
 
-    esp_err_t err = esp_event_handler_instance_register_with(*get_light_evts_loop(), base, myid, Eclo::event_hndlr, this, &evt_instance);
+    esp_err_t err = esp_event_handler_instance_register_with(*get_light_evts_loop(), base, gid, Eclo::event_hndlr, this, &evt_instance);
     if (err != ESP_OK && err != ESP_ERR_INVALID_STATE){
     	ESP_LOGW(TAG, "%s: event loop subscribe failed for %s:%d", descr.get(), base, gid);
         return false;
@@ -104,6 +127,7 @@ bool Eclo::evt_subscribe(esp_event_base_t base, int32_t gid, grp_perms_t perm){
 }
 
 void Eclo::event_picker(esp_event_base_t base, int32_t gid, void* event_data){
+    LTRACE_SCOPE("Eclo::event_picker");
     ESP_LOGI(TAG, "%s event picker %s:%d", descr.get(), base, gid);
 
     if (base == LCMD_EVENTS){
@@ -123,20 +147,14 @@ void Eclo::event_picker(esp_event_base_t base, int32_t gid, void* event_data){
         return;     // ?? не выходить а сбрасывать обработку на внешний коллбек
     }
 
+    // service events from explicit evt_subscribe() subscriptions, group ones are dispatched by EcloRegistry
     if (base == LSERVICE_EVENTS){
         local_srvc_evt *e = reinterpret_cast<local_srvc_evt*>(event_data);
 
-        if (e->id.dst != myid || e->id.dst != ID_ANY)       // ignore messages not to me or not broadcast
+        if (!AddrMatcher(e->id.dst, e->addr)(myid))          // ignore messages not addressed to me
             return;
 
-        switch(e->event){
-            case light_event_id_t::echoRq :                                                // do echo reply
-                return evt_pong_post(gid, e->id.src);
-            case light_event_id_t::getState :
-                return evt_state_post(light_event_id_t::stateReport, gid, e->id.src);      // status report
-            default :
-                return;
-        }
+        return srvc_run(gid, e);
     }
 
     // TODO: remote/group events logic, etc...
@@ -160,31 +178,56 @@ void Eclo::unsubscribe(){
     }
 }
 
-void Eclo::evt_cmd_runner(esp_event_base_t base, int32_t rcpt, local_cmd_evt const *cmd){
+void Eclo::evt_cmd_runner(esp_event_base_t /*base*/, int32_t /*rcpt*/, local_cmd_evt const *cmd){
+    LTRACE_SCOPE("Eclo::evt_cmd_runner");
 
+    // easing override goes with the command's fade only, light's own setting is not touched
+    if (cmd->ease != easing::ease_t::use_default){
+        easing::Easing e(cmd->ease, cmd->bezier);
+        return cmd_dispatch(cmd, &e);
+    }
+
+    cmd_dispatch(cmd, nullptr);
+}
+
+void Eclo::cmd_dispatch(local_cmd_evt const *cmd, const easing::Easing *e){
     switch(cmd->event){
         case light_event_id_t::goValue :
-            return light->goValue(cmd->value, cmd->fade_duration);
+            return light->goValue(cmd->value, cmd->fade_duration, e);
         case light_event_id_t::goValueScaled :
-            return light->goValueScaled(cmd->value, cmd->scale, cmd->fade_duration);
+            return light->goValueScaled(cmd->value, cmd->scale, cmd->fade_duration, e);
         case light_event_id_t::goMax :
-            return light->goMax(cmd->fade_duration);
+            return light->goMax(cmd->fade_duration, e);
         case light_event_id_t::goMin :
-            return light->goMin(cmd->fade_duration);
+            return light->goMin(cmd->fade_duration, e);
         case light_event_id_t::goOn :
-            return light->goOn(cmd->fade_duration);
+            return light->goOn(cmd->fade_duration, e);
         case light_event_id_t::goOff :
-            return light->goOff(cmd->fade_duration);
+            return light->goOff(cmd->fade_duration, e);
         case light_event_id_t::goToggle :
-            return light->goToggle(cmd->fade_duration);
+            return light->goToggle(cmd->fade_duration, e);
         case light_event_id_t::goIncr :
-            return light->goIncr(cmd->fade_duration);
+            return light->goIncr(cmd->fade_duration, e);
         case light_event_id_t::goDecr :
-            return light->goDecr(cmd->fade_duration);
+            return light->goDecr(cmd->fade_duration, e);
         case light_event_id_t::goStep :
-            return light->goStep(cmd->step, cmd->fade_duration);
+            return light->goStep(cmd->step, cmd->fade_duration, e);
         case light_event_id_t::goStepScaled :
-            return light->goStepScaled(cmd->step, cmd->scale, cmd->fade_duration);
+            return light->goStepScaled(cmd->step, cmd->scale, cmd->fade_duration, e);
+        case light_event_id_t::fadeStop :
+            return light->fadeStop();
+        case light_event_id_t::fadePause :
+            return light->fadePause();
+        case light_event_id_t::fadeResume :
+            return light->fadeResume();
+        case light_event_id_t::goRetarget :
+            return light->goRetarget(cmd->value, e);
+        case light_event_id_t::rampUp :
+            return light->rampStart(true, cmd->step, cmd->scale);
+        case light_event_id_t::rampDown :
+            return light->rampStart(false, cmd->step, cmd->scale);
+        case light_event_id_t::rampStop :
+            return light->rampStop();
 
         default :
             break;
@@ -201,17 +244,88 @@ void Eclo::evt_state_post(light_event_id_t evnt, int32_t groupid, uint16_t dst){
         light->getState()
     };
 
-    ESP_ERROR_CHECK(esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, groupid ? groupid : myid, &st, sizeof(local_state_evt), 100 / portTICK_PERIOD_MS));
+    /*
+     * state changes made by commands are posted from the loop's own task,
+     * blocking there on a full queue would stall the loop for nothing - nobody
+     * could drain the queue until we return, so do not wait in this case.
+     * Fade end and progress reports come under LightTicker's lock, the loop
+     * might be waiting for it, so those do not wait either
+     */
+    bool nowait = xTaskGetCurrentTaskHandle() == loop_task || LightTicker::getInstance()->holding();
+    TickType_t timeout = nowait ? 0 : EVT_POST_TIMEOUT / portTICK_PERIOD_MS;
+    esp_err_t err = esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, groupid ? groupid : myid, &st, sizeof(local_state_evt), timeout);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "%s: state post to group %d failed: %s", descr.get(), groupid, esp_err_to_name(err));
+}
+
+void Eclo::state_update_post(EcloGroup const *skip){
+    for (auto i : subscr){
+        if (i.base != LCMD_EVENTS || !i.grpmode.test(GRP_BIT_W))       // skip non-writable groups, one subscription per group
+            continue;
+        if (skip && i.gid == skip->gid)
+            continue;
+
+        evt_state_post(light_event_id_t::stateUpdate, i.gid, ID_ANONYMOUS);
+    }
 }
 
 void Eclo::evt_pong_post(int32_t groupid, uint16_t dst){
     local_srvc_evt msg = {
         light_event_id_t::echoRpl,  // event type
         { myid, dst },                // msg addtess id
-        0                           // custom value
+        0,                          // custom value
+        light_addr_t()              // recipient is id.dst
     };
 
-    ESP_ERROR_CHECK(esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, groupid, &msg, sizeof(local_srvc_evt), 100 / portTICK_PERIOD_MS));
+    // replies are posted from the loop's task, same as state reports
+    TickType_t timeout = xTaskGetCurrentTaskHandle() == loop_task ? 0 : EVT_POST_TIMEOUT / portTICK_PERIOD_MS;
+    esp_err_t err = esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, groupid, &msg, sizeof(local_srvc_evt), timeout);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "%s: echo reply to group %d failed: %s", descr.get(), groupid, esp_err_to_name(err));
+}
+
+void Eclo::srvc_run(int32_t gid, local_srvc_evt const *e){
+    switch(e->event){
+        case light_event_id_t::echoRq :                                                // do echo reply
+            return evt_pong_post(gid, e->id.src);
+        case light_event_id_t::getState :
+            return evt_state_post(light_event_id_t::stateReport, gid, e->id.src);      // status report
+        default :
+            return;
+    }
+}
+
+void Eclo::inventory(inventory_item_t &item) const {
+    item.id = myid;
+    item.ltype = light->getLType();
+    item.caps = light->getCaps();
+    strncpy(item.descr, descr.get(), INVENTORY_DESCR_LEN - 1);
+    item.descr[INVENTORY_DESCR_LEN - 1] = 0;
+
+    item.ngroups = 0;
+    auto list = [&item](int32_t gid){
+        if (item.ngroups < INVENTORY_GROUPS)
+            item.groups[item.ngroups] = gid;
+        ++item.ngroups;
+    };
+
+    for (auto const &i : subscr){
+        if (i.base == LCMD_EVENTS && i.gid != myid)
+            list(i.gid);
+    }
+    for (auto const &g : groups)
+        list(g.group->gid);
+
+    for (uint8_t i = item.ngroups; i < INVENTORY_GROUPS; ++i)
+        item.groups[i] = 0;
+}
+
+bool Eclo::cmd_subscribed(int32_t gid) const {
+    for (auto const &i : subscr){
+        if (i.base == LCMD_EVENTS && i.gid == gid)
+            return true;
+    }
+    return false;
 }
 
 void Eclo::eventcbAttach(event_loop_cb_t f){
@@ -230,8 +344,531 @@ Evt_subscription const *Eclo::subscr_by_gid(uint16_t gid) const {
     return nullptr;
 }
 
+Grp_membership *Eclo::membership(EcloGroup const *g){
+    for (auto &i : groups){
+        if (i.group == g)
+            return &i;
+    }
+    return nullptr;
+}
+
 bool Eclo::grp_subscribe(int32_t gid, grp_perms_t perm){
-    // not nice
-    evt_subscribe(LCMD_EVENTS, gid, perm);                  // subscribe to local gid command events
-    return evt_subscribe(LSERVICE_EVENTS, gid, perm);              // subscribe to local gid service events
+    return evt_subscribe(LCMD_EVENTS, gid, perm);           // subscribe to local gid command events, service events are dispatched by EcloRegistry
+}
+
+
+// EcloRegistry implementation
+EcloRegistry::EcloRegistry(){
+    subscribe();
+}
+
+bool EcloRegistry::subscribe(){
+    if (srvc_instance)
+        return true;
+
+    if (esp_event_handler_instance_register_with(*get_light_evts_loop(), LSERVICE_EVENTS, ESP_EVENT_ANY_ID, EcloRegistry::event_hndlr, this, &srvc_instance) == ESP_OK)
+        return true;
+
+    srvc_instance = nullptr;
+    ESP_LOGW(TAG, "registry: event loop subscribe failed for %s", LSERVICE_EVENTS);
+    return false;
+}
+
+void EcloRegistry::add(Eclo *e){
+    LightTicker::getInstance()->lock();
+    // loop might have been unavailable on construction, retry with each new object
+    subscribe();
+    int i = 0;
+    for (auto u : units){
+        if (u->myid >= e->myid){
+            if (u->myid == e->myid)
+                ESP_LOGW(TAG, "registry: duplicate id %u", e->myid);
+            break;
+        }
+        ++i;
+    }
+    units.add(i, e);
+    LightTicker::getInstance()->unlock();
+}
+
+void EcloRegistry::remove(Eclo *e){
+    LightTicker::getInstance()->lock();
+    int i = 0;
+    for (auto u : units){
+        if (u == e){
+            units.remove(i);
+            break;
+        }
+        ++i;
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+Eclo *EcloRegistry::get(uint16_t id) const {
+    for (auto u : units){
+        if (u->myid >= id)
+            return u->myid == id ? u : nullptr;
+    }
+    return nullptr;
+}
+
+void EcloRegistry::event_hndlr(void* handler_args, esp_event_base_t base, int32_t gid, void* event_data){
+    ESP_LOGD(TAG, "registry event handling %s:%d", base, gid);
+    if (!loop_task)
+        loop_task = xTaskGetCurrentTaskHandle();
+    reinterpret_cast<EcloRegistry*>(handler_args)->srvc_dispatch(gid, reinterpret_cast<local_srvc_evt*>(event_data));
+}
+
+void EcloRegistry::srvc_dispatch(int32_t gid, local_srvc_evt const *e){
+    LTRACE_SCOPE("EcloRegistry::srvc_dispatch");
+    AddrMatcher match(e->id.dst, e->addr);
+    if (e->event == light_event_id_t::inventoryRq)
+        return evt_inventory_post(gid, e);
+
+    bool aggregate = e->event == light_event_id_t::echoRq && match.multi();
+    uint16_t base = 0;
+    uint64_t pong = 0;
+
+    LightTicker::getInstance()->lock();
+    for (auto u : units){
+        if (u->myid < match.lo)
+            continue;
+        if (u->myid > match.hi)
+            break;
+        if (!match(u->myid) || (gid != GROUP_SELF && !u->cmd_subscribed(gid)))
+            continue;
+
+        if (!aggregate){
+            u->srvc_run(gid, e);
+            continue;
+        }
+
+        // responders are collected into id masks
+        if (pong && u->myid - base > 63){
+            evt_pong_post(gid, e->id.src, base, pong);
+            pong = 0;
+        }
+        if (!pong)
+            base = u->myid;
+        pong |= 1ULL << (u->myid - base);
+    }
+    LightTicker::getInstance()->unlock();
+
+    if (pong)
+        evt_pong_post(gid, e->id.src, base, pong);
+}
+
+void EcloRegistry::evt_pong_post(int32_t gid, uint16_t dst, uint16_t base, uint64_t mask){
+    local_srvc_evt msg = {
+        light_event_id_t::echoRpl,
+        { ID_ANONYMOUS, dst },
+        0,
+        { addr_type_t::mask, base, static_cast<uint16_t>(base + 63 - __builtin_clzll(mask)), mask }
+    };
+
+    TickType_t timeout = xTaskGetCurrentTaskHandle() == loop_task ? 0 : EVT_POST_TIMEOUT / portTICK_PERIOD_MS;
+    esp_err_t err = esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, gid, &msg, sizeof(local_srvc_evt), timeout);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "registry: echo reply to group %d failed: %s", gid, esp_err_to_name(err));
+}
+
+
+uint16_t EcloRegistry::fill(inventory_item_t *items, uint8_t size, uint8_t &count, uint16_t from, AddrMatcher const &match, int32_t gid) const {
+    count = 0;
+    if (from < match.lo)
+        from = match.lo;
+
+    LightTicker::getInstance()->lock();
+    uint16_t next = 0;
+    for (auto u : units){
+        if (u->myid < from)
+            continue;
+        if (u->myid > match.hi)
+            break;
+        if (!match(u->myid) || (gid != GROUP_SELF && !u->cmd_subscribed(gid)))
+            continue;
+
+        if (count == size){
+            next = u->myid;
+            break;
+        }
+        u->inventory(items[count++]);
+    }
+    LightTicker::getInstance()->unlock();
+    return next;
+}
+
+uint16_t EcloRegistry::getInventory(inventory_item_t *items, uint8_t size, uint8_t &count, uint16_t from) const {
+    light_addr_t any;
+    return fill(items, size, count, from, AddrMatcher(ID_ANY, any));
+}
+
+void EcloRegistry::evt_inventory_post(int32_t gid, local_srvc_evt const *e){
+    if (e->value > ID_ANY){
+        ESP_LOGW(TAG, "registry: inventory request from id %u is out of id range", e->value);
+        return;
+    }
+
+    AddrMatcher match(e->id.dst, e->addr);
+    std::unique_ptr<local_inventory_evt> page(new local_inventory_evt);
+    page->event = light_event_id_t::inventoryRpl;
+    page->id = { ID_ANONYMOUS, e->id.src };
+    uint16_t from = e->value;
+
+    TickType_t timeout = xTaskGetCurrentTaskHandle() == loop_task ? 0 : EVT_POST_TIMEOUT / portTICK_PERIOD_MS;
+    do {
+        page->next = fill(page->items, INVENTORY_PAGE_SIZE, page->count, from, match, gid);
+        esp_err_t err = esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, gid, page.get(), sizeof(local_inventory_evt), timeout);
+        if (err != ESP_OK){
+            // client continues from the last page received
+            ESP_LOGW(TAG, "registry: inventory page from id %u to group %d failed: %s", from, gid, esp_err_to_name(err));
+            return;
+        }
+        from = page->next;
+    } while (from);
+}
+
+
+// EcloGroup implementation
+EcloGroup::EcloGroup(int32_t id) : reporter(this), gid(id) {
+    auto loop = get_light_evts_loop();
+    if (esp_event_handler_instance_register_with(*loop, LCMD_EVENTS, gid, EcloGroup::event_hndlr, this, &cmd_instance) != ESP_OK)
+        ESP_LOGW(TAG, "group %d: event loop subscribe failed for %s", gid, LCMD_EVENTS);
+    if (esp_event_handler_instance_register_with(*loop, LSERVICE_EVENTS, gid, EcloGroup::event_hndlr, this, &srvc_instance) != ESP_OK)
+        ESP_LOGW(TAG, "group %d: event loop subscribe failed for %s", gid, LSERVICE_EVENTS);
+}
+
+EcloGroup::~EcloGroup(){
+    auto loop = get_light_evts_loop();
+    if (cmd_instance)
+        esp_event_handler_instance_unregister_with(*loop, LCMD_EVENTS, gid, cmd_instance);
+    if (srvc_instance)
+        esp_event_handler_instance_unregister_with(*loop, LSERVICE_EVENTS, gid, srvc_instance);
+
+    while (members.size())
+        remove(members.head().eclo);
+
+    LightTicker::getInstance()->lock();
+    LightTicker::getInstance()->detach(&reporter);
+    LightTicker::getInstance()->unlock();
+}
+
+bool EcloGroup::add(Eclo *e, grp_perms_t perm){
+    if (!e)
+        return false;
+
+    for (auto const &m : members){
+        if (m.eclo == e){
+            ESP_LOGW(TAG, "group %d: %s is a member already", gid, e->descr.get());
+            return false;
+        }
+    }
+
+    std::bitset<GRP_BIT_LEN> mode(static_cast<uint8_t>(perm));
+    LightTicker::getInstance()->lock();
+    members.add({e, mode, false});
+    e->groups.add({this, mode.test(GRP_BIT_W), false, 0, 0});
+    rebuild();
+    LightTicker::getInstance()->unlock();
+    ESP_LOGI(TAG, "group %d: added %s", gid, e->descr.get());
+    return true;
+}
+
+bool EcloGroup::remove(Eclo *e){
+    LightTicker::getInstance()->lock();
+    for (int i = 0; i != e->groups.size(); ++i){
+        if (e->groups.get(i).group == this){
+            e->groups.remove(i);
+            break;
+        }
+    }
+
+    int i = 0;
+    bool found = false;
+    for (auto const &m : members){
+        if (m.eclo == e){
+            members.remove(i);
+            found = true;
+            break;
+        }
+        ++i;
+    }
+
+    if (found)
+        rebuild();
+    LightTicker::getInstance()->unlock();
+    return found;
+}
+
+void EcloGroup::event_hndlr(void* handler_args, esp_event_base_t base, int32_t gid, void* event_data){
+    ESP_LOGD(TAG, "group event handling %s:%d", base, gid);
+    if (!loop_task)
+        loop_task = xTaskGetCurrentTaskHandle();
+
+    EcloGroup *g = reinterpret_cast<EcloGroup*>(handler_args);
+    if (base == LCMD_EVENTS)
+        return g->cmd_apply(reinterpret_cast<local_cmd_evt*>(event_data));
+
+    if (base == LSERVICE_EVENTS){
+        local_srvc_evt *e = reinterpret_cast<local_srvc_evt*>(event_data);
+        if (e->event == light_event_id_t::getState)
+            g->evt_state_post(light_event_id_t::grpReport, e->id.src);
+    }
+}
+
+void EcloGroup::cmd_apply(local_cmd_evt const *cmd){
+    LTRACE_SCOPE("EcloGroup::cmd_apply");
+    if (cmd->event <= light_event_id_t::lce_start || cmd->event >= light_event_id_t::lce_end)
+        return;
+
+    // members report their changes with the group state
+    LightTicker::getInstance()->lock();
+    for (auto &m : members)
+        m.eclo->muted = this;
+    LightTicker::getInstance()->unlock();
+
+    if (!value_apply(cmd)){
+        for (auto &m : members){
+            if (m.grpmode.test(GRP_BIT_R))
+                m.eclo->evt_cmd_runner(LCMD_EVENTS, gid, cmd);
+        }
+    }
+
+    // changes made by the command are counted in one pass and posted right away, no need for a deferred report
+    LightTicker::getInstance()->lock();
+    for (auto &m : members){
+        m.eclo->muted = nullptr;
+        Grp_membership *gm = m.eclo->membership(this);
+        if (gm && gm->counted)
+            member_count(*gm, m.eclo->light.get());
+    }
+
+    if (report_pending){
+        LightTicker::getInstance()->detach(&reporter);
+        report_pending = false;
+    }
+    LightTicker::getInstance()->unlock();
+
+    evt_state_post(light_event_id_t::grpUpdate);
+
+    // members changed by the command still report to their own and other groups,
+    // muted_change is not set by anyone else once members are unmuted
+    for (auto &m : members){
+        if (!m.eclo->muted_change)
+            continue;
+        m.eclo->muted_change = false;
+        m.eclo->state_update_post(this);
+    }
+}
+
+bool EcloGroup::value_apply(local_cmd_evt const *cmd){
+    // goValue() semantics is used for scale 0
+    uint32_t value = cmd->value;
+    int32_t scale = 0;
+    bool max = false;
+    switch (cmd->event){
+        case light_event_id_t::goValue :
+            break;
+        case light_event_id_t::goValueScaled :
+            scale = cmd->scale > 0 ? cmd->scale : -1;       // negative for member's own scale
+            break;
+        case light_event_id_t::goMax :
+        case light_event_id_t::goOn :
+            max = true;
+            break;
+        case light_event_id_t::goMin :
+            value = 1;
+            break;
+        case light_event_id_t::goOff :
+            value = 0;
+            break;
+        default :
+            return false;
+    }
+
+    // luma curve lookups are shared by members with the same curve, max value and scale
+    struct lookup_t {
+        luma::curve luma;
+        uint32_t max;
+        int32_t scale;
+        uint32_t value;
+    } cache[GROUP_LOOKUP_SIZE];
+    size_t cached = 0;
+    // easing override is built once for all members
+    std::unique_ptr<easing::Easing> ease;
+    if (cmd->ease != easing::ease_t::use_default)
+        ease.reset(new easing::Easing(cmd->ease, cmd->bezier));
+
+    for (auto &m : members){
+        m.staged = false;
+        if (!m.grpmode.test(GRP_BIT_R))
+            continue;
+
+        GenericLight *l = m.eclo->light.get();
+        uint32_t lmax = l->getMaxValue();
+        int32_t lscale = scale < 0 ? l->getScale() : scale;
+
+        uint32_t v;
+        size_t i = 0;
+        while (i != cached && !(cache[i].luma == l->getCurve() && cache[i].max == lmax && cache[i].scale == lscale))
+            ++i;
+
+        if (i != cached)
+            v = cache[i].value;
+        else {
+            if (max)
+                v = l->mapValue(lmax);
+            else
+                v = lscale ? l->mapValueScaled(value, lscale) : l->mapValue(value);
+
+            if (cached != GROUP_LOOKUP_SIZE)
+                cache[cached++] = {l->getCurve(), lmax, lscale, v};
+        }
+
+        int32_t duration = cmd->fade_duration < 0 ? l->fade_duration(v) : cmd->fade_duration;
+        if (duration || l->getLType() != lightsource_t::dimmable || !(l->getCaps().flags & LCAP_STAGED)){
+            l->goMapped(v, duration, ease.get());
+            continue;
+        }
+
+        // no fade, PWM duty is committed for all dimmable members at once
+        l->value_reset();
+        static_cast<DimmableLight*>(l)->stageValue(v);
+        m.staged = true;
+    }
+
+    for (auto &m : members){
+        if (m.staged)
+            static_cast<DimmableLight*>(m.eclo->light.get())->flush();
+    }
+
+    for (auto &m : members){
+        if (m.staged)
+            m.eclo->light->onChange();
+    }
+
+    return true;
+}
+
+void EcloGroup::member_update(Grp_membership &gm, GenericLight const *l){
+    LightTicker::getInstance()->lock();
+    if (member_count(gm, l) && report_period && !report_pending){
+        report_pending = true;
+        LightTicker::getInstance()->attach(&reporter, report_period);
+    }
+    LightTicker::getInstance()->unlock();
+}
+
+bool EcloGroup::member_count(Grp_membership &gm, GenericLight const *l){
+    uint32_t v = l->getValueScaled(brtscale);
+    bool lon = l->getValue();
+    float p = l->getCurrentPower();
+    if (v == gm.value && lon == gm.on && p == gm.power)
+        return false;
+
+    value_sum += v;
+    value_sum -= gm.value;
+    on += lon;
+    on -= gm.on;
+    power += p - gm.power;
+
+    if (extremes_valid){
+        if (v <= value_min)
+            value_min = v;
+        else if (gm.value == value_min)
+            extremes_valid = false;         // might have been the only one at min
+
+        if (v >= value_max)
+            value_max = v;
+        else if (gm.value == value_max)
+            extremes_valid = false;
+    }
+
+    gm.value = v;
+    gm.on = lon;
+    gm.power = p;
+    return true;
+}
+
+void EcloGroup::rebuild(){
+    counted = on = 0;
+    value_sum = 0;
+    power = 0;
+    extremes_valid = false;
+
+    for (auto &m : members){
+        Grp_membership *gm = m.eclo->membership(this);
+        if (!gm || !gm->counted)
+            continue;
+
+        GenericLight const *l = m.eclo->light.get();
+        gm->value = l->getValueScaled(brtscale);
+        gm->on = l->getValue();
+        gm->power = l->getCurrentPower();
+
+        ++counted;
+        on += gm->on;
+        value_sum += gm->value;
+        power += gm->power;
+    }
+}
+
+void EcloGroup::setScale(int32_t s){
+    if (s <= 0)
+        return;
+
+    LightTicker::getInstance()->lock();
+    brtscale = s;
+    rebuild();
+    LightTicker::getInstance()->unlock();
+}
+
+group_state_t EcloGroup::getState() const {
+    LightTicker::getInstance()->lock();
+    if (!extremes_valid){
+        value_min = counted ? UINT32_MAX : 0;
+        value_max = 0;
+        for (auto const &m : members){
+            Grp_membership const *gm = m.eclo->membership(this);
+            if (!gm || !gm->counted)
+                continue;
+
+            value_min = std::min(value_min, gm->value);
+            value_max = std::max(value_max, gm->value);
+        }
+        extremes_valid = true;
+    }
+
+    group_state_t st = {
+        counted,
+        on,
+        brtscale,
+        counted ? static_cast<uint32_t>(value_sum / counted) : 0,
+        value_min,
+        value_max,
+        power > 0 ? static_cast<float>(power) : 0       // drops float rounding residue
+    };
+    LightTicker::getInstance()->unlock();
+    return st;
+}
+
+uint32_t EcloGroup::Reporter::tick(int64_t /*now*/){
+    grp->report_pending = false;
+    grp->evt_state_post(light_event_id_t::grpUpdate);
+    return 0;
+}
+
+void EcloGroup::evt_state_post(light_event_id_t evnt, uint16_t dst){
+    local_grpstate_evt st = {
+        evnt,
+        { ID_ANONYMOUS, dst },      // src, dst id
+        getState()
+    };
+
+    // deferred reports are run by the ticker under it's lock, no waiting there, same as for Eclo::evt_state_post()
+    bool nowait = xTaskGetCurrentTaskHandle() == loop_task || LightTicker::getInstance()->holding();
+    TickType_t timeout = nowait ? 0 : EVT_POST_TIMEOUT / portTICK_PERIOD_MS;
+    esp_err_t err = esp_event_post_to( *get_light_evts_loop(), LSTATE_EVENTS, gid, &st, sizeof(local_grpstate_evt), timeout);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "group %d: state post failed: %s", gid, esp_err_to_name(err));
 }
@@ -30,10 +30,26 @@ GitHub: https://github.com/vortigont/ESP32-LightManager
 
 // fwd declare
 class Eclo;
+class EcloGroup;
 
 // event loop message callback type
 typedef std::function<void (Eclo* lo, esp_event_base_t base, int32_t evid, void* data)> event_loop_cb_t;
 
+#define GROUP_REPORT_PERIOD     100             // ms, min interval between group state posts on member changes
+
+/**
+ * @brief Eclo's membership in EcloGroup
+ * keeps member's contribution to aggregated group state,
+ * so that group state is updated incrementally on member changes
+ */
+struct Grp_membership {
+    EcloGroup *group;
+    bool counted;           // member has WRITE permission and is counted in group state
+    bool on;
+    uint32_t value;         // brightness, group's scale
+    float power;            // W
+};
+
 // Light objects
 
 /**
@@ -44,12 +60,17 @@ typedef std::function<void (Eclo* lo, esp_event_base_t base, int32_t evid, void*
  * 
  */
 class Eclo {
+friend class EcloGroup;
+friend class EcloRegistry;
 
     uint16_t main_group;                                    // primary event group to listen/publish event to
     std::shared_ptr<GenericLight> light;                    // Controlled light object
     std::unique_ptr<char[]> descr;                          // Mnemonic name for the instance
     LList<Evt_subscription> subscr;                         // list of event subscriptions
     event_loop_cb_t unknown_evnt_cb = nullptr;              // external callback for unknown events
+    LList<Grp_membership> groups;                           // EcloGroup's this object is a member of
+    EcloGroup *muted = nullptr;                             // group running a command, it reports the changes instead of this object, under the ticker lock
+    bool muted_change = false;                              // light changed while muted, stateUpdate is posted after the group's report
 
 //protected:
     /**
@@ -82,6 +103,9 @@ class Eclo {
      */
     void evt_cmd_runner(esp_event_base_t base, int32_t gid, local_cmd_evt const *cmd);
 
+    // run light's method for the command, fades use easing 'e' if not nullptr
+    void cmd_dispatch(local_cmd_evt const *cmd, const easing::Easing *e);
+
     /**
      * @brief post event message with light state
      * default is post to anonymous group
@@ -92,6 +116,13 @@ class Eclo {
      */
     void evt_state_post(light_event_id_t evnt = light_event_id_t::stateUpdate, int32_t groupid = GROUP_SELF, uint16_t dst = ID_ANONYMOUS);
 
+    /**
+     * @brief post stateUpdate to all groups with WRITE permission
+     *
+     * @param skip - group that has already reported the change, it's gid is skipped
+     */
+    void state_update_post(EcloGroup const *skip = nullptr);
+
     /**
      * @brief post an event message - reply to ping
      * 
@@ -101,8 +132,24 @@ class Eclo {
      */
     void evt_pong_post(int32_t groupid, uint16_t dst);
 
+    /**
+     * @brief process service event addressed to this object
+     *
+     * @param gid - group event was posted to, replies go there
+     * @param e - service event
+     */
+    void srvc_run(int32_t gid, local_srvc_evt const *e);
+
+    // subscribed to group commands
+    bool cmd_subscribed(int32_t gid) const;
+
+    // describe this object for inventory listing
+    void inventory(inventory_item_t &item) const;
+
     Evt_subscription const *subscr_by_gid(uint16_t gid) const;
 
+    Grp_membership *membership(EcloGroup const *g);
+
 
 public:
 
@@ -134,6 +181,7 @@ public:
 
     /**
      * @brief subscribe to event group
+     * LSERVICE_EVENTS for the group are dispatched by EcloRegistry, no separate handler is registered
      * 
      * @param gid - group id to subscribe to, might also be GROUP_BROADCAST or GROUP_SELF
      * @param perm - group permission, (R, W, RW). Controls handling of LCMD_EVENTS, LSTATE_EVENTS. LSERVICE_EVENTS are always processed in both ways
@@ -165,4 +213,262 @@ public:
 
 };
 
+/**
+ * @brief registry of local Eclo objects
+ * keeps all Eclo's sorted by id and dispatches service events to them with a single
+ * event loop handler. Recipients are picked with a precompiled address matcher scanning
+ * only the matching id window, so a request to a range or to all lights costs one dispatch.
+ * Echo requests with more than one recipient are answered with aggregated echoRpl events,
+ * one per up to 64 responders, listing those as an id mask.
+ * Inventory requests are answered with pages of compact light descriptions generated
+ * from the registry, no light objects are queried. Pages are posted until the listing
+ * is complete or loop queue is full, a client continues from the last page's 'next' id
+ */
+class EcloRegistry {
+
+    LList<Eclo*> units;                                 // sorted by id
+    esp_event_handler_instance_t srvc_instance = nullptr;
+
+    EcloRegistry();
+
+    /**
+     * @brief register service events handler, if not done yet
+     *
+     * @return true if handler is registered
+     */
+    bool subscribe();
+
+    static void event_hndlr(void* handler_args, esp_event_base_t base, int32_t gid, void* event_data);
+
+    /**
+     * @brief run service event for all matching objects
+     *
+     * @param gid - group event was posted to, GROUP_SELF addresses all objects, otherwise group subscribers only
+     * @param e - service event
+     */
+    void srvc_dispatch(int32_t gid, local_srvc_evt const *e);
+
+    /**
+     * @brief post aggregated echo reply
+     *
+     * @param gid - group to post to
+     * @param dst - recipient's id
+     * @param base - id of the first responder
+     * @param mask - responders, bit per id starting from 'base'
+     */
+    void evt_pong_post(int32_t gid, uint16_t dst, uint16_t base, uint64_t mask);
+
+    /**
+     * @brief post inventory pages for an inventory request
+     */
+    void evt_inventory_post(int32_t gid, local_srvc_evt const *e);
+
+    /**
+     * @brief fill inventory items for matching objects
+     *
+     * @param items - buffer to fill
+     * @param size - buffer size, items
+     * @param count - items filled
+     * @param from - lowest id to list
+     * @param match - address matcher
+     * @param gid - group to list members of, GROUP_SELF - all objects
+     * @return uint16_t - id to continue listing from, 0 if listing is complete
+     */
+    uint16_t fill(inventory_item_t *items, uint8_t size, uint8_t &count, uint16_t from, AddrMatcher const &match, int32_t gid = GROUP_SELF) const;
+
+public:
+    // this is a singleton
+    EcloRegistry(EcloRegistry const&) = delete;
+    void operator=(EcloRegistry const&) = delete;
+
+    /**
+     * obtain a pointer to singleton instance
+     */
+    static EcloRegistry *getInstance(){
+        static EcloRegistry instance;
+        return &instance;
+    }
+
+    /**
+     * @brief register Eclo object, called on Eclo construction
+     */
+    void add(Eclo *e);
+
+    /**
+     * @brief unregister Eclo object, called on Eclo destruction
+     */
+    void remove(Eclo *e);
+
+    /**
+     * @brief find Eclo object by id
+     *
+     * @return Eclo* - object or nullptr if not found
+     */
+    Eclo *get(uint16_t id) const;
+
+    /**
+     * @brief number of registered objects
+     */
+    int size() const { return units.size(); };
 
+    /**
+     * @brief get inventory of local lights
+     *
+     * @param items - buffer to fill
+     * @param size - buffer size, items
+     * @param count - items filled
+     * @param from - lowest id to list
+     * @return uint16_t - id to continue listing from, 0 if listing is complete
+     */
+    uint16_t getInventory(inventory_item_t *items, uint8_t size, uint8_t &count, uint16_t from = 0) const;
+};
+
+
+/**
+ * @brief ECLO Group - a group of Event Controlled Light Objects
+ * a group listens to it's gid on the event loop with one handler and applies
+ * commands to all of it's members in one pass, instead of having each member
+ * subscribed to the group and esp_event delivering a command copy to every one of them.
+ * Brightness commands are resolved once for members with the same luma curve,
+ * max value and scale, dimmable members are staged and flushed together when
+ * changed without a fade. On group commands the group posts one grpUpdate event with
+ * aggregated state first, members post their stateUpdate's to their other groups after it.
+ *
+ * Aggregated state is updated incrementally on member changes, so it could be queried
+ * with getState() or with a getState service event to the group's gid at any time,
+ * instead of querying each light. Changes not made by group commands, i.e. fades
+ * progress and end, are posted as grpUpdate events coalesced over a report period
+ *
+ * Members should not be subscribed to the same gid with Eclo::grp_subscribe(),
+ * otherwise those would get the command twice
+ */
+class EcloGroup {
+friend class Eclo;
+
+    struct Member {
+        Eclo *eclo;
+        std::bitset<GRP_BIT_LEN> grpmode;       // R - member gets group commands, W - member is counted in group state
+        bool staged;                            // PWM duty is staged by a group command, pending flush
+    };
+
+    // posts group state changes, coalesced over a report period
+    class Reporter : public TickClient {
+        EcloGroup *grp;
+    public:
+        Reporter(EcloGroup *g) : grp(g){};
+        uint32_t tick(int64_t now) override;
+    };
+
+    LList<Member> members;
+    int32_t brtscale = DEFAULT_SCALE;           // scale for aggregated brightness
+    Reporter reporter;
+    uint32_t report_period = GROUP_REPORT_PERIOD;
+    bool report_pending = false;
+
+    // aggregated state of counted members
+    uint16_t counted = 0;
+    uint16_t on = 0;
+    uint64_t value_sum = 0;
+    double power = 0;
+    mutable uint32_t value_min = 0, value_max = 0;
+    mutable bool extremes_valid = true;         // min/max are rescanned on query after a member holding one has moved away
+    esp_event_handler_instance_t cmd_instance = nullptr;
+    esp_event_handler_instance_t srvc_instance = nullptr;
+
+    static void event_hndlr(void* handler_args, esp_event_base_t base, int32_t gid, void* event_data);
+
+    /**
+     * @brief apply command to all members with READ permission
+     */
+    void cmd_apply(local_cmd_evt const *cmd);
+
+    /**
+     * @brief apply absolute brightness command in one pass
+     * commands relative to the current level are not handled here
+     *
+     * @return true if command was applied
+     */
+    bool value_apply(local_cmd_evt const *cmd);
+
+    /**
+     * @brief post event message with group state
+     *
+     * @param evnt - event type, report or on-update
+     * @param dst - recipient's id
+     */
+    void evt_state_post(light_event_id_t evnt = light_event_id_t::grpUpdate, uint16_t dst = ID_ANONYMOUS);
+
+    /**
+     * @brief update aggregated state with member's change
+     * called from member's state change callback
+     *
+     * @param gm - member's membership record
+     * @param l - member's light
+     */
+    void member_update(Grp_membership &gm, GenericLight const *l);
+
+    /**
+     * @brief count member's current state in aggregated state, caller holds the ticker lock
+     *
+     * @return true if member's contribution has changed
+     */
+    bool member_count(Grp_membership &gm, GenericLight const *l);
+
+    // recalculate aggregated state from scratch
+    void rebuild();
+
+public:
+
+    int32_t const gid;          // event group id
+
+    /**
+     * @brief Construct a new Eclo Group object
+     * and subscribe to it's gid command and service events
+     *
+     * @param id - group id, any except GROUP_SELF, should not clash with Eclo id's
+     */
+    EcloGroup(int32_t id);
+    ~EcloGroup();
+
+    /**
+     * @brief add Eclo to the group
+     *
+     * @param e - Eclo object
+     * @param perm - group permission, READ to get group commands, WRITE to be counted in group state
+     * @return true on success
+     * @return false if already a member
+     */
+    bool add(Eclo *e, grp_perms_t perm = grp_perms_t::rw);
+
+    /**
+     * @brief remove Eclo from the group
+     *
+     * @return true if it was a member
+     */
+    bool remove(Eclo *e);
+
+    /**
+     * @brief number of group members
+     */
+    int size() const { return members.size(); };
+
+    /**
+     * @brief Set scale for aggregated brightness value
+     */
+    void setScale(int32_t s);
+
+    /**
+     * @brief Set min interval between group state posts on member changes
+     *
+     * @param period - ms, 0 - state is posted on group commands only
+     */
+    void setReportPeriod(uint32_t period){ report_period = period; };
+
+    /**
+     * @brief Get aggregated group state
+     * counts members with WRITE permission
+     *
+     * @return group_state_t
+     */
+    group_state_t getState() const;
+};
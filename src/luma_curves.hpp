@@ -51,6 +51,7 @@ https://www.photonstophotos.net/GeneralTopics/Exposure/Psychometric_Lightness_an
 */
 
 #pragma once
+#include <cstdint>
 #include <cmath>
 
 
@@ -98,7 +99,7 @@ uint32_t map_square(uint32_t l, uint32_t max_duty, uint32_t max_l = 100);
 
 uint32_t unmap_square(uint32_t duty, uint32_t max_duty, uint32_t max_l = 100);
 
-inline uint32_t map_binary(uint32_t l, uint32_t max_duty, uint32_t max_l = 1){ return (l*2 >= max_l); };
-inline uint32_t unmap_binary(uint32_t duty, uint32_t max_duty, uint32_t max_l = 1){ return (max_duty*(bool)duty); };
+inline uint32_t map_binary(uint32_t l, uint32_t /*max_duty*/, uint32_t max_l = 1){ return (l*2 >= max_l); };
+inline uint32_t unmap_binary(uint32_t duty, uint32_t max_duty, uint32_t /*max_l*/ = 1){ return (max_duty*(bool)duty); };
 
 }   // end of namespace luma
\ No newline at end of file
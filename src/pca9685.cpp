@@ -0,0 +1,422 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#include "pca9685.hpp"
+#include "esp_timer.h"
+#include <string.h>
+
+// LOGGING
+#ifdef ARDUINO
+#include "esp32-hal-log.h"
+#else
+#include "esp_log.h"
+#endif
+
+static const char* TAG = "pca9685";
+
+#define PCA_TASK_NAME       "PCA9685"
+#define PCA_TASK_STACK      2048
+#define PCA_TASK_PRIO       2
+
+// registers
+#define PCA9685_MODE1       0x00
+#define PCA9685_MODE2       0x01
+#define PCA9685_LED0_ON_L   0x06
+#define PCA9685_ALL_LED_ON_L 0xFA
+#define PCA9685_PRESCALE    0xFE
+
+// register bits
+#define MODE1_RESTART       0x80
+#define MODE1_AI            0x20
+#define MODE1_SLEEP         0x10
+#define MODE2_OUTDRV        0x04
+#define LED_FULL            0x10        // full on/off bit in LEDx_ON_H/LEDx_OFF_H
+
+#define PRESCALE_MIN        3
+#define PRESCALE_MAX        255
+
+
+// *** I2CBusIDF methods *** //
+
+esp_err_t I2CBusIDF::xfer(uint8_t addr, const uint8_t *data, size_t len){
+    return i2c_master_write_to_device(port, addr, data, len, pdMS_TO_TICKS(timeout));
+}
+
+esp_err_t I2CBusIDF::begin(int sda, int scl, uint32_t hz){
+    i2c_config_t conf = {};
+    conf.mode = I2C_MODE_MASTER;
+    conf.sda_io_num = sda;
+    conf.scl_io_num = scl;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.master.clk_speed = hz;
+
+    esp_err_t err = i2c_param_config(port, &conf);
+    if (err != ESP_OK)
+        return err;
+
+    return i2c_driver_install(port, conf.mode, 0, 0, 0);
+}
+
+
+// *** PCA9685 methods *** //
+
+PCA9685::PCA9685(I2CBus *i2cbus, uint8_t address) : bus(i2cbus), addr(address){
+    mtx = xSemaphoreCreateMutex();
+    cb_mtx = xSemaphoreCreateRecursiveMutex();
+}
+
+PCA9685::~PCA9685(){
+    if (t_tick){
+        // task is deleted only when it's not in the middle of a callback or a bus transaction
+        xSemaphoreTakeRecursive(cb_mtx, portMAX_DELAY);
+        xSemaphoreTake(mtx, portMAX_DELAY);
+        vTaskDelete(t_tick);
+        t_tick = nullptr;
+        xSemaphoreGive(mtx);
+        xSemaphoreGiveRecursive(cb_mtx);
+    }
+    if (mtx)
+        vSemaphoreDelete(mtx);
+    if (cb_mtx)
+        vSemaphoreDelete(cb_mtx);
+}
+
+esp_err_t PCA9685::begin(uint32_t hz, uint32_t tick_ms){
+    if (!bus || !mtx || !cb_mtx)
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = reg_write(PCA9685_MODE2, MODE2_OUTDRV);     // totem-pole outputs
+    if (err != ESP_OK){
+        ESP_LOGE(TAG, "chip 0x%x is not responding", addr);
+        return err;
+    }
+
+    err = setFreq(hz);
+    if (err != ESP_OK)
+        return err;
+
+    // sync shadow registers with the chip, all channels are off
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    for (uint8_t i = 0; i != PCA9685_CHANNELS; ++i){
+        duty[i] = 0;
+        ch_update(i);
+    }
+    dirty = 0xffff;
+    xSemaphoreGive(mtx);
+    err = commit();
+
+    tick = tick_ms;
+    if (tick && !t_tick)
+        xTaskCreate(PCA9685::tickTask, PCA_TASK_NAME, PCA_TASK_STACK, (void *)this, PCA_TASK_PRIO, &t_tick);
+
+    return err;
+}
+
+esp_err_t PCA9685::reg_write(uint8_t reg, uint8_t value){
+    uint8_t buf[2] = { reg, value };
+    return bus->write(addr, buf, sizeof(buf));
+}
+
+esp_err_t PCA9685::setFreq(uint32_t hz){
+    if (!hz)
+        return ESP_ERR_INVALID_ARG;
+
+    uint32_t prescale = (PCA9685_OSC_CLK + 2048 * hz) / (4096 * hz) - 1;     // round(osc / (4096 * hz)) - 1
+    if (prescale < PRESCALE_MIN)
+        prescale = PRESCALE_MIN;
+    if (prescale > PRESCALE_MAX)
+        prescale = PRESCALE_MAX;
+
+    // prescaler could be changed only in sleep mode
+    esp_err_t err = reg_write(PCA9685_MODE1, MODE1_AI | MODE1_SLEEP);
+    err |= reg_write(PCA9685_PRESCALE, prescale);
+    err |= reg_write(PCA9685_MODE1, MODE1_AI);
+    vTaskDelay(1);                              // oscillator needs 500 us to stabilize, a tick is enough
+    err |= reg_write(PCA9685_MODE1, MODE1_AI | MODE1_RESTART);
+
+    if (err != ESP_OK)
+        return ESP_FAIL;
+
+    freq = PCA9685_OSC_CLK / (4096 * (prescale + 1));
+    ESP_LOGD(TAG, "chip 0x%x freq:%d, prescale:%d", addr, freq, prescale);
+    return ESP_OK;
+}
+
+void PCA9685::ch_update(uint8_t ch){
+    uint8_t r[4] = {0};
+    bool inv = (inverted >> ch) & 1;
+    uint32_t d = duty[ch];
+
+    if (!d || d >= PCA9685_MAX_DUTY){
+        // full on/off bits, inverted channel just swaps them
+        bool on = (d != 0) != inv;
+        r[on ? 1 : 3] = LED_FULL;
+    } else {
+        uint16_t on = phase[ch] & PCA9685_MAX_DUTY;
+        uint16_t off = (phase[ch] + d) & PCA9685_MAX_DUTY;
+        if (inv){
+            uint16_t t = on;
+            on = off;
+            off = t;
+        }
+        r[0] = on & 0xff;
+        r[1] = on >> 8;
+        r[2] = off & 0xff;
+        r[3] = off >> 8;
+    }
+
+    if (!memcmp(&regs[ch * 4], r, sizeof(r)))
+        return;     // nothing changed
+
+    memcpy(&regs[ch * 4], r, sizeof(r));
+    dirty |= 1 << ch;
+    if (t_tick)
+        xTaskNotifyGive(t_tick);
+}
+
+esp_err_t PCA9685::commit(){
+    esp_err_t err = ESP_OK;
+    uint8_t buf[PCA9685_CHANNELS * 4 + 1];
+
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    uint16_t d = dirty;
+    dirty = 0;
+
+    // same values for all channels could be sent via ALL_LED registers
+    if (d == 0xffff){
+        bool same = true;
+        for (uint8_t i = 1; i != PCA9685_CHANNELS && same; ++i)
+            same = !memcmp(regs, &regs[i * 4], 4);
+
+        if (same){
+            buf[0] = PCA9685_ALL_LED_ON_L;
+            memcpy(&buf[1], regs, 4);
+            if (bus->write(addr, buf, 5) != ESP_OK)
+                dirty = d;      // retry on next commit
+            xSemaphoreGive(mtx);
+            return dirty ? ESP_FAIL : ESP_OK;
+        }
+    }
+
+    // write each run of adjacent changed channels as a single burst
+    uint8_t ch = 0;
+    while (ch < PCA9685_CHANNELS){
+        if (!((d >> ch) & 1)){
+            ++ch;
+            continue;
+        }
+
+        uint8_t start = ch;
+        while (ch < PCA9685_CHANNELS && ((d >> ch) & 1))
+            ++ch;
+
+        size_t len = (ch - start) * 4;
+        buf[0] = PCA9685_LED0_ON_L + start * 4;
+        memcpy(&buf[1], &regs[start * 4], len);
+        if (bus->write(addr, buf, len + 1) != ESP_OK){
+            dirty |= ((1 << (ch - start)) - 1) << start;
+            err = ESP_FAIL;
+        }
+    }
+    xSemaphoreGive(mtx);
+
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "chip 0x%x write failed", addr);
+    return err;
+}
+
+uint32_t PCA9685::fade_value(uint8_t ch, int64_t now) const {
+    const chfade_t &f = fades[ch];
+    int64_t elapsed = now - f.start;
+    if (elapsed >= (int64_t)f.duration * 1000)
+        return f.to;
+
+    return easing::lerp(f.from, f.to, f.curve(elapsed * EASE_SCALE / ((int64_t)f.duration * 1000)));
+}
+
+void PCA9685::tick_handler(){
+    ESP_LOGI(TAG, "Start update task for chip 0x%x", addr);
+
+    for (;;){
+        // sleep until there is something to do, changes made meanwhile leave a notification
+        xSemaphoreTake(mtx, portMAX_DELAY);
+        bool idle = !dirty && !fading;
+        xSemaphoreGive(mtx);
+        if (idle)
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // accumulate changes for a tick
+        vTaskDelay(pdMS_TO_TICKS(tick));
+
+        uint16_t ended = 0;
+        xSemaphoreTake(mtx, portMAX_DELAY);
+        if (fading){
+            int64_t now = esp_timer_get_time();
+            for (uint8_t i = 0; i != PCA9685_CHANNELS; ++i){
+                if (!((fading >> i) & 1))
+                    continue;
+
+                duty[i] = fade_value(i, now);
+                ch_update(i);
+                if (now - fades[i].start >= (int64_t)fades[i].duration * 1000){    // eased fades might touch the target before the end
+                    fading &= ~(1 << i);
+                    ended |= 1 << i;
+                }
+            }
+        }
+        xSemaphoreGive(mtx);
+
+        commit();
+        ulTaskNotifyTake(pdTRUE, 0);    // drop notifications for changes that were just sent
+
+        if (!ended)
+            continue;
+        // callbacks could not be replaced while being run
+        xSemaphoreTakeRecursive(cb_mtx, portMAX_DELAY);
+        for (uint8_t i = 0; ended; ++i, ended >>= 1){
+            if ((ended & 1) && cb[i])
+                cb[i](i);
+        }
+        xSemaphoreGiveRecursive(cb_mtx);
+    }
+}
+
+void PCA9685::chDuty(uint8_t ch, uint32_t d){
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    fading &= ~(1 << ch);
+    duty[ch] = d > PCA9685_MAX_DUTY ? PCA9685_MAX_DUTY : d;
+    ch_update(ch);
+    xSemaphoreGive(mtx);
+}
+
+void PCA9685::chPhase(uint8_t ch, uint32_t p){
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    phase[ch] = p & PCA9685_MAX_DUTY;
+    ch_update(ch);
+    xSemaphoreGive(mtx);
+}
+
+void PCA9685::chDutyPhase(uint8_t ch, uint32_t d, uint32_t p){
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    fading &= ~(1 << ch);
+    duty[ch] = d > PCA9685_MAX_DUTY ? PCA9685_MAX_DUTY : d;
+    phase[ch] = p & PCA9685_MAX_DUTY;
+    ch_update(ch);
+    xSemaphoreGive(mtx);
+}
+
+void PCA9685::chInvert(uint8_t ch, bool invert){
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    if (invert)
+        inverted |= 1 << ch;
+    else
+        inverted &= ~(1 << ch);
+    ch_update(ch);
+    xSemaphoreGive(mtx);
+}
+
+bool PCA9685::chFade(uint8_t ch, uint32_t d, uint32_t duration, const easing::Easing &e){
+    ch %= PCA9685_CHANNELS;
+    if (d > PCA9685_MAX_DUTY)
+        d = PCA9685_MAX_DUTY;
+
+    if (!t_tick || !duration){
+        chDuty(ch, d);
+        return false;
+    }
+
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    // a new fade starts from the current level, even if previous one is not over yet
+    fades[ch].from = ((fading >> ch) & 1) ? fade_value(ch, now) : duty[ch];
+    fades[ch].to = d;
+    fades[ch].start = now;
+    fades[ch].duration = duration;
+    fades[ch].curve = e;
+    fading |= 1 << ch;
+    xSemaphoreGive(mtx);
+
+    xTaskNotifyGive(t_tick);
+    ESP_LOGD(TAG, "fade ch:%d, %d->%d, %d ms", ch, fades[ch].from, d, duration);
+    return true;
+}
+
+uint32_t PCA9685::chFadeStop(uint8_t ch){
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    if ((fading >> ch) & 1){
+        duty[ch] = fade_value(ch, esp_timer_get_time());
+        fading &= ~(1 << ch);
+        ch_update(ch);
+    }
+    uint32_t d = duty[ch];
+    xSemaphoreGive(mtx);
+    return d;
+}
+
+void PCA9685::chSetCallback(uint8_t ch, pca_callback_t f){
+    ch %= PCA9685_CHANNELS;
+    // waits for running callbacks, recursive so that a callback could replace itself
+    xSemaphoreTakeRecursive(cb_mtx, portMAX_DELAY);
+    cb[ch] = std::move(f);
+    xSemaphoreGiveRecursive(cb_mtx);
+}
+
+uint32_t PCA9685::chGetDuty(uint8_t ch) const {
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    uint32_t d = ((fading >> ch) & 1) ? fade_value(ch, esp_timer_get_time()) : duty[ch];
+    xSemaphoreGive(mtx);
+    return d;
+}
+
+uint32_t PCA9685::chGetPhase(uint8_t ch) const {
+    return phase[ch % PCA9685_CHANNELS];
+}
+
+bool PCA9685::chGetInvert(uint8_t ch) const {
+    return (inverted >> (ch % PCA9685_CHANNELS)) & 1;
+}
+
+bool PCA9685::chFading(uint8_t ch) const {
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    bool f = (fading >> (ch % PCA9685_CHANNELS)) & 1;
+    xSemaphoreGive(mtx);
+    return f;
+}
+
+uint32_t PCA9685::chGetFadeTarget(uint8_t ch) const {
+    ch %= PCA9685_CHANNELS;
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    uint32_t d = ((fading >> ch) & 1) ? fades[ch].to : duty[ch];
+    xSemaphoreGive(mtx);
+    return d;
+}
@@ -0,0 +1,283 @@
+/*
+    ESP32 Light Manager library
+
+This code implements a library for ESP32-xx family chips and provides an
+API for controling Lighting applications, mostly (but not limited to) LEDs,
+LED strips, PWM drivers, RGB LED strips etc...
+
+
+Copyright (C) Emil Muratov, 2022
+GitHub: https://github.com/vortigont/ESP32-LightManager
+
+ *  This program or library is free software; you can redistribute it
+ *  and/or modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General
+ *  Public License along with this library; if not, get one at
+ *  https://opensource.org/licenses/LGPL-3.0
+*/
+
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/i2c.h"
+#include "easing.hpp"
+#include <functional>
+
+#define PCA9685_CHANNELS            16
+#define PCA9685_RESOLUTION          12
+#define PCA9685_MAX_DUTY            ((1<<PCA9685_RESOLUTION) - 1)
+#define PCA9685_DEFAULT_ADDR        0x40
+#define PCA9685_OSC_CLK             25000000        // internal oscillator, Hz
+#define PCA9685_DEFAULT_FREQ        1000            // Hz, chip supports 24-1526 Hz
+#define PCA9685_DEFAULT_TICK        10              // ms, registers update period
+#define I2C_DEFAULT_TIMEOUT         10              // ms
+
+// channel callback type, called on software fade end
+typedef std::function<void (uint8_t channel)> pca_callback_t;
+
+/**
+ * @brief Abstract I2C bus
+ * a write-only transport for I2C peripheral drivers,
+ * counts transactions and bytes on the wire, could be replaced with any
+ * other implementation, i.e. a simulated bus for host builds
+ */
+class I2CBus {
+    uint32_t tx_bytes = 0;
+    uint32_t tx_count = 0;
+
+protected:
+    /**
+     * @brief bus-specific write transaction implementation
+     *
+     * @param addr - 7 bit device address
+     * @param data - data to send
+     * @param len - data length
+     * @return esp_err_t
+     */
+    virtual esp_err_t xfer(uint8_t addr, const uint8_t *data, size_t len) = 0;     // pure virtual
+
+public:
+    virtual ~I2CBus(){};
+
+    /**
+     * @brief run write transaction on the bus
+     *
+     * @param addr - 7 bit device address
+     * @param data - data to send, including register address if any
+     * @param len - data length
+     * @return esp_err_t
+     */
+    esp_err_t write(uint8_t addr, const uint8_t *data, size_t len){ tx_bytes += len + 1; ++tx_count; return xfer(addr, data, len); };
+
+    /**
+     * @brief Get number of bytes sent over the bus, including address bytes
+     */
+    uint32_t getTxBytes() const { return tx_bytes; }
+
+    /**
+     * @brief Get number of write transactions
+     */
+    uint32_t getTxCount() const { return tx_count; }
+
+    void resetStats(){ tx_bytes = 0; tx_count = 0; }
+};
+
+/**
+ * @brief ESP-IDF I2C master bus
+ *
+ */
+class I2CBusIDF : public I2CBus {
+    i2c_port_t port;
+    uint32_t timeout;
+
+    esp_err_t xfer(uint8_t addr, const uint8_t *data, size_t len) override;
+
+public:
+    I2CBusIDF(i2c_port_t port = I2C_NUM_0, uint32_t timeout_ms = I2C_DEFAULT_TIMEOUT) : port(port), timeout(timeout_ms){};
+
+    /**
+     * @brief configure I2C port in master mode and install IDF's driver
+     * not required if I2C driver has been installed elsewhere
+     *
+     * @param sda - SDA pin
+     * @param scl - SCL pin
+     * @param hz - bus clock
+     * @return esp_err_t
+     */
+    esp_err_t begin(int sda, int scl, uint32_t hz = 400000);
+};
+
+
+/**
+ * @brief PCA9685 16-channel 12-bit I2C PWM controller
+ * keeps a shadow copy of LED registers, channels changes are accumulated
+ * and written to the chip in auto-increment bursts covering adjacent changed
+ * channels, once per tick. Each channel has it's own on/off phase offset, so
+ * phase-shifted power-share works the same way as with LEDC.
+ * Chip has no fade engine, fades are done in software on the same tick
+ *
+ */
+class PCA9685 {
+
+    struct chfade_t {
+        uint32_t from;
+        uint32_t to;
+        int64_t start;                  // us
+        uint32_t duration;              // ms
+        easing::Easing curve;
+    };
+
+    I2CBus *bus;
+    uint8_t const addr;
+    uint32_t freq = PCA9685_DEFAULT_FREQ;
+    uint32_t tick = 0;                              // registers update period, ms
+    SemaphoreHandle_t mtx = nullptr;
+    SemaphoreHandle_t cb_mtx = nullptr;             // held while callbacks are run, recursive
+    TaskHandle_t t_tick = nullptr;                  // tick task handler
+
+    uint8_t regs[PCA9685_CHANNELS * 4] = {0};       // shadow copy of LEDx_ON_L...LEDx_OFF_H registers
+    uint16_t dirty = 0;                             // channels with shadow registers not sent to the chip yet
+    uint16_t inverted = 0;                          // channels with inverted output
+    uint16_t fading = 0;                            // channels with active fade
+    uint32_t duty[PCA9685_CHANNELS] = {0};
+    uint32_t phase[PCA9685_CHANNELS] = {0};
+    chfade_t fades[PCA9685_CHANNELS];
+    pca_callback_t cb[PCA9685_CHANNELS];
+
+    // recalculate shadow registers for a channel, must be called under lock
+    void ch_update(uint8_t ch);
+
+    // calculate fade progress for a channel, must be called under lock
+    uint32_t fade_value(uint8_t ch, int64_t now) const;
+
+    // write 8-bit register
+    esp_err_t reg_write(uint8_t reg, uint8_t value);
+
+    // advance fades and commit changes
+    void tick_handler();
+
+    // static wrapper for tick Task
+    static void tickTask(void* pvParams){
+        ((PCA9685*)pvParams)->tick_handler();
+    }
+
+public:
+    PCA9685(I2CBus *i2cbus, uint8_t address = PCA9685_DEFAULT_ADDR);
+    ~PCA9685();
+
+    // Copy semantics : not (yet) implemented
+    PCA9685(const PCA9685&) = delete;
+    PCA9685& operator=(const PCA9685&) = delete;
+
+    /**
+     * @brief initialize the chip
+     * resets chip's mode, sets PWM frequency, turns all channels off
+     * and starts update task
+     *
+     * @param hz - PWM frequency
+     * @param tick_ms - registers update period, ms. If 0, no update task will be started,
+     *                  changes must be sent to the chip with commit() calls and fades are not available
+     * @return esp_err_t
+     */
+    esp_err_t begin(uint32_t hz = PCA9685_DEFAULT_FREQ, uint32_t tick_ms = PCA9685_DEFAULT_TICK);
+
+    /**
+     * @brief write all pending channel changes to the chip
+     * adjacent changed channels are merged into a single auto-increment burst
+     *
+     * @return esp_err_t
+     */
+    esp_err_t commit();
+
+    /**
+     * @brief returns true if changes are sent to the chip by the update task
+     */
+    bool autocommit() const { return t_tick; }
+
+    /**
+     * @brief registers update period, ms
+     */
+    uint32_t getTick() const { return tick; }
+
+    // Channel methods
+    void chDuty(uint8_t ch, uint32_t duty);
+    void chPhase(uint8_t ch, uint32_t phase);
+
+    /**
+     * @brief set channel duty and phase (on time offset)
+     * any fade in progress on channel is canceled
+     *
+     * @param ch - channel number
+     * @param duty - duty value 0-4095
+     * @param phase - on time offset 0-4095
+     */
+    void chDutyPhase(uint8_t ch, uint32_t duty, uint32_t phase);
+
+    /**
+     * @brief invert channel's output
+     * inversion is done by swapping on/off times, so works per channel
+     */
+    void chInvert(uint8_t ch, bool invert);
+
+    /**
+     * @brief start software fade on a channel
+     * fade starts from the current duty value
+     *
+     * @param ch - channel number
+     * @param duty - target duty
+     * @param duration - fade duration, ms
+     * @param e - easing function
+     * @return true - fade has started
+     * @return false - immediate duty change has been made, no update task is running
+     */
+    bool chFade(uint8_t ch, uint32_t duty, uint32_t duration, const easing::Easing &e = easing::Easing());
+
+    /**
+     * @brief stop fade on a channel
+     * channel holds duty reached by the moment of stop, fade end callback is not called
+     *
+     * @param ch - channel number
+     * @return uint32_t - channel's duty
+     */
+    uint32_t chFadeStop(uint8_t ch);
+
+    /**
+     * @brief set callback for channel's fade end event
+     * callback is executed from the update task. If a callback is being run, call waits
+     * for it to return, so objects captured by the old callback could be destroyed afterwards
+     */
+    void chSetCallback(uint8_t ch, pca_callback_t f);
+
+    /**
+     * @brief get channel's duty
+     * returns the value from shadow registers, chip is never read
+     */
+    uint32_t chGetDuty(uint8_t ch) const;
+    uint32_t chGetPhase(uint8_t ch) const;
+    bool chGetInvert(uint8_t ch) const;
+    bool chFading(uint8_t ch) const;
+
+    /**
+     * @brief get target duty of an active fade
+     * returns current duty if channel is not fading
+     */
+    uint32_t chGetFadeTarget(uint8_t ch) const;
+
+    /**
+     * @brief set PWM frequency for all channels
+     *
+     * @param hz - frequency, Hz
+     * @return esp_err_t
+     */
+    esp_err_t setFreq(uint32_t hz);
+    uint32_t getFreq() const { return freq; };
+};